@@ -11,36 +11,90 @@ Mail : theo.morris@mds.ac.nz
 **/
 
 #include "Agent.h"
+#include "MathBatch.h"
+#include "SpatialGrid.h"
 
-Agent::Agent(int spawnPositionX, int spawnPositionY, Agent* agentToFollow = nullptr, MovementBehavior movementType = MovementBehavior::Wander) : m_agentToFollow(agentToFollow)
-{
-    loadSprite(movementType);
-    // Set the texture, scale, origin, rotation position of the sprite
-    m_sprite.setTexture(m_texture);
-
-    m_sprite.setScale(0.1f, 0.1f);
+#include <bit>
 
-    m_sprite.setOrigin(m_sprite.getLocalBounds().width / 2.0f, m_sprite.getLocalBounds().height / 2.0f);
+const char* steeringBehaviorName(SteeringBehavior behavior)
+{
+    switch (behavior) {
+    case SteeringBehavior::Avoidance:
+        return "Avoidance";
+    case SteeringBehavior::Separation:
+        return "Separation";
+    case SteeringBehavior::Cohesion:
+        return "Cohesion";
+    case SteeringBehavior::Alignment:
+        return "Alignment";
+    case SteeringBehavior::Seek:
+        return "Seek";
+    case SteeringBehavior::Flee:
+        return "Flee";
+    case SteeringBehavior::Pursuit:
+        return "Pursuit";
+    case SteeringBehavior::Evade:
+        return "Evade";
+    case SteeringBehavior::Wander:
+        return "Wander";
+    case SteeringBehavior::Arrival:
+        return "Arrival";
+    case SteeringBehavior::Queueing:
+        return "Queueing";
+    case SteeringBehavior::FollowingLeader:
+        return "FollowingLeader";
+    default:
+        return "Unknown";
+    }
+}
 
+Agent::Agent(unsigned int id, unsigned int seed, int spawnPositionX, int spawnPositionY, Agent* agentToFollow = nullptr, MovementBehavior movementType = MovementBehavior::Wander) : m_id(id), m_behavior(movementType), m_agentToFollow(agentToFollow), m_seed(seed)
+{
     m_pos = sf::Vector2f(spawnPositionX, spawnPositionY);
-    m_sprite.setPosition(m_pos);
     
     //calculate random direction to move towards
-    wdelta = static_cast<float>(rand()) / RAND_MAX * 360.0f;
-
-    m_rot = wdelta;
-    m_sprite.setRotation(m_rot);
+    wdelta = agentRandom(m_seed, m_id, 0, RandomStream::Spawn) * 360.0f;
 
-    m_velocity = sf::Vector2f(cos(m_rot) * INITIAL_SPEED, sin(m_rot) * INITIAL_SPEED);
+    m_velocity = sf::Vector2f(cos(wdelta) * INITIAL_SPEED, sin(wdelta) * INITIAL_SPEED);
 
     // Initialize weights based on movementType
     initializeWeights(movementType);
 }
 
+Agent::Agent(const AgentState& state, unsigned int seed) : m_id(state.id), m_behavior(static_cast<MovementBehavior>(state.behavior)), m_agentToFollow(nullptr), m_seed(seed)
+{
+    m_pos = sf::Vector2f(state.positionX, state.positionY);
+    m_velocity = sf::Vector2f(state.velocityX, state.velocityY);
+    targetPreviousPos = sf::Vector2i(state.targetPreviousX, state.targetPreviousY);
+    wdelta = state.wanderAngle;
+    m_randomTick = state.randomTick;
+    m_wanderDraws = state.wanderDraws;
+
+    initializeWeights(m_behavior);
+}
+
 Agent::~Agent()
 {
 }
 
+AgentState Agent::getState(std::int32_t followIndex) const
+{
+    AgentState state;
+    state.id = m_id;
+    state.behavior = static_cast<std::uint32_t>(m_behavior);
+    state.followIndex = followIndex;
+    state.positionX = m_pos.x;
+    state.positionY = m_pos.y;
+    state.velocityX = m_velocity.x;
+    state.velocityY = m_velocity.y;
+    state.wanderAngle = wdelta;
+    state.targetPreviousX = targetPreviousPos.x;
+    state.targetPreviousY = targetPreviousPos.y;
+    state.randomTick = m_randomTick;
+    state.wanderDraws = m_wanderDraws;
+    return state;
+}
+
 void Agent::initializeWeights(MovementBehavior movementType) {
     // Set specific weights based on the movement type
     switch (movementType) {
@@ -95,221 +149,424 @@ void Agent::initializeWeights(MovementBehavior movementType) {
     }
 }
 
-void Agent::loadSprite(MovementBehavior movementType) {
+void Agent::updateFollowDepth()
+{
+    // The agent followed is always earlier in the agents vector, so updating in order means its depth is already current
+    bool followsAgent = m_agentToFollow != nullptr && (m_behavior == MovementBehavior::Queue || m_behavior == MovementBehavior::FollowLeader);
+    m_followDepth = followsAgent ? m_agentToFollow->m_followDepth + 1 : 0;
+}
 
-    // Set specific weights based on the movement type
-    switch (movementType) {
-    case MovementBehavior::Seek:
-        m_texture.loadFromFile("Assets/Textures/Seek.png");
-        break;
-    case MovementBehavior::Flee:
-        m_texture.loadFromFile("Assets/Textures/Flee.png");
-        break;
-    case MovementBehavior::Pursue:
-        m_texture.loadFromFile("Assets/Textures/Pursue.png");
-        break;
-    case MovementBehavior::Evade:
-        m_texture.loadFromFile("Assets/Textures/Evade.png");
-        break;
-    case MovementBehavior::Wander:
-        m_texture.loadFromFile("Assets/Textures/Wander.png");
-        break;
+std::uint64_t Agent::stateHash() const
+{
+    // the exact bits are hashed so any difference at all, even the last bit of a float, changes the hash
+    std::uint64_t position = static_cast<std::uint64_t>(std::bit_cast<std::uint32_t>(m_pos.x)) << 32 | std::bit_cast<std::uint32_t>(m_pos.y);
+    std::uint64_t velocity = static_cast<std::uint64_t>(std::bit_cast<std::uint32_t>(m_velocity.x)) << 32 | std::bit_cast<std::uint32_t>(m_velocity.y);
+
+    return mixBits(mixBits(mixBits(m_id) ^ position) ^ velocity);
+}
+
+void Agent::steer(const SteeringContext& context)
+{
+    // Catch up on any ticks sat out while running at a reduced rate
+    float deltaTime = context.deltaTime + m_deferredTime;
+    m_steps = 1 + m_deferredSteps;
+    m_deferredTime = 0.0f;
+    m_deferredSteps = 0;
+
+    m_randomTick = context.tick;
+    m_wanderDraws = 0;
+    m_fastMath = context.settings.fastMath;
+
+    // pursuit / evade
+    // calculates future from the target, this is tracked every update even if the behaviours end up skipped
+    sf::Vector2f targetDisplacement = sf::Vector2f(context.target - targetPreviousPos);
+
+    targetPreviousPos = context.target;
+
+    sf::Vector2f targetVelocity = targetDisplacement / deltaTime;
+
+    NeighborSums neighbors;
+    sf::Vector2f totalForce(0.0f, 0.0f);
+
+    if (context.settings.accumulation == ForceAccumulation::Prioritized)
+    {
+        // Behaviours are evaluated in priority order and stop once the force budget has been spent,
+        // every behaviour force is already scaled by dt so the budget is too
+        float budget = MAX_FORCE * deltaTime;
+        bool budgetSpent = false;
+        for (int i = 0; i < STEERING_BEHAVIOR_COUNT; ++i) {
+            SteeringBehavior behavior = static_cast<SteeringBehavior>(i);
+            if (behaviorWeight(behavior) <= 0) {
+                continue;
+            }
+
+            if (budgetSpent) {
+                m_skipCounts[i]++;
+                continue;
+            }
+
+            sf::Vector2f force = slicedBehaviorForce(behavior, context, deltaTime, targetVelocity, neighbors);
+            budgetSpent = !accumulateForce(totalForce, force, budget);
+        }
+    }
+    else
+    {
+        // Calculate total force, summed in the same order the forces have always been added
+        const SteeringBehavior summationOrder[] = {
+            SteeringBehavior::Cohesion,
+            SteeringBehavior::Alignment,
+            SteeringBehavior::Separation,
+            SteeringBehavior::Seek,
+            SteeringBehavior::Flee,
+            SteeringBehavior::Pursuit,
+            SteeringBehavior::Evade,
+            SteeringBehavior::Wander,
+            SteeringBehavior::Arrival,
+            SteeringBehavior::Avoidance,
+            SteeringBehavior::Queueing,
+            SteeringBehavior::FollowingLeader
+        };
+
+        for (SteeringBehavior behavior : summationOrder) {
+            if (behaviorWeight(behavior) > 0) {
+                totalForce += slicedBehaviorForce(behavior, context, deltaTime, targetVelocity, neighbors);
+            }
+        }
+
+        if (magnitude(totalForce) > MAX_FORCE) {
+            totalForce = normalized(totalForce) * MAX_FORCE;
+        }
+    }
+
+    m_neighborsGathered = neighbors.gathered;
+    m_neighborCandidates = neighbors.candidates;
+
+    m_forcesCached = true;
+    m_steeringForce = totalForce;
+    m_steered = true;
+}
+
+void Agent::integrate(const sf::Vector2u& windowSize)
+{
+    // Level of detail changes decided while steering only take effect here so other agents never see them mid tick
+    if (m_wakeRequested) {
+        m_sleeping = false;
+        m_settledTicks = 0;
+        m_wakeRequested = false;
+    }
+    if (m_sleepRequested) {
+        m_sleeping = true;
+        m_velocity = sf::Vector2f(0.0f, 0.0f);
+        m_sleepRequested = false;
+        return;
+    }
+
+    if (!m_steered) {
+        return;
+    }
+    m_steered = false;
+
+    // Update velocity
+    m_velocity += m_steeringForce;
+    if (magnitude(m_velocity) > MAX_SPEED) {
+        m_velocity = normalized(m_velocity) * MAX_SPEED;
+    }
+
+    // Update position and wraps the position around the screen boarders
+    m_pos += m_velocity * static_cast<float>(m_steps);
+    wrapPosition(m_pos, windowSize);
+}
+
+bool Agent::canSettle(const sf::Vector2i& target) const
+{
+    // Only agents that are meant to come to rest, and have, can be put to sleep
+    if (magnitude(m_velocity) >= SETTLE_SPEED) {
+        return false;
+    }
+
+    switch (m_behavior) {
     case MovementBehavior::Arrival:
-        m_texture.loadFromFile("Assets/Textures/Arrival.png");
-        break;
-    case MovementBehavior::Flocking:
-        m_texture.loadFromFile("Assets/Textures/Flocking.png");
-        break;
-    case MovementBehavior::FollowLeader:
-        m_texture.loadFromFile("Assets/Textures/FollowLeader.png");
-        break;
+        return vectorDistance(m_pos, sf::Vector2f(target)) < ARRIVAL_SETTLE_DISTANCE;
     case MovementBehavior::Queue:
-        m_texture.loadFromFile("Assets/Textures/Queue.png");
-        break;
+        return m_agentToFollow != nullptr && vectorDistance(m_pos, m_agentToFollow->getPosition()) <= QUEUE_DISTANCE;
     default:
-        m_texture.loadFromFile("Assets/Textures/Wander.png");
-        break;
+        return false;
     }
 }
 
-void Agent::draw(sf::RenderTarget& target, sf::RenderStates states) const
+bool Agent::updateSettleState(const sf::Vector2i& target, unsigned int obstacleVersion)
 {
-    target.draw(m_sprite, states);
+    if (!canSettle(target)) {
+        m_settledTicks = 0;
+        return false;
+    }
+
+    // Restart the count whenever the agent drifts away from where it started settling
+    if (m_settledTicks == 0 || vectorDistance(m_pos, m_settleAnchor) > SETTLE_DISTANCE) {
+        m_settleAnchor = m_pos;
+        m_settledTicks = 1;
+        return false;
+    }
+
+    m_settledTicks++;
+    if (m_settledTicks < SETTLE_TICKS) {
+        return false;
+    }
+
+    // Remember what the agent was reacting to so any change to it wakes the agent back up
+    m_sleepRequested = true;
+    m_sleepTarget = target;
+    m_sleepObstacleVersion = obstacleVersion;
+    if (m_agentToFollow != nullptr) {
+        m_sleepFollowPos = m_agentToFollow->getPosition();
+    }
+    return true;
+}
+
+bool Agent::shouldWake(const SteeringContext& context, unsigned int obstacleVersion) const
+{
+    if (obstacleVersion != m_sleepObstacleVersion) {
+        return true;
+    }
+
+    // Arrival agents react to the target, queueing agents to the agent in front of them
+    if (m_behavior == MovementBehavior::Arrival && context.target != m_sleepTarget) {
+        return true;
+    }
+    if (m_agentToFollow != nullptr && m_behavior == MovementBehavior::Queue && vectorDistance(m_agentToFollow->getPosition(), m_sleepFollowPos) > SETTLE_DISTANCE) {
+        return true;
+    }
+
+    // Checking the neighbours costs a grid query so it is spread over a few ticks
+    if ((context.tick + m_id) % WAKE_CHECK_INTERVAL != 0) {
+        return false;
+    }
+
+    bool awakeNeighbor = false;
+    context.grid.forEachAgentNear(m_pos, SEPARATION_RADIUS, [&](unsigned int index) {
+        const Agent& agent = *context.agents[index];
+        if (&agent != this && !agent.isSleeping() && vectorDistance(m_pos, agent.getPosition()) < SEPARATION_RADIUS) {
+            awakeNeighbor = true;
+        }
+    });
+
+    return awakeNeighbor;
+}
+
+void Agent::requestWake(const sf::Vector2i& target)
+{
+    m_wakeRequested = true;
+
+    // The target may have moved a long way while asleep, don't treat that as target velocity
+    targetPreviousPos = target;
+}
+
+void Agent::wake(const sf::Vector2i& target)
+{
+    m_sleeping = false;
+    m_settledTicks = 0;
+    targetPreviousPos = target;
 }
 
-void Agent::update(float deltaTime, const sf::Vector2u& windowSize, const std::vector<std::unique_ptr<Agent>>& agents, const std::vector<std::unique_ptr<Obstacle>>& obstacles, const sf::Vector2i& target)
+void Agent::deferUpdate(float deltaTime)
 {
-    // Initialize forces and counters
-    sf::Vector2f cohesionForce(0.0f, 0.0f);
-    sf::Vector2f alignmentForce(0.0f, 0.0f);
-    sf::Vector2f separationForce(0.0f, 0.0f);
-    int cohesionCount = 0;
-    int alignmentCount = 0;
-    int separationCount = 0;
-
-    // Iterate through other agents
-    for (const auto& agent : agents) {
-        if (agent.get() != this) {
-            float distance = vectorDistance(getPosition(), agent->getPosition());
-
-            if (distance < NEIGHBOR_RADIUS) {
+    m_deferredTime += deltaTime;
+    m_deferredSteps++;
+}
+
+void Agent::gatherNeighbors(const SteeringContext& context, NeighborSums& neighbors) const
+{
+    neighbors.gathered = true;
+
+    // The grid keeps the agents' state in cell order, so each row of cells in reach is one contiguous run of positions
+    const SpatialGrid& grid = context.grid;
+    const unsigned int* ids = grid.getAgentIds();
+    const float* positionX = grid.getPositionX();
+    const float* positionY = grid.getPositionY();
+    const float* velocityX = grid.getVelocityX();
+    const float* velocityY = grid.getVelocityY();
+
+    float distances[NEIGHBOR_BATCH_SIZE];
+    grid.forEachSpanNear(m_pos, NEIGHBOR_RADIUS, [&](unsigned int begin, unsigned int end) {
+        neighbors.candidates += end - begin;
+        for (unsigned int batchBegin = begin; batchBegin < end; batchBegin += NEIGHBOR_BATCH_SIZE) {
+            unsigned int batchCount = std::min(NEIGHBOR_BATCH_SIZE, end - batchBegin);
+            batchDistance(m_pos.x, m_pos.y, positionX + batchBegin, positionY + batchBegin, batchCount, distances);
+
+            for (unsigned int k = 0; k < batchCount; ++k) {
+                unsigned int slot = batchBegin + k;
+                float distance = distances[k];
+                if (ids[slot] == m_id || distance >= NEIGHBOR_RADIUS) {
+                    continue;
+                }
+
+                sf::Vector2f position(positionX[slot], positionY[slot]);
+
                 // Cohesion add position of nearby agents
-                cohesionForce += agent->getPosition();
-                cohesionCount++;
+                neighbors.cohesion += position;
+                neighbors.cohesionCount++;
 
                 // Alignment add velocity of nearby agents
-                alignmentForce += agent->getVelocity();
-                alignmentCount++;
+                neighbors.alignment += sf::Vector2f(velocityX[slot], velocityY[slot]);
+                neighbors.alignmentCount++;
 
                 // Separation move away from nearby agents
                 if (distance < SEPARATION_RADIUS) {
-                    sf::Vector2f diff = getPosition() - agent->getPosition();
+                    sf::Vector2f diff = getPosition() - position;
                     if (distance != 0) {
                         diff /= distance;
                     }
-                    separationForce += diff;
-                    separationCount++;
+                    neighbors.separation += diff;
+                    neighbors.separationCount++;
                 }
             }
         }
-    }
-
-    //apply weights and calculate forces
-
-    if (cohesionCount > 0) {
-        // Calculate average position of nearby agents for cohesion
-        cohesionForce = (cohesionForce / static_cast<float>(cohesionCount) - getPosition());
-        cohesionForce = normalize(cohesionForce);
-        cohesionForce *= deltaTime;
-        cohesionForce *= alignmentWeight;
-    }
-
-    if (alignmentCount > 0) {
-        // Calculate average velocity of nearby agents for alignment
-        alignmentForce = (alignmentForce / static_cast<float>(alignmentCount) - getVelocity());
-        alignmentForce = normalize(alignmentForce);
-        alignmentForce *= deltaTime;
-        alignmentForce *= alignmentWeight;
-    }
-    if (separationCount > 0) {
-        // Calculate separation force
-        separationForce = separationForce / static_cast<float>(separationCount);
-        separationForce = normalize(separationForce);
-        separationForce *= deltaTime;
-        separationForce *= separationWeight;
-    }
-
-    // other behaviours
-    sf::Vector2f wanderForce;
-    sf::Vector2f seekForce;
-    sf::Vector2f fleeForce;
-    sf::Vector2f pursuitForce;
-    sf::Vector2f evadeForce;
-    sf::Vector2f arrivalForce;
-    sf::Vector2f avoidanceForce;
-    sf::Vector2f queueingForce;
-    sf::Vector2f followingLeaderForce;
-
-    // wander
-    if (wanderWeight > 0)
-    {
-        wanderForce = wander(deltaTime);
-        wanderForce *= wanderWeight;
-    }
+    });
+}
 
-    // seek / flee
-    if (seekWeight > 0)
-    {
-        seekForce = seek(sf::Vector2f(target), deltaTime);
-        seekForce *= seekWeight;
-    }
-    if (fleeWeight > 0)
-    {
-        fleeForce = flee(sf::Vector2f(target), deltaTime);
-        fleeForce *= fleeWeight;
+float Agent::behaviorWeight(SteeringBehavior behavior) const
+{
+    switch (behavior) {
+    case SteeringBehavior::Avoidance:
+        return avoidanceWeight;
+    case SteeringBehavior::Separation:
+        return separationWeight;
+    case SteeringBehavior::Cohesion:
+        return cohesionWeight;
+    case SteeringBehavior::Alignment:
+        return alignmentWeight;
+    case SteeringBehavior::Seek:
+        return seekWeight;
+    case SteeringBehavior::Flee:
+        return fleeWeight;
+    case SteeringBehavior::Pursuit:
+        return pursuitWeight;
+    case SteeringBehavior::Evade:
+        return evadeWeight;
+    case SteeringBehavior::Wander:
+        return wanderWeight;
+    case SteeringBehavior::Arrival:
+        return arrivalWeight;
+    case SteeringBehavior::Queueing:
+        return queueingWeight;
+    case SteeringBehavior::FollowingLeader:
+        return followingLeaderWeight;
+    default:
+        return 0.0f;
     }
+}
 
-    // pursuit / evade
-    // calculates future from the target
-    sf::Vector2f targetDisplacement = sf::Vector2f(target - targetPreviousPos);
-
-    targetPreviousPos = target;
-
-    sf::Vector2f targetVelocity = targetDisplacement / deltaTime;
+sf::Vector2f Agent::behaviorForce(SteeringBehavior behavior, const SteeringContext& context, float deltaTime, const sf::Vector2f& targetVelocity, NeighborSums& neighbors)
+{
+    sf::Vector2f force(0.0f, 0.0f);
+    sf::Vector2f target(context.target);
 
-    if (pursuitWeight > 0)
-    {
-        pursuitForce = pursuit(sf::Vector2f(target), targetVelocity, deltaTime);
-        pursuitForce *= pursuitWeight;
-    }
-    if (evadeWeight > 0)
-    {
-        evadeForce = evade(sf::Vector2f(target), targetVelocity, deltaTime);
-        evadeForce *= evadeWeight;
+    // cohesion, alignment and separation share one pass over the other agents
+    if ((behavior == SteeringBehavior::Cohesion || behavior == SteeringBehavior::Alignment || behavior == SteeringBehavior::Separation) && !neighbors.gathered) {
+        gatherNeighbors(context, neighbors);
     }
 
-    // arrival
-    if (arrivalWeight > 0)
-    {
-        arrivalForce = arrival(sf::Vector2f(target), deltaTime);
-        arrivalForce *= arrivalWeight;
+    switch (behavior) {
+    case SteeringBehavior::Avoidance:
+        force = obstacleAvoidance(context.obstacles, deltaTime);
+        break;
+    case SteeringBehavior::Separation:
+        if (neighbors.separationCount > 0) {
+            // Calculate separation force
+            force = neighbors.separation / static_cast<float>(neighbors.separationCount);
+            force = normalized(force);
+            force *= deltaTime;
+        }
+        break;
+    case SteeringBehavior::Cohesion:
+        if (neighbors.cohesionCount > 0) {
+            // Calculate average position of nearby agents for cohesion
+            force = (neighbors.cohesion / static_cast<float>(neighbors.cohesionCount) - getPosition());
+            force = normalized(force);
+            force *= deltaTime;
+        }
+        break;
+    case SteeringBehavior::Alignment:
+        if (neighbors.alignmentCount > 0) {
+            // Calculate average velocity of nearby agents for alignment
+            force = (neighbors.alignment / static_cast<float>(neighbors.alignmentCount) - getVelocity());
+            force = normalized(force);
+            force *= deltaTime;
+        }
+        break;
+    case SteeringBehavior::Seek:
+        force = seek(target, deltaTime);
+        break;
+    case SteeringBehavior::Flee:
+        force = flee(target, deltaTime);
+        break;
+    case SteeringBehavior::Pursuit:
+        force = pursuit(target, targetVelocity, deltaTime);
+        break;
+    case SteeringBehavior::Evade:
+        force = evade(target, targetVelocity, deltaTime);
+        break;
+    case SteeringBehavior::Wander:
+        force = wander(deltaTime);
+        break;
+    case SteeringBehavior::Arrival:
+        force = arrival(target, deltaTime);
+        break;
+    case SteeringBehavior::Queueing:
+        force = queueing(deltaTime);
+        break;
+    case SteeringBehavior::FollowingLeader:
+        force = followingLeader(deltaTime);
+        break;
+    default:
+        break;
     }
 
-    // obstacle avoidance
-    if (avoidanceWeight > 0)
-    {
-        avoidanceForce = obstacleAvoidance(obstacles, deltaTime);
-        avoidanceForce *= avoidanceWeight;
-    }
+    return force * behaviorWeight(behavior);
+}
 
-    // queueing
-    if (queueingWeight > 0)
-    {
-        queueingForce = queueing(deltaTime);
-        queueingForce *= queueingWeight;
-    }
-    
-    // following leader
-    if (followingLeaderWeight > 0)
-    {
-        followingLeaderForce = followingLeader(deltaTime);
-        followingLeaderForce *= followingLeaderWeight;
+sf::Vector2f Agent::slicedBehaviorForce(SteeringBehavior behavior, const SteeringContext& context, float deltaTime, const sf::Vector2f& targetVelocity, NeighborSums& neighbors)
+{
+    int index = static_cast<int>(behavior);
+    unsigned int interval = context.settings.updateIntervals[index];
+
+    // The agent id picks which slice of the population this agent falls into
+    if (interval > 1 && m_forcesCached && (context.tick + m_id) % interval != 0) {
+        return m_cachedForces[index];
     }
 
-    // Calculate total force
-    sf::Vector2f totalForce = cohesionForce + alignmentForce + separationForce + seekForce + fleeForce + pursuitForce + evadeForce + wanderForce + arrivalForce + avoidanceForce + queueingForce + followingLeaderForce;
+    m_cachedForces[index] = behaviorForce(behavior, context, deltaTime, targetVelocity, neighbors);
+    return m_cachedForces[index];
+}
 
-    if (vectorMagnitude(totalForce) > MAX_FORCE) {
-        totalForce = normalize(totalForce) * MAX_FORCE;
+bool Agent::accumulateForce(sf::Vector2f& runningTotal, const sf::Vector2f& force, float budget) const
+{
+    // Calculate how much of the force budget is left over
+    float magnitudeRemaining = budget - magnitude(runningTotal);
+    if (magnitudeRemaining <= 0.0f) {
+        return false;
     }
 
-    // Update velocity
-    m_velocity += totalForce;
-    if (vectorMagnitude(m_velocity) > MAX_SPEED) {
-        m_velocity = normalize(m_velocity) * MAX_SPEED;
+    // Add the whole force if it fits, otherwise only the part that fills the budget
+    float magnitudeToAdd = magnitude(force);
+    if (magnitudeToAdd < magnitudeRemaining) {
+        runningTotal += force;
+        return true;
     }
 
-    // Update position and wraps the position around the screen boarders
-    m_pos += m_velocity;
-    wrapPosition(m_pos, windowSize);
-
-    // Update rotation
-    m_rot = std::atan2(m_velocity.y, m_velocity.x) * 180.0f / PI;
-    m_sprite.setRotation(m_rot);
-
-    // Update sprite position
-    m_sprite.setPosition(m_pos);
+    runningTotal += normalized(force) * magnitudeRemaining;
+    return false;
 }
 
 sf::Vector2f Agent::seek(const sf::Vector2f& target, float dt)
 {
     // Calculate desired velocity
     sf::Vector2f desiredVelocity = target - m_pos;
-    float distance = vectorMagnitude(desiredVelocity);
+    float distance = magnitude(desiredVelocity);
 
     // Check if the distance is greater than zero to avoid division by zero
     if (distance > 0) {
-        desiredVelocity = normalize(desiredVelocity);
+        desiredVelocity = normalized(desiredVelocity);
 
         // Scale the desired velocity to the maximum speed
         desiredVelocity *= MAX_SPEED;
@@ -318,7 +575,7 @@ sf::Vector2f Agent::seek(const sf::Vector2f& target, float dt)
         sf::Vector2f steering = (desiredVelocity - m_velocity);
 
         // Normalize the steering force and scale it to the maximum force
-        steering = normalize(steering);
+        steering = normalized(steering);
         steering *= MAX_FORCE;
 
         // Apply dt to scale the steering force according to the frame time
@@ -355,16 +612,23 @@ sf::Vector2f Agent::evade(const sf::Vector2f& targetPos, const sf::Vector2f& tar
 sf::Vector2f Agent::wander(float dt)
 {
     // Normalize the velocity to find the forward direction
-    sf::Vector2f direction = normalize(m_velocity);
+    sf::Vector2f direction = normalized(m_velocity);
 
     // Calculate the center of the circle in front of the agent
     sf::Vector2f center = m_pos + direction;
 
-    wdelta += static_cast<float>(rand()) / RAND_MAX * 0.25 * WANDERNOICE - 0.125 * WANDERNOICE;
+    wdelta += agentRandom(m_seed, m_id, m_randomTick, RandomStream::Wander, m_wanderDraws++) * 0.25 * WANDERNOICE - 0.125 * WANDERNOICE;
 
     // Calculate the offset from the center using the random angle
-    float x = std::cos(wdelta);
-    float y = std::sin(wdelta);
+    float x;
+    float y;
+    if (m_fastMath) {
+        fastSinCos(wdelta, y, x);
+    }
+    else {
+        x = std::cos(wdelta);
+        y = std::sin(wdelta);
+    }
     sf::Vector2f offset(x, y);
 
     // Calculate the new target position
@@ -378,11 +642,11 @@ sf::Vector2f Agent::arrival(const sf::Vector2f& target, float dt)
 {
     // Calculate desired velocity
     sf::Vector2f desiredVelocity = target - m_pos;
-    float distance = vectorMagnitude(desiredVelocity);
+    float distance = magnitude(desiredVelocity);
 
     // Check if the distance is greater than zero to avoid division by zero
     if (distance > 0) {
-        desiredVelocity = normalize(desiredVelocity);
+        desiredVelocity = normalized(desiredVelocity);
 
         if (distance < ARRIVAL_RADIUS)
         {
@@ -397,7 +661,7 @@ sf::Vector2f Agent::arrival(const sf::Vector2f& target, float dt)
         sf::Vector2f steering = desiredVelocity - m_velocity;
 
         // Normalize the steering force and scale it to the maximum force
-        steering = normalize(steering);
+        steering = normalized(steering);
         steering *= MAX_FORCE;
 
         // Apply dt to scale the steering force according to the frame time
@@ -411,19 +675,23 @@ sf::Vector2f Agent::arrival(const sf::Vector2f& target, float dt)
     }
 }
 
-sf::Vector2f Agent::obstacleAvoidance(const std::vector<std::unique_ptr<Obstacle>>& obstacles, float dt)
+sf::Vector2f Agent::obstacleAvoidance(const ObstacleTable& obstacles, float dt)
 {
     sf::Vector2f avoidanceForce(0.0f, 0.0f);
     int count = 0;
 
-    for (const auto& obstacle : obstacles) {
-        sf::Vector2f toObstacle = obstacle->getPosition() - m_pos;
-        float distance = vectorMagnitude(toObstacle);
+    const float* centerX = obstacles.getCenterX();
+    const float* centerY = obstacles.getCenterY();
+    const float* radius = obstacles.getRadius();
+
+    for (unsigned int i = 0; i < obstacles.size(); ++i) {
+        sf::Vector2f toObstacle(centerX[i] - m_pos.x, centerY[i] - m_pos.y);
+        float reach = radius[i] + AVOIDANCE_DISTANCE;
 
-        // Check if the obstacle is in the path of the agent
-        if (distance < obstacle->getRadius() + AVOIDANCE_DISTANCE) {
+        // Check if the obstacle is in the path of the agent, compared squared so obstacles out of reach cost no square root
+        if (vectorDotProduct(toObstacle, toObstacle) < reach * reach) {
             // Calculate a force to steer away from the obstacle
-            sf::Vector2f steerAway = normalize(toObstacle) * -1.0f;
+            sf::Vector2f steerAway = normalized(toObstacle) * -1.0f;
             avoidanceForce += steerAway;
             count++;
         }
@@ -431,7 +699,7 @@ sf::Vector2f Agent::obstacleAvoidance(const std::vector<std::unique_ptr<Obstacle
 
     if (count > 0) {
         avoidanceForce /= static_cast<float>(count);
-        avoidanceForce = normalize(avoidanceForce) * MAX_FORCE;
+        avoidanceForce = normalized(avoidanceForce) * MAX_FORCE;
     }
 
     return avoidanceForce * dt;
@@ -444,7 +712,7 @@ sf::Vector2f Agent::followingLeader(float dt)
     if (m_agentToFollow != nullptr) {
         // Calculate the behind point from the leader
         sf::Vector2f toLeader = m_agentToFollow->getPosition() - this->getPosition();
-        sf::Vector2f behindPoint = m_agentToFollow->getPosition() - normalize(m_agentToFollow->getVelocity()) * LEADER_BEHIND_DIST;
+        sf::Vector2f behindPoint = m_agentToFollow->getPosition() - normalized(m_agentToFollow->getVelocity()) * LEADER_BEHIND_DIST;
 
         // Use the arrival function to move towards the behind point
         followingForce += arrival(behindPoint, dt);
@@ -465,7 +733,7 @@ sf::Vector2f Agent::queueing(float dt)
     if (m_agentToFollow != nullptr) {
         sf::Vector2f frontAgentPos = m_agentToFollow->getPosition();
         sf::Vector2f toFrontAgent = frontAgentPos - m_pos;
-        float distance = vectorMagnitude(toFrontAgent);
+        float distance = magnitude(toFrontAgent);
 
         if (distance > QUEUE_DISTANCE) {
             queueingForce = seek(frontAgentPos, dt);
@@ -479,13 +747,7 @@ sf::Vector2f Agent::queueing(float dt)
     return queueingForce;
 }
 
-sf::Vector2f Agent::wallFollowing(const std::vector<std::unique_ptr<Obstacle>>& obstacles, float dt) {
-    // Extract center points from obstacles
-    std::vector<sf::Vector2f> points;
-    for (const auto& obstacle : obstacles) {
-        points.push_back(obstacle->getPosition());
-    }
-
+sf::Vector2f Agent::wallFollowing(const ObstacleTable& obstacles, float dt) {
     // Cast rays to the left and right
     sf::Vector2f leftRayDirection = sf::Vector2f(-m_velocity.y, m_velocity.x); // Perpendicular to velocity
     sf::Vector2f rightRayDirection = sf::Vector2f(m_velocity.y, -m_velocity.x); // Perpendicular to velocity
@@ -495,21 +757,21 @@ sf::Vector2f Agent::wallFollowing(const std::vector<std::unique_ptr<Obstacle>>&
     bool targetFound = false;
 
     // Check for walls on the left
-    if (castRay(m_pos, leftRayDirection, DETECTION_RAY_LENGTH, points, hitPoint)) {
+    if (castRay(m_pos, leftRayDirection, DETECTION_RAY_LENGTH, obstacles.getCenterX(), obstacles.getCenterY(), obstacles.size(), hitPoint)) {
         float distance = vectorDistance(m_pos, hitPoint);
         if (distance < DESIRED_DISTANCE_FROM_WALL) {
             // Calculate target point to steer right
-            targetPoint = hitPoint + normalize(rightRayDirection) * DESIRED_DISTANCE_FROM_WALL;
+            targetPoint = hitPoint + normalized(rightRayDirection) * DESIRED_DISTANCE_FROM_WALL;
             targetFound = true;
         }
     }
 
     // Check for walls on the right
-    if (!targetFound && castRay(m_pos, rightRayDirection, DETECTION_RAY_LENGTH, points, hitPoint)) {
+    if (!targetFound && castRay(m_pos, rightRayDirection, DETECTION_RAY_LENGTH, obstacles.getCenterX(), obstacles.getCenterY(), obstacles.size(), hitPoint)) {
         float distance = vectorDistance(m_pos, hitPoint);
         if (distance < DESIRED_DISTANCE_FROM_WALL) {
             // Calculate target point to steer left
-            targetPoint = hitPoint + normalize(leftRayDirection) * DESIRED_DISTANCE_FROM_WALL;
+            targetPoint = hitPoint + normalized(leftRayDirection) * DESIRED_DISTANCE_FROM_WALL;
             targetFound = true;
         }
     }
@@ -12,16 +12,25 @@ Mail : theo.morris@mds.ac.nz
 
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <vector>
+#include "FastMath.h"
 #include "Math.h"
-#include "Obstacle.h"
+#include "ObstacleTable.h"
+#include "Random.h"
 
 #include <SFML/Graphics.hpp>
 
 const float NEIGHBOR_RADIUS = 500.0f;
 const float SEPARATION_RADIUS = 50.0f;
 
+// how many neighbour distances are worked out at once while gathering the flocking sums
+const unsigned int NEIGHBOR_BATCH_SIZE = 64;
+
 const float INITIAL_SPEED = 0.1f;
 const float MAX_SPEED = 0.1f;
 const float MAX_FORCE = 1.0f;
@@ -41,6 +50,21 @@ const float LEADER_BEHIND_DIST = 50.0f;
 const float DETECTION_RAY_LENGTH = 100.0f;
 const float DESIRED_DISTANCE_FROM_WALL = 40.0f;
 
+// level of detail, agents at rest that stay within SETTLE_DISTANCE for SETTLE_TICKS are put to sleep. SETTLE_SPEED sits above the
+// back and forth of MAX_FORCE at the fixed timestep, which is all that is left of the velocity once an agent stops
+const float SETTLE_DISTANCE = 2.0f;
+const float SETTLE_SPEED = 0.025f;
+
+// arrival agents slow down over ARRIVAL_RADIUS and one still closing in moves less than SETTLE_DISTANCE in SETTLE_TICKS,
+// so they also have to be this close to the target, they come to a stop a few pixels out
+const float ARRIVAL_SETTLE_DISTANCE = 5.0f;
+const unsigned int SETTLE_TICKS = 120;
+const unsigned int WAKE_CHECK_INTERVAL = 4;
+
+// level of detail, agents further than this from the focus point only update every LOD_REDUCED_INTERVAL ticks
+const float LOD_FAR_DISTANCE = 400.0f;
+const unsigned int LOD_REDUCED_INTERVAL = 4;
+
 enum class MovementBehavior {
     Seek,
     Flee,
@@ -53,20 +77,108 @@ enum class MovementBehavior {
     Queue
 };
 
-class Agent : public sf::Drawable
+const int MOVEMENT_BEHAVIOR_COUNT = 9;
+
+// Individual steering forces, declared in the order they draw from the force budget when accumulating by priority
+enum class SteeringBehavior {
+    Avoidance,
+    Separation,
+    Cohesion,
+    Alignment,
+    Seek,
+    Flee,
+    Pursuit,
+    Evade,
+    Wander,
+    Arrival,
+    Queueing,
+    FollowingLeader,
+    Count
+};
+
+const int STEERING_BEHAVIOR_COUNT = static_cast<int>(SteeringBehavior::Count);
+
+const char* steeringBehaviorName(SteeringBehavior behavior);
+
+enum class ForceAccumulation {
+    WeightedSum,    // every enabled behaviour is evaluated, summed and then clamped to MAX_FORCE
+    Prioritized     // behaviours take from MAX_FORCE * dt in priority order and the rest are skipped once it is spent
+};
+
+// Settings shared by every agent which control how the steering forces are evaluated
+struct SteeringSettings {
+    ForceAccumulation accumulation = ForceAccumulation::WeightedSum;
+
+    // how many ticks each behaviour keeps reusing its cached force for, agents are spread round robin
+    // over the interval so only 1/interval of them recalculate a given behaviour on any one tick
+    std::array<unsigned int, STEERING_BEHAVIOR_COUNT> updateIntervals = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+
+    // use the approximations in FastMath.h for normalizing and wander
+    bool fastMath = false;
+};
+
+// Update intervals used when time slicing is switched on, the neighbour sums and obstacle checks are the
+// expensive terms and still give smooth motion when refreshed every few ticks
+const std::array<unsigned int, STEERING_BEHAVIOR_COUNT> TIME_SLICED_UPDATE_INTERVALS = { 2, 4, 4, 4, 1, 1, 1, 1, 1, 1, 1, 1 };
+
+class Agent;
+class SpatialGrid;
+
+// The state an agent carries from one tick to the next, saved in world snapshots. Only fixed size fields so a
+// file of them can be used straight from memory, caches the next tick rebuilds (forces, sleep state) are left out
+struct AgentState {
+    std::uint32_t id;
+    std::uint32_t behavior;
+    std::int32_t followIndex;   // position of the followed agent in the agent list, always before this one, -1 for none
+    float positionX;
+    float positionY;
+    float velocityX;
+    float velocityY;
+    float wanderAngle;
+    std::int32_t targetPreviousX;
+    std::int32_t targetPreviousY;
+    std::uint32_t randomTick;
+    std::uint32_t wanderDraws;
+};
+
+// Everything an agent reads from the rest of the world while steering, none of it changes until the integration pass
+struct SteeringContext {
+    float deltaTime;
+    const std::vector<std::unique_ptr<Agent>>& agents;
+    const SpatialGrid& grid;
+    const ObstacleTable& obstacles;
+    sf::Vector2i target;
+    const SteeringSettings& settings;
+    unsigned int tick;
+};
+
+class Agent
 {
 private:
+    unsigned int m_id;
+    MovementBehavior m_behavior;
     Agent* m_agentToFollow;
 
-    sf::Texture m_texture;
-    sf::Sprite m_sprite;
+    // how many follow links lie between this agent and one that doesn't depend on another agent's movement
+    unsigned int m_followDepth = 0;
+
     sf::Vector2f m_pos;
     sf::Vector2f m_velocity;
-    float m_rot;
     sf::Vector2i targetPreviousPos;
 
     float wdelta;
 
+    // random numbers are drawn from this agent's own stream, keyed by the seed, id and tick
+    unsigned int m_seed;
+    unsigned int m_randomTick = 0;
+    unsigned int m_wanderDraws = 0;
+
+    // copied from the settings at the start of each steering pass, picks the exact or the approximate math
+    bool m_fastMath = false;
+
+    sf::Vector2f normalized(sf::Vector2f vector) const { return m_fastMath ? fastNormalize(vector) : normalize(vector); }
+    float magnitude(sf::Vector2f vector) const { return m_fastMath ? fastVectorMagnitude(vector) : vectorMagnitude(vector); }
+
     // init weights
     float cohesionWeight = 0.0f;
     float alignmentWeight = 0.0f;
@@ -84,21 +196,115 @@ private:
     float crowdPathFollowingWeight = 0.0f;
     float wallFollowingWeight = 0.0f;
 
+    // how many times each behaviour was skipped because the force budget was already spent
+    std::array<unsigned int, STEERING_BEHAVIOR_COUNT> m_skipCounts = {};
+
+    // last weighted force of each behaviour, reused on the ticks where a time sliced behaviour is not recalculated
+    std::array<sf::Vector2f, STEERING_BEHAVIOR_COUNT> m_cachedForces = {};
+    bool m_forcesCached = false;
+
+    // level of detail state
+    bool m_sleeping = false;
+    unsigned int m_settledTicks = 0;
+    sf::Vector2f m_settleAnchor;
+    sf::Vector2i m_sleepTarget;
+    sf::Vector2f m_sleepFollowPos;
+    unsigned int m_sleepObstacleVersion = 0;
+
+    // changes decided while steering that only take effect in the integration pass
+    bool m_sleepRequested = false;
+    bool m_wakeRequested = false;
+
+    // time and ticks sat out while running at a reduced rate, caught up on the next update
+    float m_deferredTime = 0.0f;
+    unsigned int m_deferredSteps = 0;
+
+    // how many agents the last steering pass measured the distance to while gathering neighbours, zero if it didn't gather them
+    unsigned int m_neighborCandidates = 0;
+    bool m_neighborsGathered = false;
+
+    // result of the steering pass, applied by the integration pass
+    sf::Vector2f m_steeringForce;
+    unsigned int m_steps = 1;
+    bool m_steered = false;
+
+    bool canSettle(const sf::Vector2i& target) const;
+
+    // running sums of the nearby agents used by cohesion, alignment and separation
+    struct NeighborSums {
+        bool gathered = false;
+        sf::Vector2f cohesion;
+        sf::Vector2f alignment;
+        sf::Vector2f separation;
+        int cohesionCount = 0;
+        int alignmentCount = 0;
+        int separationCount = 0;
+        unsigned int candidates = 0;
+    };
+
+    void gatherNeighbors(const SteeringContext& context, NeighborSums& neighbors) const;
+
+    float behaviorWeight(SteeringBehavior behavior) const;
+
+    // calculates the weighted force of a single behaviour, gathering the neighbour sums the first time a flocking force needs them
+    sf::Vector2f behaviorForce(SteeringBehavior behavior, const SteeringContext& context, float deltaTime, const sf::Vector2f& targetVelocity, NeighborSums& neighbors);
+
+    // returns the cached force when this agent is not in the slice recalculating the behaviour on this tick
+    sf::Vector2f slicedBehaviorForce(SteeringBehavior behavior, const SteeringContext& context, float deltaTime, const sf::Vector2f& targetVelocity, NeighborSums& neighbors);
+
+    // adds as much of the force as still fits inside the budget, returns false once the budget is spent
+    bool accumulateForce(sf::Vector2f& runningTotal, const sf::Vector2f& force, float budget) const;
+
 public:
-    Agent(int spawnPositionX, int spawnPositionY, Agent* agentInFront, MovementBehavior movementType);
+    Agent(unsigned int id, unsigned int seed, int spawnPositionX, int spawnPositionY, Agent* agentInFront, MovementBehavior movementType);
+
+    // Restores a saved agent, the follow link is set afterwards once every agent exists
+    Agent(const AgentState& state, unsigned int seed);
     ~Agent();
 
     void initializeWeights(MovementBehavior movementType);
-    void loadSprite(MovementBehavior movementType);
 
+    unsigned int getId() const { return m_id; }
+
+    // hash of the agent's position and velocity bits, summed over every agent to check runs match
+    std::uint64_t stateHash() const;
     sf::Vector2f getPosition() const { return m_pos; }
     sf::Vector2f getVelocity() const { return m_velocity; }
 
-    // Override the draw function to make the agent drawable
-    void draw(sf::RenderTarget& target, sf::RenderStates states) const;
+    // the state to save, followIndex is where the followed agent sits in the agent list
+    AgentState getState(std::int32_t followIndex) const;
+
+    MovementBehavior getBehavior() const { return m_behavior; }
+
+    Agent* getAgentToFollow() const { return m_agentToFollow; }
+
+    // follow depth, only queueing and leader following agents steer from the agent they follow
+    unsigned int getFollowDepth() const { return m_followDepth; }
+    void updateFollowDepth();
+    void setAgentToFollow(Agent* agentToFollow) { m_agentToFollow = agentToFollow; }
+
+    unsigned int getSkipCount(SteeringBehavior behavior) const { return m_skipCounts[static_cast<int>(behavior)]; }
+
+    // neighbour search work done by the last steering pass, for the benchmarks and debug text
+    bool gatheredNeighbors() const { return m_neighborsGathered; }
+    unsigned int getNeighborCandidates() const { return m_neighborCandidates; }
+
+    // level of detail, called during the steering pass apart from wake which is only safe between ticks
+    bool isSleeping() const { return m_sleeping; }
+    bool updateSettleState(const sf::Vector2i& target, unsigned int obstacleVersion);
+    bool shouldWake(const SteeringContext& context, unsigned int obstacleVersion) const;
+    void requestWake(const sf::Vector2i& target);
+    void wake(const sf::Vector2i& target);
+    void deferUpdate(float deltaTime);
+
+    // steering pass, works out the total force from the previous tick's state and only writes to this agent
+    void steer(const SteeringContext& context);
+
+    // integration pass, applies the steering force to the velocity and position
+    void integrate(const sf::Vector2u& windowSize);
 
-    // update function to update all the forces and positions of the agent
-    void update(float deltaTime, const sf::Vector2u& windowSize, const std::vector<std::unique_ptr<Agent>>& agents, const std::vector<std::unique_ptr<Obstacle>>& obstacles, const sf::Vector2i& target);
+    // picks the exact or approximate math for behaviours called outside a steering pass, steer sets it from the settings
+    void setFastMath(bool fastMath) { m_fastMath = fastMath; }
 
     // seek/flee
     sf::Vector2f seek(const sf::Vector2f& target, float dt);
@@ -115,7 +321,7 @@ public:
     sf::Vector2f arrival(const sf::Vector2f& target, float dt);
 
     // obstacle avoidance
-    sf::Vector2f obstacleAvoidance(const std::vector<std::unique_ptr<Obstacle>>& obstacles, float dt);
+    sf::Vector2f obstacleAvoidance(const ObstacleTable& obstacles, float dt);
 
     // queueing
     sf::Vector2f queueing(float dt);
@@ -124,5 +330,5 @@ public:
     sf::Vector2f followingLeader(float dt);
 
     // wall following
-    sf::Vector2f wallFollowing(const std::vector<std::unique_ptr<Obstacle>>& obstacles, float dt);
+    sf::Vector2f wallFollowing(const ObstacleTable& obstacles, float dt);
 };
\ No newline at end of file
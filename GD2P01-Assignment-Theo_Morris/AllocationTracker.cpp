@@ -0,0 +1,338 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : AllocationTracker.cpp
+Description : Implementation of the allocation tracker, global operator new and delete replaced so the heap traffic of the program can be counted by scope and traced to its call sites.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <dbghelp.h>
+#pragma comment(lib, "dbghelp.lib")
+#elif defined(__GLIBC__) || defined(__APPLE__)
+#define ALLOCATION_BACKTRACE 1
+#include <execinfo.h>
+#endif
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#define ALLOCATION_NOINLINE __declspec(noinline)
+#else
+#define ALLOCATION_NOINLINE __attribute__((noinline))
+#endif
+
+namespace
+{
+    // relaxed, nothing is ordered by them and a plain add is all they cost on top of malloc
+    std::atomic<std::uint64_t> allocationCount = 0;
+    std::atomic<bool> trackingEnabled = false;
+    std::atomic<bool> siteCaptureEnabled = false;
+    std::array<std::atomic<std::uint64_t>, ALLOCATION_SCOPE_COUNT> scopeAllocations = {};
+    std::array<std::atomic<std::uint64_t>, ALLOCATION_SCOPE_COUNT> scopeBytes = {};
+
+    thread_local int t_scope = -1;
+
+    // set while a call site is being recorded, walking the stack can allocate itself the first time
+    thread_local bool t_recordingSite = false;
+
+    std::mutex siteMutex;
+    std::array<AllocationSite, ALLOCATION_SITE_CAPACITY> sites;
+    unsigned int siteCount = 0;
+    std::uint64_t droppedSiteAllocations = 0;
+
+    // recordSite, countAllocation and allocate are kept out of line so every stack starts this many frames into the tracker
+    const unsigned int ALLOCATION_HOOK_FRAMES = 4;
+
+    ALLOCATION_NOINLINE void recordSite(int scope, std::size_t size)
+    {
+        AllocationSite site;
+        void* frames[ALLOCATION_SITE_DEPTH + ALLOCATION_HOOK_FRAMES];
+        unsigned int depth = 0;
+#ifdef _WIN32
+        depth = CaptureStackBackTrace(0, ALLOCATION_SITE_DEPTH + ALLOCATION_HOOK_FRAMES, frames, nullptr);
+#elif defined(ALLOCATION_BACKTRACE)
+        depth = static_cast<unsigned int>(backtrace(frames, ALLOCATION_SITE_DEPTH + ALLOCATION_HOOK_FRAMES));
+#endif
+        if (depth > ALLOCATION_HOOK_FRAMES) {
+            site.depth = depth - ALLOCATION_HOOK_FRAMES;
+            std::copy(frames + ALLOCATION_HOOK_FRAMES, frames + depth, site.frames.begin());
+        }
+        site.scope = scope;
+
+        std::lock_guard<std::mutex> lock(siteMutex);
+        for (unsigned int i = 0; i < siteCount; ++i) {
+            AllocationSite& existing = sites[i];
+            if (existing.scope == site.scope && existing.depth == site.depth && std::equal(site.frames.begin(), site.frames.begin() + site.depth, existing.frames.begin())) {
+                existing.allocations++;
+                existing.bytes += size;
+                return;
+            }
+        }
+
+        if (siteCount == ALLOCATION_SITE_CAPACITY) {
+            droppedSiteAllocations++;
+            return;
+        }
+        site.allocations = 1;
+        site.bytes = size;
+        sites[siteCount++] = site;
+    }
+
+    ALLOCATION_NOINLINE void countAllocation(std::size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+        int scope = t_scope;
+        if (scope < 0 || !trackingEnabled.load(std::memory_order_relaxed) || t_recordingSite) {
+            return;
+        }
+        scopeAllocations[scope].fetch_add(1, std::memory_order_relaxed);
+        scopeBytes[scope].fetch_add(size, std::memory_order_relaxed);
+
+        if (siteCaptureEnabled.load(std::memory_order_relaxed)) {
+            t_recordingSite = true;
+            recordSite(scope, size);
+            t_recordingSite = false;
+        }
+    }
+
+    ALLOCATION_NOINLINE void* allocate(std::size_t size)
+    {
+        countAllocation(size);
+        return std::malloc(size > 0 ? size : 1);
+    }
+
+    ALLOCATION_NOINLINE void* allocateAligned(std::size_t size, std::size_t alignment)
+    {
+        countAllocation(size);
+#ifdef _MSC_VER
+        return _aligned_malloc(size > 0 ? size : 1, alignment);
+#else
+        // aligned_alloc wants the size to be a multiple of the alignment
+        std::size_t rounded = (size + alignment - 1) / alignment * alignment;
+        return std::aligned_alloc(alignment, rounded > 0 ? rounded : alignment);
+#endif
+    }
+
+    void freeAligned(void* memory)
+    {
+#ifdef _MSC_VER
+        _aligned_free(memory);
+#else
+        std::free(memory);
+#endif
+    }
+}
+
+std::uint64_t getAllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+void setAllocationTracking(bool enabled)
+{
+    trackingEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool isAllocationTracking()
+{
+    return trackingEnabled.load(std::memory_order_relaxed);
+}
+
+int getAllocationScope()
+{
+    return t_scope;
+}
+
+void setAllocationScope(int scope)
+{
+    t_scope = scope >= 0 && scope < static_cast<int>(ALLOCATION_SCOPE_COUNT) ? scope : -1;
+}
+
+void takeAllocationCounts(std::array<AllocationCounts, ALLOCATION_SCOPE_COUNT>& counts)
+{
+    for (unsigned int i = 0; i < ALLOCATION_SCOPE_COUNT; ++i) {
+        counts[i].allocations = scopeAllocations[i].exchange(0, std::memory_order_relaxed);
+        counts[i].bytes = scopeBytes[i].exchange(0, std::memory_order_relaxed);
+    }
+}
+
+void setAllocationSiteCapture(bool enabled)
+{
+#ifdef ALLOCATION_BACKTRACE
+    // The first backtrace loads the unwinder, which allocates, so get that out of the way before it counts
+    if (enabled && !siteCaptureEnabled.load(std::memory_order_relaxed)) {
+        void* frame;
+        backtrace(&frame, 1);
+    }
+#endif
+    siteCaptureEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+std::uint64_t takeAllocationSites(std::vector<AllocationSite>& sitesOut)
+{
+    // Copied out first so the vector's own allocation can't be recorded while holding the lock
+    std::array<AllocationSite, ALLOCATION_SITE_CAPACITY> copy;
+    unsigned int count;
+    std::uint64_t dropped;
+    {
+        std::lock_guard<std::mutex> lock(siteMutex);
+        copy = sites;
+        count = siteCount;
+        dropped = droppedSiteAllocations;
+        siteCount = 0;
+        droppedSiteAllocations = 0;
+    }
+
+    sitesOut.assign(copy.begin(), copy.begin() + count);
+    return dropped;
+}
+
+void clearAllocationSites()
+{
+    std::lock_guard<std::mutex> lock(siteMutex);
+    siteCount = 0;
+    droppedSiteAllocations = 0;
+}
+
+void printAllocationSite(const AllocationSite& site, std::ostream& output)
+{
+#ifdef _WIN32
+    HANDLE process = GetCurrentProcess();
+    static bool symbolsLoaded = SymInitialize(process, nullptr, TRUE) != FALSE;
+
+    char symbolBuffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME];
+    SYMBOL_INFO* symbol = reinterpret_cast<SYMBOL_INFO*>(symbolBuffer);
+    for (unsigned int i = 0; i < site.depth; ++i) {
+        DWORD64 address = reinterpret_cast<DWORD64>(site.frames[i]);
+        output << "    " << site.frames[i];
+
+        symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+        symbol->MaxNameLen = MAX_SYM_NAME;
+        DWORD64 displacement = 0;
+        if (symbolsLoaded && SymFromAddr(process, address, &displacement, symbol)) {
+            output << " " << symbol->Name;
+
+            IMAGEHLP_LINE64 line = {};
+            line.SizeOfStruct = sizeof(line);
+            DWORD lineDisplacement = 0;
+            if (SymGetLineFromAddr64(process, address, &lineDisplacement, &line)) {
+                output << " " << line.FileName << ":" << line.LineNumber;
+            }
+        }
+        output << "\n";
+    }
+#elif defined(ALLOCATION_BACKTRACE)
+    // Names need the symbols exported (-rdynamic), otherwise addr2line turns the offsets into lines
+    char** symbols = backtrace_symbols(site.frames.data(), static_cast<int>(site.depth));
+    for (unsigned int i = 0; i < site.depth; ++i) {
+        output << "    " << (symbols != nullptr ? symbols[i] : "?") << "\n";
+    }
+    std::free(symbols);
+#else
+    output << "    (stacks aren't available on this platform)\n";
+#endif
+}
+
+void* operator new(std::size_t size)
+{
+    void* memory = allocate(size);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    void* memory = allocateAligned(size, static_cast<std::size_t>(alignment));
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+    freeAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+    freeAligned(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+    freeAligned(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+    freeAligned(memory);
+}
@@ -0,0 +1,109 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : AllocationTracker.h
+Description : Declaration of the allocation tracker, global operator new and delete replaced so the heap traffic of the program can be counted by scope and traced to its call sites.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// how many scopes allocations can be counted against, the frame graph uses its phase indices
+const unsigned int ALLOCATION_SCOPE_COUNT = 32;
+
+// how many distinct call sites are remembered while capturing, and how many stack frames each keeps
+const unsigned int ALLOCATION_SITE_CAPACITY = 64;
+const unsigned int ALLOCATION_SITE_DEPTH = 12;
+
+struct AllocationCounts {
+    std::uint64_t allocations = 0;
+    std::uint64_t bytes = 0;
+};
+
+// Where allocations came from, the same stack is only kept once
+struct AllocationSite {
+    std::array<void*, ALLOCATION_SITE_DEPTH> frames = {};
+    unsigned int depth = 0;
+    int scope = -1;
+    std::uint64_t allocations = 0;
+    std::uint64_t bytes = 0;
+};
+
+/***
+ * Function to get how many times operator new has been called, on any thread, since the program started.
+ * @return The number of allocations.
+ ***/
+std::uint64_t getAllocationCount();
+
+/***
+ * Function to switch on counting allocations and bytes against the scope of the allocating thread. It's off to start with,
+ * while it's off operator new only adds to the total count.
+ * @param enabled True to count by scope.
+ ***/
+void setAllocationTracking(bool enabled);
+bool isAllocationTracking();
+
+/***
+ * Function to get the scope this thread's allocations are counted against.
+ * @return The scope, -1 for none.
+ ***/
+int getAllocationScope();
+
+/***
+ * Function to set the scope this thread's allocations are counted against, the job system hands it on to the jobs a thread starts.
+ * @param scope Below ALLOCATION_SCOPE_COUNT, or -1 for none.
+ ***/
+void setAllocationScope(int scope);
+
+/***
+ * Function to copy out the allocations counted against each scope since the last call and start them again from zero.
+ * @param counts Filled with the counts of each scope.
+ ***/
+void takeAllocationCounts(std::array<AllocationCounts, ALLOCATION_SCOPE_COUNT>& counts);
+
+/***
+ * Function to switch on recording the stack of every allocation made in a scope while tracking, only meant for
+ * debugging as walking the stack is slow.
+ * @param enabled True to record the call sites.
+ ***/
+void setAllocationSiteCapture(bool enabled);
+
+/***
+ * Function to copy out the call sites recorded since the last call and forget them.
+ * @param sites Replaced with the call sites.
+ * @return How many allocations weren't recorded because every site was already taken.
+ ***/
+std::uint64_t takeAllocationSites(std::vector<AllocationSite>& sites);
+
+// Forgets the call sites recorded so far without copying them out
+void clearAllocationSites();
+
+/***
+ * Function to print a call site's stack, with function names where the platform can find them.
+ * @param site The call site.
+ * @param output Where the stack is printed, one frame to a line.
+ ***/
+void printAllocationSite(const AllocationSite& site, std::ostream& output);
+
+// Sets the allocation scope of this thread until it goes out of scope
+class AllocationScope
+{
+private:
+    int m_previous;
+
+public:
+    AllocationScope(int scope) : m_previous(getAllocationScope()) { setAllocationScope(scope); }
+    ~AllocationScope() { setAllocationScope(m_previous); }
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+};
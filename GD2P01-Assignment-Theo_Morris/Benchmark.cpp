@@ -0,0 +1,311 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : Benchmark.cpp
+Description : Implementation of the benchmarks run from the command line with --benchmark, timing parts of the simulation without opening any windows.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "Benchmark.h"
+#include "FastMath.h"
+#include "JobSystem.h"
+#include "MathBatch.h"
+#include "Random.h"
+#include "ScalingBenchmark.h"
+#include "SpatialGrid.h"
+#include "SteeringBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const sf::Vector2u BENCHMARK_WORLD_SIZE(1000, 1000);
+    const unsigned int BENCHMARK_AGENT_COUNTS[] = { 1000, 10000, 100000, 1000000 };
+
+    // roughly how many agents each measurement builds in total, small counts are repeated more to get a stable time
+    const unsigned int BENCHMARK_AGENTS_PER_MEASUREMENT = 20000000;
+
+    std::vector<sf::Vector2f> randomPositions(unsigned int count)
+    {
+        std::vector<sf::Vector2f> positions(count);
+        for (unsigned int i = 0; i < count; ++i) {
+            positions[i].x = agentRandom(DEFAULT_SIMULATION_SEED, i, 0, RandomStream::Spawn, 0) * BENCHMARK_WORLD_SIZE.x;
+            positions[i].y = agentRandom(DEFAULT_SIMULATION_SEED, i, 0, RandomStream::Spawn, 1) * BENCHMARK_WORLD_SIZE.y;
+        }
+        return positions;
+    }
+
+    // Average milliseconds per build, after one untimed build to warm the caches and size the grid's buffers
+    double timeGridBuild(SpatialGrid& grid, const std::vector<sf::Vector2f>& positions, JobSystem* jobSystem)
+    {
+        unsigned int repetitions = std::max(3u, BENCHMARK_AGENTS_PER_MEASUREMENT / static_cast<unsigned int>(positions.size()));
+
+        grid.build(positions, BENCHMARK_WORLD_SIZE, jobSystem);
+
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < repetitions; ++i) {
+            grid.build(positions, BENCHMARK_WORLD_SIZE, jobSystem);
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        return elapsed.count() / repetitions;
+    }
+
+    const unsigned int MATH_BENCHMARK_COUNT = 1000000;
+    const unsigned int MATH_BENCHMARK_REPETITIONS = 20;
+
+    // Times a function over the benchmark arrays, each repetition starts from a fresh copy so in place functions see the same input
+    template <typename Function>
+    double timeMathFunction(const std::vector<float>& x, const std::vector<float>& y, std::vector<float>& outX, std::vector<float>& outY, Function function)
+    {
+        double total = 0.0;
+        for (unsigned int i = 0; i < MATH_BENCHMARK_REPETITIONS; ++i) {
+            outX = x;
+            outY = y;
+            auto start = std::chrono::steady_clock::now();
+            function(outX.data(), outY.data());
+            total += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        }
+        return total / (static_cast<double>(MATH_BENCHMARK_REPETITIONS) * x.size());
+    }
+
+    int runMathBatchBenchmark(std::ostream& output)
+    {
+        // Vectors spread well past the world so wrapping and clamping both have work to do
+        std::vector<float> x(MATH_BENCHMARK_COUNT);
+        std::vector<float> y(MATH_BENCHMARK_COUNT);
+        for (unsigned int i = 0; i < MATH_BENCHMARK_COUNT; ++i) {
+            x[i] = (agentRandom(DEFAULT_SIMULATION_SEED, i, 0, RandomStream::Spawn, 0) - 0.25f) * 1.5f * BENCHMARK_WORLD_SIZE.x;
+            y[i] = (agentRandom(DEFAULT_SIMULATION_SEED, i, 0, RandomStream::Spawn, 1) - 0.25f) * 1.5f * BENCHMARK_WORLD_SIZE.y;
+        }
+        const float clampMagnitude = 500.0f;
+        const sf::Vector2f origin(400.0f, 600.0f);
+
+        std::vector<float> scalarX, scalarY, batchX, batchY;
+        std::vector<float> scalarDistances(MATH_BENCHMARK_COUNT);
+        std::vector<float> batchDistances(MATH_BENCHMARK_COUNT);
+
+        output << "Batch vector math over " << MATH_BENCHMARK_COUNT << " vectors";
+#ifdef MATH_BATCH_SSE2
+        output << ", SSE2\n";
+#else
+        output << ", scalar fallback\n";
+#endif
+        output << "  function          scalar ns  batch ns  speedup  matches\n";
+
+        bool allMatch = true;
+        auto report = [&](const char* name, double scalarTime, double batchTime, bool matches) {
+            char line[128];
+            std::snprintf(line, sizeof(line), "  %-16s %10.3f %9.3f  %6.2fx  %s\n", name, scalarTime, batchTime, scalarTime / batchTime, matches ? "yes" : "NO");
+            output << line;
+            allMatch = allMatch && matches;
+        };
+
+        double scalarTime = timeMathFunction(x, y, scalarX, scalarY, [&](float* vx, float* vy) {
+            for (unsigned int i = 0; i < MATH_BENCHMARK_COUNT; ++i) {
+                scalarDistances[i] = vectorDistance(origin, sf::Vector2f(vx[i], vy[i]));
+            }
+        });
+        double batchTime = timeMathFunction(x, y, batchX, batchY, [&](float* vx, float* vy) {
+            batchDistance(origin.x, origin.y, vx, vy, MATH_BENCHMARK_COUNT, batchDistances.data());
+        });
+        report("distance", scalarTime, batchTime, scalarDistances == batchDistances);
+
+        scalarTime = timeMathFunction(x, y, scalarX, scalarY, [&](float* vx, float* vy) {
+            for (unsigned int i = 0; i < MATH_BENCHMARK_COUNT; ++i) {
+                sf::Vector2f normalized = normalize(sf::Vector2f(vx[i], vy[i]));
+                vx[i] = normalized.x;
+                vy[i] = normalized.y;
+            }
+        });
+        batchTime = timeMathFunction(x, y, batchX, batchY, [&](float* vx, float* vy) {
+            batchNormalize(vx, vy, MATH_BENCHMARK_COUNT);
+        });
+        report("normalize", scalarTime, batchTime, scalarX == batchX && scalarY == batchY);
+
+        scalarTime = timeMathFunction(x, y, scalarX, scalarY, [&](float* vx, float* vy) {
+            for (unsigned int i = 0; i < MATH_BENCHMARK_COUNT; ++i) {
+                sf::Vector2f vector(vx[i], vy[i]);
+                if (vectorMagnitude(vector) > clampMagnitude) {
+                    vector = normalize(vector) * clampMagnitude;
+                }
+                vx[i] = vector.x;
+                vy[i] = vector.y;
+            }
+        });
+        batchTime = timeMathFunction(x, y, batchX, batchY, [&](float* vx, float* vy) {
+            batchClampMagnitude(vx, vy, MATH_BENCHMARK_COUNT, clampMagnitude);
+        });
+        report("clamp magnitude", scalarTime, batchTime, scalarX == batchX && scalarY == batchY);
+
+        scalarTime = timeMathFunction(x, y, scalarX, scalarY, [&](float* vx, float* vy) {
+            for (unsigned int i = 0; i < MATH_BENCHMARK_COUNT; ++i) {
+                sf::Vector2f position(vx[i], vy[i]);
+                wrapPosition(position, BENCHMARK_WORLD_SIZE);
+                vx[i] = position.x;
+                vy[i] = position.y;
+            }
+        });
+        batchTime = timeMathFunction(x, y, batchX, batchY, [&](float* vx, float* vy) {
+            batchWrapPositions(vx, vy, MATH_BENCHMARK_COUNT, BENCHMARK_WORLD_SIZE);
+        });
+        report("wrap", scalarTime, batchTime, scalarX == batchX && scalarY == batchY);
+
+        if (!allMatch) {
+            output << "Batch math does not match the scalar versions\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    // Nanoseconds per call of a function over the benchmark inputs, the results are summed so the calls can't be optimised away
+    template <typename Function>
+    double timePerCall(const std::vector<float>& inputA, const std::vector<float>& inputB, float& sink, Function function)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int repetition = 0; repetition < MATH_BENCHMARK_REPETITIONS; ++repetition) {
+            float sum = 0.0f;
+            for (size_t i = 0; i < inputA.size(); ++i) {
+                sum += function(inputA[i], inputB[i]);
+            }
+            sink += sum;
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / (static_cast<double>(MATH_BENCHMARK_REPETITIONS) * inputA.size());
+    }
+
+    int runFastMathBenchmark(std::ostream& output)
+    {
+        // Magnitudes across several orders of magnitude and angles across many turns, like a long running wander
+        std::vector<float> a(MATH_BENCHMARK_COUNT);
+        std::vector<float> b(MATH_BENCHMARK_COUNT);
+        for (unsigned int i = 0; i < MATH_BENCHMARK_COUNT; ++i) {
+            a[i] = (agentRandom(DEFAULT_SIMULATION_SEED, i, 0, RandomStream::Spawn, 0) - 0.5f) * 2000.0f;
+            b[i] = (agentRandom(DEFAULT_SIMULATION_SEED, i, 0, RandomStream::Spawn, 1) - 0.5f) * 2000.0f;
+        }
+
+        double inverseSqrtError = 0.0;
+        double atan2Error = 0.0;
+        double sinCosError = 0.0;
+        for (unsigned int i = 0; i < MATH_BENCHMARK_COUNT; ++i) {
+            double squared = static_cast<double>(a[i]) * a[i] + static_cast<double>(b[i]) * b[i];
+            float squaredFloat = static_cast<float>(squared);
+            if (squaredFloat > 0.0f) {
+                double exact = 1.0 / std::sqrt(static_cast<double>(squaredFloat));
+                inverseSqrtError = std::max(inverseSqrtError, std::abs(fastInverseSqrt(squaredFloat) - exact) / exact);
+            }
+
+            double angle = std::atan2(static_cast<double>(b[i]), static_cast<double>(a[i]));
+            atan2Error = std::max(atan2Error, std::abs(fastAtan2(b[i], a[i]) - angle));
+
+            float sine;
+            float cosine;
+            fastSinCos(a[i], sine, cosine);
+            sinCosError = std::max(sinCosError, std::abs(sine - std::sin(static_cast<double>(a[i]))));
+            sinCosError = std::max(sinCosError, std::abs(cosine - std::cos(static_cast<double>(a[i]))));
+        }
+
+        float sink = 0.0f;
+        double stdInverseSqrt = timePerCall(a, b, sink, [](float x, float y) { return 1.0f / std::sqrt(x * x + y * y + 1.0f); });
+        double fastInverse = timePerCall(a, b, sink, [](float x, float y) { return fastInverseSqrt(x * x + y * y + 1.0f); });
+        double stdAtan2 = timePerCall(a, b, sink, [](float x, float y) { return std::atan2(y, x); });
+        double fastArcTangent = timePerCall(a, b, sink, [](float x, float y) { return fastAtan2(y, x); });
+        double stdSinCos = timePerCall(a, b, sink, [](float x, float) { return std::sin(x) + std::cos(x); });
+        double fastSineCosine = timePerCall(a, b, sink, [](float x, float) {
+            float sine;
+            float cosine;
+            fastSinCos(x, sine, cosine);
+            return sine + cosine;
+        });
+
+        output << "Fast math over " << MATH_BENCHMARK_COUNT << " inputs\n";
+        output << "  function     std ns   fast ns  speedup  max error\n";
+
+        char line[128];
+        std::snprintf(line, sizeof(line), "  rsqrt     %8.3f  %8.3f  %6.2fx  %.2e relative\n", stdInverseSqrt, fastInverse, stdInverseSqrt / fastInverse, inverseSqrtError);
+        output << line;
+        std::snprintf(line, sizeof(line), "  atan2     %8.3f  %8.3f  %6.2fx  %.2e radians\n", stdAtan2, fastArcTangent, stdAtan2 / fastArcTangent, atan2Error);
+        output << line;
+        std::snprintf(line, sizeof(line), "  sincos    %8.3f  %8.3f  %6.2fx  %.2e\n", stdSinCos, fastSineCosine, stdSinCos / fastSineCosine, sinCosError);
+        output << line;
+
+        // printing the sink keeps the timed loops from being removed
+        output << "  (checksum " << sink << ")\n";
+
+        // Fail if an approximation has drifted past its documented error
+        if (inverseSqrtError > 5e-6 || atan2Error > 2.5e-6 || sinCosError > 1e-7) {
+            output << "Fast math error is larger than documented in FastMath.h\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    int runGridBenchmark(std::ostream& output)
+    {
+        unsigned int workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        JobSystem jobSystem(workerCount);
+
+        output << "Spatial grid build, " << workerCount + 1 << " threads, cell size " << GRID_CELL_SIZE << "\n";
+        output << "    agents   serial ms  parallel ms  speedup\n";
+
+        bool matches = true;
+        for (unsigned int count : BENCHMARK_AGENT_COUNTS) {
+            std::vector<sf::Vector2f> positions = randomPositions(count);
+
+            SpatialGrid serialGrid(GRID_CELL_SIZE);
+            SpatialGrid parallelGrid(GRID_CELL_SIZE);
+            double serialTime = timeGridBuild(serialGrid, positions, nullptr);
+            double parallelTime = timeGridBuild(parallelGrid, positions, &jobSystem);
+
+            // The parallel build has to give exactly the same order as the serial one
+            matches = matches && serialGrid.getAgentIndices() == parallelGrid.getAgentIndices()
+                && std::equal(serialGrid.getCellStarts(), serialGrid.getCellStarts() + serialGrid.getCellCount() + 1, parallelGrid.getCellStarts());
+
+            char line[128];
+            std::snprintf(line, sizeof(line), "%10u  %10.3f  %11.3f  %7.2fx\n", count, serialTime, parallelTime, serialTime / parallelTime);
+            output << line;
+        }
+
+        if (!matches) {
+            output << "Parallel build does not match the serial build\n";
+            return 1;
+        }
+        return 0;
+    }
+}
+
+int runBenchmark(const std::string& name, const std::vector<std::string>& arguments, std::ostream& output)
+{
+    if (name == "grid") {
+        return runGridBenchmark(output);
+    }
+    if (name == "mathbatch") {
+        return runMathBatchBenchmark(output);
+    }
+    if (name == "fastmath") {
+        return runFastMathBenchmark(output);
+    }
+    if (name == "steering") {
+        return runSteeringBenchmark(output);
+    }
+    if (name == "scaling") {
+        std::string resultsPath = arguments.size() >= 1 ? arguments[0] : SCALING_RESULTS_PATH;
+        std::string baselinePath = arguments.size() >= 2 ? arguments[1] : SCALING_BASELINE_PATH;
+        unsigned int maxAgents = arguments.size() >= 3 ? static_cast<unsigned int>(std::stoul(arguments[2])) : UINT_MAX;
+        return runScalingBenchmark(resultsPath, baselinePath, maxAgents, output);
+    }
+
+    output << "Unknown benchmark: " << name << "\n";
+    output << "Benchmarks: grid, mathbatch, fastmath, steering, scaling\n";
+    return 1;
+}
@@ -0,0 +1,27 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : Benchmark.h
+Description : Declaration of the benchmarks run from the command line with --benchmark, timing parts of the simulation without opening any windows.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/***
+ * Function to run a benchmark by name and print the results.
+ * @param name The benchmark to run, "grid" times the serial and parallel spatial grid builds, "mathbatch" the scalar and batch vector math, "fastmath" the std and approximate functions,
+ * "steering" each steering behaviour and vector helper in cycles per call, "scaling" the whole simulation on canonical scenes.
+ * @param arguments The rest of the command line, "scaling" takes [results.json] [baseline.json] [max agents].
+ * @param output Where the results are printed.
+ * @return The exit code for the program, non zero if the benchmark doesn't exist or failed.
+ ***/
+int runBenchmark(const std::string& name, const std::vector<std::string>& arguments, std::ostream& output);
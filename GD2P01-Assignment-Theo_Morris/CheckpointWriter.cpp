@@ -0,0 +1,133 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : CheckpointWriter.cpp
+Description : Implementation of the CheckpointWriter class, which writes world snapshots to disk on a background thread while the simulation keeps running.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "CheckpointWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace
+{
+    // Swaps the new file in over the old one in a single step, so there is always a whole checkpoint on disk
+    bool replaceFile(const std::string& source, const std::string& destination)
+    {
+#ifdef _WIN32
+        return MoveFileExA(source.c_str(), destination.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+#else
+        return std::rename(source.c_str(), destination.c_str()) == 0;
+#endif
+    }
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& path) : m_path(path)
+{
+    m_thread = std::thread(&CheckpointWriter::writerLoop, this);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_condition.notify_one();
+    m_thread.join();
+}
+
+WorldSnapshotBuffer* CheckpointWriter::acquire()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (WorldSnapshotBuffer& buffer : m_buffers) {
+        if (&buffer != m_pending && &buffer != m_writing) {
+            return &buffer;
+        }
+    }
+    return nullptr;
+}
+
+void CheckpointWriter::submit(WorldSnapshotBuffer* buffer, float stallMilliseconds)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending = buffer;
+        m_pendingStallMilliseconds = stallMilliseconds;
+        m_stats.lastStallMilliseconds = stallMilliseconds;
+        m_stats.maxStallMilliseconds = std::max(m_stats.maxStallMilliseconds, stallMilliseconds);
+    }
+    m_condition.notify_one();
+}
+
+void CheckpointWriter::skip()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.skipped++;
+}
+
+CheckpointStats CheckpointWriter::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void CheckpointWriter::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_condition.wait(lock, [this]() { return m_pending != nullptr || !m_running; });
+        if (m_pending == nullptr) {
+            return;
+        }
+
+        m_writing = m_pending;
+        m_pending = nullptr;
+        float stallMilliseconds = m_pendingStallMilliseconds;
+        lock.unlock();
+
+        // Written beside the last checkpoint and renamed over it, so a crash or failed write never loses the last good checkpoint
+        auto writeStart = std::chrono::steady_clock::now();
+        std::string temporaryPath = m_path + ".tmp";
+        std::string error;
+        bool written = m_writing->write(temporaryPath, error);
+        if (written && !replaceFile(temporaryPath, m_path)) {
+            error = "Failed to replace '" + m_path + "'";
+            written = false;
+        }
+        float writeMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - writeStart).count();
+
+        if (written) {
+            const WorldSnapshotHeader& header = m_writing->header();
+            std::cout << "Checkpoint at tick " << header.tick << ": " << header.agentCount << " agents, " << m_writing->size() << " bytes, "
+                << stallMilliseconds << "ms stall on the simulation thread, written in " << writeMilliseconds << "ms\n";
+        }
+        else {
+            std::cerr << error << std::endl;
+        }
+
+        lock.lock();
+        m_writing = nullptr;
+        if (written) {
+            m_stats.written++;
+            m_stats.lastWriteMilliseconds = writeMilliseconds;
+        }
+        else {
+            m_stats.failed++;
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : CheckpointWriter.h
+Description : Declaration of the CheckpointWriter class, which writes world snapshots to disk on a background thread while the simulation keeps running.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "WorldSnapshot.h"
+
+// where the periodic checkpoints are written, each one replaces the last
+const char* const CHECKPOINT_PATH = "checkpoint.snapshot";
+
+struct CheckpointStats {
+    unsigned int written = 0;
+    unsigned int skipped = 0;
+    unsigned int failed = 0;
+
+    // time the simulation thread spent copying the world into the buffer, and the time the write took on the background thread
+    float lastStallMilliseconds = 0.0f;
+    float maxStallMilliseconds = 0.0f;
+    float lastWriteMilliseconds = 0.0f;
+};
+
+// Two snapshot buffers are handed back and forth, the simulation thread fills one while the other is being written.
+// When both are busy the checkpoint is skipped rather than waiting, so the simulation never blocks on the disk
+class CheckpointWriter
+{
+private:
+    std::string m_path;
+    std::array<WorldSnapshotBuffer, 2> m_buffers;
+
+    // the buffer waiting to be written and the one being written, nullptr when there isn't one
+    WorldSnapshotBuffer* m_pending = nullptr;
+    WorldSnapshotBuffer* m_writing = nullptr;
+    float m_pendingStallMilliseconds = 0.0f;
+
+    CheckpointStats m_stats;
+
+    bool m_running = true;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::thread m_thread;
+
+    void writerLoop();
+
+public:
+    CheckpointWriter(const std::string& path);
+
+    // Writes any checkpoint still waiting before the thread stops
+    ~CheckpointWriter();
+
+    // A buffer that isn't pending or being written, nullptr when both are in use and the checkpoint should be skipped
+    WorldSnapshotBuffer* acquire();
+
+    /***
+     * Hands a filled buffer from acquire to the background thread to be written.
+     * @param buffer The buffer to write.
+     * @param stallMilliseconds How long the simulation thread spent filling it, reported with the write.
+     ***/
+    void submit(WorldSnapshotBuffer* buffer, float stallMilliseconds);
+
+    // Counts a checkpoint that was due but had no free buffer
+    void skip();
+
+    CheckpointStats getStats() const;
+};
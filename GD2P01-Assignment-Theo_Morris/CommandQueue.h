@@ -0,0 +1,100 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : CommandQueue.h
+Description : Declaration of the CommandQueue class, a bounded lock-free queue that many threads can push into and a single thread drains.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+template <typename T, size_t Capacity>
+class CommandQueue
+{
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "CommandQueue capacity must be a power of two");
+
+    // each cell's sequence says whose turn it is, the producer claiming that position or the consumer reading it
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    Cell m_cells[Capacity];
+
+    // kept on separate cache lines so producers claiming slots don't slow down the consumer
+    alignas(64) std::atomic<size_t> m_enqueuePos{ 0 };
+    alignas(64) size_t m_dequeuePos = 0;
+
+public:
+    CommandQueue()
+    {
+        for (size_t i = 0; i < Capacity; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /***
+     * Adds a command to the queue, safe to call from any number of threads at once.
+     * @param value The command to add.
+     * @return False if the queue is full and the command was dropped.
+     ***/
+    bool push(const T& value)
+    {
+        Cell* cell;
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &m_cells[pos & (Capacity - 1)];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+            if (difference == 0) {
+                // The cell is free, try to claim this position
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (difference < 0) {
+                // The consumer has not read this cell yet so the queue is full
+                return false;
+            }
+            else {
+                // Another producer claimed the position first
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /***
+     * Takes the oldest command off the queue, must only be called from the single consuming thread.
+     * @param value Receives the command.
+     * @return False if the queue is empty.
+     ***/
+    bool pop(T& value)
+    {
+        Cell& cell = m_cells[m_dequeuePos & (Capacity - 1)];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(m_dequeuePos + 1) < 0) {
+            return false;
+        }
+
+        value = cell.data;
+
+        // Hand the cell back to the producers for the next time round the ring
+        cell.sequence.store(m_dequeuePos + Capacity, std::memory_order_release);
+        m_dequeuePos++;
+        return true;
+    }
+};
@@ -0,0 +1,108 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : FastMath.h
+Description : Fast approximations of the square root, atan2, sin and cos used by the steering when fast math is switched on.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "Math.h"
+
+// The approximations are branch free so loops over them vectorise, and only use plain float
+// arithmetic so they give the same bits on every CPU, unlike the hardware reciprocal square root
+
+/***
+ * Function to approximate 1 / sqrt(value) from the exponent trick and two Newton steps.
+ * Max relative error 4.7e-6 for normal positive floats.
+ * @param value The value, must be greater than zero.
+ * @return The approximate reciprocal square root.
+ ***/
+inline float fastInverseSqrt(float value)
+{
+    float estimate = std::bit_cast<float>(0x5F375A86u - (std::bit_cast<std::uint32_t>(value) >> 1));
+    float halfValue = 0.5f * value;
+    estimate = estimate * (1.5f - halfValue * estimate * estimate);
+    estimate = estimate * (1.5f - halfValue * estimate * estimate);
+    return estimate;
+}
+
+/***
+ * Function to approximate the magnitude of a vector, max relative error 4.7e-6.
+ * @param vector The vector whose magnitude is to be calculated.
+ * @return The approximate magnitude, zero for a zero vector.
+ ***/
+inline float fastVectorMagnitude(sf::Vector2f vector)
+{
+    float squared = vector.x * vector.x + vector.y * vector.y;
+    return squared > 0.0f ? squared * fastInverseSqrt(squared) : 0.0f;
+}
+
+/***
+ * Function to approximately normalize a vector, the length is within 4.7e-6 of 1.
+ * @param vector The vector to normalize.
+ * @return The normalized vector, or a zero vector if the vector has no length.
+ ***/
+inline sf::Vector2f fastNormalize(sf::Vector2f vector)
+{
+    float squared = vector.x * vector.x + vector.y * vector.y;
+    float scale = squared > 0.0f ? fastInverseSqrt(squared) : 0.0f;
+    return vector * scale;
+}
+
+/***
+ * Function to approximate atan2 with a polynomial on [0, 1] and reflecting into the right octant.
+ * Max absolute error 2.0e-6 radians (0.0001 degrees).
+ * @param y The y component.
+ * @param x The x component.
+ * @return The approximate angle in radians, in [-PI, PI].
+ ***/
+inline float fastAtan2(float y, float x)
+{
+    float absX = std::fabs(x);
+    float absY = std::fabs(y);
+    float largest = std::max(absX, absY);
+    float ratio = largest > 0.0f ? std::min(absX, absY) / largest : 0.0f;
+
+    float squared = ratio * ratio;
+    float angle = ratio * (0.99997726f + squared * (-0.33262347f + squared * (0.19354346f + squared * (-0.11643287f + squared * (0.05265332f + squared * -0.01172120f)))));
+
+    angle = absY > absX ? 0.5f * PI - angle : angle;
+    angle = x < 0.0f ? PI - angle : angle;
+    return y < 0.0f ? -angle : angle;
+}
+
+/***
+ * Function to approximate sin and cos of the same angle together, reducing the angle to [-PI/4, PI/4] and using
+ * polynomials there. Max absolute error 9.3e-8 for angles within +-8192 radians, larger angles lose precision.
+ * @param angle The angle in radians.
+ * @param sine Set to the approximate sin of the angle.
+ * @param cosine Set to the approximate cos of the angle.
+ ***/
+inline void fastSinCos(float angle, float& sine, float& cosine)
+{
+    // Which quarter turn the angle is nearest to, subtracted in three parts so the remainder stays accurate
+    float quadrant = std::nearbyint(angle * (2.0f / PI));
+    float reduced = ((angle - quadrant * 1.5703125f) - quadrant * 4.837512969970703125e-4f) - quadrant * 7.54978995489188216e-8f;
+
+    float squared = reduced * reduced;
+    float sinReduced = reduced + reduced * squared * (-1.6666654611e-1f + squared * (8.3321608736e-3f + squared * -1.9515295891e-4f));
+    float cosReduced = 1.0f - 0.5f * squared + squared * squared * (4.166664568298827e-2f + squared * (-1.388731625493765e-3f + squared * 2.443315711809948e-5f));
+
+    // Rotate the result back by the quarter turns taken off
+    int turns = static_cast<int>(quadrant) & 3;
+    float sinResult = (turns & 1) ? cosReduced : sinReduced;
+    float cosResult = (turns & 1) ? sinReduced : cosReduced;
+    sine = (turns & 2) ? -sinResult : sinResult;
+    cosine = ((turns + 1) & 2) ? -cosResult : cosResult;
+}
@@ -0,0 +1,200 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : FrameGraph.cpp
+Description : Implementation of the FrameGraph class, which orders the phases of a frame from what they read and write and runs independent phases at the same time.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "FrameGraph.h"
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    long long nowNanoseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    double toMilliseconds(long long nanoseconds)
+    {
+        return nanoseconds / 1000000.0;
+    }
+}
+
+FrameGraph::FrameGraph()
+{
+}
+
+FrameGraph::~FrameGraph()
+{
+}
+
+unsigned int FrameGraph::addPhase(const char* name, ResourceSet reads, ResourceSet writes, std::function<void()> function)
+{
+    Phase phase;
+    phase.name = name;
+    phase.reads = reads;
+    phase.writes = writes;
+    phase.function = std::move(function);
+    m_phases.push_back(std::move(phase));
+    return static_cast<unsigned int>(m_phases.size() - 1);
+}
+
+void FrameGraph::compile()
+{
+    m_levels.clear();
+
+    for (unsigned int later = 0; later < m_phases.size(); ++later) {
+        Phase& phase = m_phases[later];
+        phase.dependencies.clear();
+        phase.level = 0;
+
+        for (unsigned int earlier = 0; earlier < later; ++earlier) {
+            const Phase& other = m_phases[earlier];
+
+            // Read after write, write after read and write after write all have to keep their order
+            bool conflicts = (other.writes & (phase.reads | phase.writes)) != 0 || (other.reads & phase.writes) != 0;
+            if (conflicts) {
+                phase.dependencies.push_back(earlier);
+                phase.level = std::max(phase.level, other.level + 1);
+            }
+        }
+
+        if (phase.level >= m_levels.size()) {
+            m_levels.resize(phase.level + 1);
+        }
+        m_levels[phase.level].push_back(later);
+    }
+}
+
+void FrameGraph::runPhase(unsigned int index)
+{
+    Phase& phase = m_phases[index];
+    AllocationScope allocationScope(static_cast<int>(index));
+    phase.start = nowNanoseconds();
+    phase.function();
+    phase.end = nowNanoseconds();
+}
+
+void FrameGraph::execute(JobSystem& jobSystem)
+{
+    m_frameStart = nowNanoseconds();
+
+    for (const std::vector<unsigned int>& level : m_levels) {
+        if (level.size() == 1) {
+            runPhase(level.front());
+            continue;
+        }
+
+        // Independent phases are handed out one per job so idle workers can pick them up
+        auto runPhases = [&](unsigned int begin, unsigned int end) {
+            for (unsigned int i = begin; i < end; ++i) {
+                runPhase(level[i]);
+            }
+        };
+        jobSystem.parallelFor(0, static_cast<unsigned int>(level.size()), 1, nullptr, 0, runPhases);
+    }
+
+    m_frameEnd = nowNanoseconds();
+
+    if (isAllocationTracking()) {
+        std::array<AllocationCounts, ALLOCATION_SCOPE_COUNT> counts;
+        takeAllocationCounts(counts);
+        for (unsigned int i = 0; i < m_phases.size(); ++i) {
+            m_phases[i].allocations = i < ALLOCATION_SCOPE_COUNT ? counts[i].allocations : 0;
+            m_phases[i].allocatedBytes = i < ALLOCATION_SCOPE_COUNT ? counts[i].bytes : 0;
+        }
+    }
+}
+
+void FrameGraph::printCriticalPath(std::ostream& out) const
+{
+    if (m_phases.empty()) {
+        return;
+    }
+
+    // Longest chain of phase durations through the dependencies, phases are already in dependency order
+    std::vector<long long> pathLength(m_phases.size(), 0);
+    std::vector<int> previous(m_phases.size(), -1);
+    unsigned int last = 0;
+
+    for (unsigned int i = 0; i < m_phases.size(); ++i) {
+        const Phase& phase = m_phases[i];
+        for (unsigned int dependency : phase.dependencies) {
+            if (pathLength[dependency] > pathLength[i]) {
+                pathLength[i] = pathLength[dependency];
+                previous[i] = static_cast<int>(dependency);
+            }
+        }
+        pathLength[i] += phase.end - phase.start;
+
+        if (pathLength[i] > pathLength[last]) {
+            last = i;
+        }
+    }
+
+    std::vector<unsigned int> path;
+    for (int i = static_cast<int>(last); i >= 0; i = previous[i]) {
+        path.push_back(static_cast<unsigned int>(i));
+    }
+    std::reverse(path.begin(), path.end());
+
+    out << "Critical path:";
+    for (unsigned int i : path) {
+        out << " " << m_phases[i].name << " (" << toMilliseconds(m_phases[i].end - m_phases[i].start) << "ms)";
+        if (i != path.back()) {
+            out << " ->";
+        }
+    }
+    out << "\n  path " << toMilliseconds(pathLength[last]) << "ms of a " << toMilliseconds(m_frameEnd - m_frameStart) << "ms frame\n";
+}
+
+std::uint64_t FrameGraph::getFrameAllocations() const
+{
+    std::uint64_t allocations = 0;
+    for (const Phase& phase : m_phases) {
+        allocations += phase.allocations;
+    }
+    return allocations;
+}
+
+std::uint64_t FrameGraph::getFrameAllocatedBytes() const
+{
+    std::uint64_t bytes = 0;
+    for (const Phase& phase : m_phases) {
+        bytes += phase.allocatedBytes;
+    }
+    return bytes;
+}
+
+const char* FrameGraph::getHeaviestAllocatingPhase() const
+{
+    const Phase* heaviest = nullptr;
+    for (const Phase& phase : m_phases) {
+        if (phase.allocations > 0 && (heaviest == nullptr || phase.allocations > heaviest->allocations)) {
+            heaviest = &phase;
+        }
+    }
+    return heaviest != nullptr ? heaviest->name : nullptr;
+}
+
+void FrameGraph::printAllocations(std::ostream& out) const
+{
+    out << "Allocations:";
+    bool any = false;
+    for (const Phase& phase : m_phases) {
+        if (phase.allocations > 0) {
+            out << " " << phase.name << " " << phase.allocations << " (" << phase.allocatedBytes << " bytes)";
+            any = true;
+        }
+    }
+    out << (any ? "\n" : " none\n");
+}
@@ -0,0 +1,90 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : FrameGraph.h
+Description : Declaration of the FrameGraph class, which orders the phases of a frame from what they read and write and runs independent phases at the same time.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <vector>
+#include "JobSystem.h"
+
+// bit set of the resources a phase reads or writes, the meaning of each bit is up to the owner of the graph
+typedef unsigned int ResourceSet;
+
+class FrameGraph
+{
+private:
+    struct Phase {
+        const char* name;
+        ResourceSet reads;
+        ResourceSet writes;
+        std::function<void()> function;
+
+        // earlier phases this one has to wait for, and how many dependency levels deep it sits
+        std::vector<unsigned int> dependencies;
+        unsigned int level = 0;
+
+        // timings from the last execute, in nanoseconds
+        long long start = 0;
+        long long end = 0;
+
+        // heap allocations made by the phase and its jobs in the last execute, only counted while allocation tracking is on
+        std::uint64_t allocations = 0;
+        std::uint64_t allocatedBytes = 0;
+    };
+
+    std::vector<Phase> m_phases;
+
+    // phases grouped by level, every phase in a level only depends on phases in earlier levels
+    std::vector<std::vector<unsigned int>> m_levels;
+
+    long long m_frameStart = 0;
+    long long m_frameEnd = 0;
+
+    void runPhase(unsigned int index);
+
+public:
+    FrameGraph();
+    ~FrameGraph();
+
+    /***
+     * Adds a phase to the end of the frame, it will run after any earlier phase it conflicts with.
+     * @param name Shown when printing the critical path.
+     * @param reads The resources the phase reads.
+     * @param writes The resources the phase writes.
+     * @param function The work of the phase, it can use the job system itself.
+     * @return The index of the phase.
+     ***/
+    unsigned int addPhase(const char* name, ResourceSet reads, ResourceSet writes, std::function<void()> function);
+
+    // Works out the dependencies between the phases, call once after adding them all
+    void compile();
+
+    // Runs one frame, phases in the same level run at the same time across the job system
+    void execute(JobSystem& jobSystem);
+
+    // Prints the chain of phases that decided how long the last frame took
+    void printCriticalPath(std::ostream& out) const;
+
+    // Allocations of the last frame, each phase counts against its own index as the allocation scope
+    std::uint64_t getFrameAllocations() const;
+    std::uint64_t getFrameAllocatedBytes() const;
+
+    // The phase that allocated the most in the last frame, nullptr if none did
+    const char* getHeaviestAllocatingPhase() const;
+
+    // Prints the allocations of each phase that allocated in the last frame
+    void printAllocations(std::ostream& out) const;
+
+    const char* getPhaseName(unsigned int index) const { return index < m_phases.size() ? m_phases[index].name : "none"; }
+};
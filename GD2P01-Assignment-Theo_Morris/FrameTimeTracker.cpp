@@ -0,0 +1,57 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : FrameTimeTracker.cpp
+Description : Implementation of the FrameTimeTracker class, which keeps the most recent frame times and works out their percentiles for the performance HUD.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "FrameTimeTracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+FrameTimeTracker::FrameTimeTracker()
+{
+}
+
+FrameTimeTracker::~FrameTimeTracker()
+{
+}
+
+void FrameTimeTracker::add(float milliseconds)
+{
+    m_samples[m_next] = milliseconds;
+    m_next = (m_next + 1) % FRAME_TIME_WINDOW;
+    m_count = std::min(m_count + 1, FRAME_TIME_WINDOW);
+}
+
+void FrameTimeTracker::clear()
+{
+    m_next = 0;
+    m_count = 0;
+}
+
+void FrameTimeTracker::getPercentiles(FrameTimePercentiles& percentiles)
+{
+    if (m_count == 0) {
+        percentiles = FrameTimePercentiles();
+        return;
+    }
+
+    // Nearest rank, sorted into a copy so the window keeps its order
+    std::copy(m_samples.begin(), m_samples.begin() + m_count, m_sorted.begin());
+    std::sort(m_sorted.begin(), m_sorted.begin() + m_count);
+    auto rank = [this](float percentile) {
+        unsigned int index = static_cast<unsigned int>(std::ceil(percentile * m_count));
+        return m_sorted[std::clamp(index, 1u, m_count) - 1];
+    };
+
+    percentiles.p50 = rank(0.50f);
+    percentiles.p95 = rank(0.95f);
+    percentiles.p99 = rank(0.99f);
+}
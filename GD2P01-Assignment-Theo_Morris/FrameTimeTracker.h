@@ -0,0 +1,49 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : FrameTimeTracker.h
+Description : Declaration of the FrameTimeTracker class, which keeps the most recent frame times and works out their percentiles for the performance HUD.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <array>
+
+// how many of the latest times the percentiles are taken over, about four seconds at 60 frames a second
+const unsigned int FRAME_TIME_WINDOW = 256;
+
+struct FrameTimePercentiles {
+    float p50 = 0.0f;
+    float p95 = 0.0f;
+    float p99 = 0.0f;
+};
+
+// A sliding window of times in milliseconds, adding a time is cheap and the sorting is only done when the percentiles are asked for
+class FrameTimeTracker
+{
+private:
+    std::array<float, FRAME_TIME_WINDOW> m_samples = {};
+    std::array<float, FRAME_TIME_WINDOW> m_sorted = {};
+    unsigned int m_next = 0;
+    unsigned int m_count = 0;
+
+public:
+    FrameTimeTracker();
+    ~FrameTimeTracker();
+
+    void add(float milliseconds);
+    void clear();
+
+    unsigned int size() const { return m_count; }
+
+    /***
+     * Function to work out the percentiles of the times in the window.
+     * @param percentiles Filled with the 50th, 95th and 99th percentile times, all zero while the window is empty.
+     ***/
+    void getPercentiles(FrameTimePercentiles& percentiles);
+};
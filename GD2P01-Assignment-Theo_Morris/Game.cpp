@@ -11,11 +11,15 @@ Mail : theo.morris@mds.ac.nz
 **/
 
 #include "Game.h"
-#include <sstream>
+#include "AllocationTracker.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
 
 void Game::initWindow()
 {
-	gameWindowSize = sf::Vector2i(1000, 1000);
 	gameWindow = new sf::RenderWindow(sf::VideoMode(gameWindowSize.x, gameWindowSize.y), "Game Window", sf::Style::Titlebar | sf::Style::Close);
 }
 
@@ -33,6 +37,7 @@ void Game::initGame()
 {
 	gameWindow = nullptr;
 	uiWindow = nullptr;
+	gameWindowSize = sf::Vector2i(1000, 1000);
 }
 
 void Game::initUi()
@@ -89,6 +94,34 @@ void Game::initUi()
 	functionalButtons.push_back(std::move(resetButton));
 }
 
+void Game::initTextures()
+{
+	// The render thread draws every agent of a behaviour as one batch of quads with that behaviour's texture
+	const char* texturePaths[MOVEMENT_BEHAVIOR_COUNT] = {
+		"Assets/Textures/Seek.png",
+		"Assets/Textures/Flee.png",
+		"Assets/Textures/Pursue.png",
+		"Assets/Textures/Evade.png",
+		"Assets/Textures/Wander.png",
+		"Assets/Textures/Arrival.png",
+		"Assets/Textures/Flocking.png",
+		"Assets/Textures/FollowLeader.png",
+		"Assets/Textures/Queue.png"
+	};
+
+	for (int i = 0; i < MOVEMENT_BEHAVIOR_COUNT; ++i)
+	{
+		if (!agentTextures[i].loadFromFile(texturePaths[i])) {
+			std::cerr << "Failed to load texture from '" << texturePaths[i] << "'" << std::endl;
+		}
+	}
+
+	for (int i = 0; i < MOVEMENT_BEHAVIOR_COUNT; ++i)
+	{
+		agentQuadSizes[i] = sf::Vector2f(agentTextures[i].getSize()) * AGENT_SPRITE_SCALE;
+	}
+}
+
 void Game::initObstacles()
 {
 	spawnObstacle(150.0f, 200.0f, 50.0f);
@@ -100,27 +133,359 @@ void Game::initObstacles()
 	spawnObstacle(250.0f, 750.0f, 65.0f);
 }
 
-Game::Game()
+void Game::applyScenario(const Scenario& scenario)
+{
+	simulationSeed = scenario.seed;
+
+	for (const ScenarioObstacle& obstacle : scenario.obstacles)
+	{
+		obstacles.add(obstacle.center, obstacle.radius);
+	}
+	obstacleVersion++;
+
+	// Agents in a group are spread evenly over a disc, placed by their own random stream so groups don't affect each other
+	for (const ScenarioSpawn& spawn : scenario.spawns)
+	{
+		for (unsigned int i = 0; i < spawn.count; ++i)
+		{
+			float angle = agentRandom(spawn.seed, i, 0, RandomStream::Placement, 0) * 2.0f * PI;
+			float distance = std::sqrt(agentRandom(spawn.seed, i, 0, RandomStream::Placement, 1)) * spawn.spread;
+			sf::Vector2f position = spawn.position + sf::Vector2f(std::cos(angle), std::sin(angle)) * distance;
+			addAgent(static_cast<int>(position.x), static_cast<int>(position.y), spawn.behavior);
+		}
+	}
+	rebuildFollowOrder();
+
+	scriptedTargets = scenario.targets;
+	nextScriptedTarget = 0;
+
+	std::cout << "Scenario loaded: " << agents.size() << " agents, " << obstacles.size() << " obstacles, " << scriptedTargets.size() << " targets" << std::endl;
+}
+
+Game::Game(const GameOptions& options) : spatialGrid(GRID_CELL_SIZE), jobSystem(options.threadCount > 0 ? options.threadCount : std::max(2u, std::thread::hardware_concurrency()) - 1), checkpointWriter(CHECKPOINT_PATH)
 {
+	headless = options.headless;
+
+	// Nothing draws a headless game so it never prepares render snapshots
+	snapshotWanted = !headless;
+
 	initGame();
-	initWindow();
-	initUiWindow();
-	initUi();
-	initObstacles();
+	if (options.scenario != nullptr)
+	{
+		gameWindowSize = sf::Vector2i(options.scenario->worldSize);
+	}
+
+	// A replay shows the recorded world at the size it was recorded at
+	replay = options.replay;
+	if (replay != nullptr)
+	{
+		gameWindowSize = sf::Vector2i(replay->getWorldSize());
+	}
+
+	if (!headless)
+	{
+		initWindow();
+		initUiWindow();
+		initUi();
+		initTextures();
+	}
+
+	if (options.scenario != nullptr)
+	{
+		applyScenario(*options.scenario);
+	}
+	else if (replay == nullptr)
+	{
+		initObstacles();
+	}
+	initFrameGraph();
+
+	if (!options.recordingPath.empty())
+	{
+		startRecording(options.recordingPath);
+	}
+
+	if (options.telemetry)
+	{
+		toggleTelemetry();
+	}
+
+	assertNoAllocations = options.assertNoAllocations;
+	if (options.trackAllocations || options.assertNoAllocations)
+	{
+		setAllocationTracking(true);
+	}
+
+	// A headless game is stepped by runHeadless on the calling thread instead
+	if (!headless)
+	{
+		simulationRunning = true;
+		simulationThread = replay != nullptr ? std::thread(&Game::replayLoop, this) : std::thread(&Game::simulationLoop, this);
+	}
 }
 
 Game::~Game()
 {
+	simulationRunning = false;
+	if (simulationThread.joinable())
+	{
+		simulationThread.join();
+	}
+
 	delete gameWindow;
 	delete uiWindow;
 }
 
 const bool Game::isRunning() const
 {
-	return gameWindow->isOpen();
+	return gameWindow != nullptr && gameWindow->isOpen();
+}
+
+void Game::runHeadless(unsigned int ticks, std::ostream& output)
+{
+	sf::Clock runClock;
+
+	for (unsigned int i = 0; i < ticks; ++i)
+	{
+		stepHeadless();
+
+		if (simulationTick % HEADLESS_REPORT_INTERVAL == 0)
+		{
+			output << "Tick " << simulationTick << " state hash " << std::hex << simulationStats.stateHash << std::dec << "\n";
+		}
+	}
+
+	float seconds = runClock.getElapsedTime().asSeconds();
+	output << "Ran " << ticks << " ticks of " << agents.size() << " agents in " << seconds << "s (" << (seconds > 0.0f ? ticks / seconds : 0.0f) << " ticks/s)\n";
+	output << "Final state hash at tick " << simulationTick << ": " << std::hex << simulationStats.stateHash << std::dec << std::endl;
+}
+
+void Game::stepHeadless()
+{
+	frameDeltaTime = FIXED_TIMESTEP;
+	beginTickAllocationCheck();
+	frameGraph.execute(jobSystem);
+	endTickAllocationCheck();
+}
+
+bool Game::saveWorldSnapshot(const std::string& path)
+{
+	sf::Clock saveClock;
+	captureWorldSnapshot(worldSnapshotBuffer);
+
+	std::string error;
+	if (!worldSnapshotBuffer.write(path, error))
+	{
+		std::cerr << error << std::endl;
+		return false;
+	}
+
+	std::cout << "World saved to " << path << " at tick " << simulationTick << ": " << agents.size() << " agents, " << obstacles.size() << " obstacles, " << worldSnapshotBuffer.size() << " bytes in " << saveClock.getElapsedTime().asSeconds() * 1000.0f << "ms" << std::endl;
+	return true;
+}
+
+void Game::captureWorldSnapshot(WorldSnapshotBuffer& buffer)
+{
+	unsigned int agentCount = static_cast<unsigned int>(agents.size());
+
+	WorldSnapshotHeader header = {};
+	header.agentCount = agentCount;
+	header.obstacleCount = obstacles.size();
+	header.worldWidth = static_cast<std::uint32_t>(gameWindowSize.x);
+	header.worldHeight = static_cast<std::uint32_t>(gameWindowSize.y);
+	header.seed = simulationSeed;
+	header.tick = simulationTick;
+	header.nextAgentId = nextAgentId;
+	header.targetX = targetPosition.x;
+	header.targetY = targetPosition.y;
+	buffer.reset(header);
+	writeAgentStates(buffer.agents());
+
+	WorldSnapshotObstacle* obstacleRecords = buffer.obstacles();
+	for (unsigned int i = 0; i < obstacles.size(); ++i)
+	{
+		obstacleRecords[i] = { obstacles.getCenterX()[i], obstacles.getCenterY()[i], obstacles.getRadius()[i] };
+	}
+}
+
+void Game::writeAgentStates(AgentState* states)
+{
+	unsigned int agentCount = static_cast<unsigned int>(agents.size());
+
+	// Follow links are saved as positions in the agents vector, looked up through the followed agent's id
+	agentIndexById.assign(nextAgentId, -1);
+	auto indexAgents = [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			agentIndexById[agents[i]->getId()] = static_cast<std::int32_t>(i);
+		}
+	};
+	jobSystem.parallelFor(0, agentCount, AGENT_BATCH_SIZE, nullptr, 0, indexAgents);
+
+	auto writeAgents = [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			const Agent* followed = agents[i]->getAgentToFollow();
+			states[i] = agents[i]->getState(followed != nullptr ? agentIndexById[followed->getId()] : -1);
+		}
+	};
+	jobSystem.parallelFor(0, agentCount, AGENT_BATCH_SIZE, nullptr, 0, writeAgents);
+}
+
+void Game::getAgentStates(std::vector<AgentState>& states)
+{
+	states.resize(agents.size());
+	writeAgentStates(states.data());
+}
+
+void Game::recordTrajectories()
+{
+	if (!trajectoryRecorder.isRecording())
+	{
+		return;
+	}
+
+	// Only the quantising happens here, a full ring drops the frame instead of waiting for the writer
+	unsigned int agentCount = static_cast<unsigned int>(agents.size());
+	TrajectorySample* samples = trajectoryRecorder.beginFrame(simulationTick, agentCount);
+	if (samples == nullptr)
+	{
+		return;
+	}
+
+	auto quantizeAgents = [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			const Agent& agent = *agents[i];
+			sf::Vector2f position = agent.getPosition();
+			sf::Vector2f velocity = agent.getVelocity();
+			samples[i].id = agent.getId();
+			samples[i].behavior = static_cast<std::uint32_t>(agent.getBehavior());
+			samples[i].positionX = static_cast<std::int32_t>(std::lround(position.x * TRAJECTORY_POSITION_SCALE));
+			samples[i].positionY = static_cast<std::int32_t>(std::lround(position.y * TRAJECTORY_POSITION_SCALE));
+			samples[i].velocityX = static_cast<std::int32_t>(std::lround(velocity.x * TRAJECTORY_VELOCITY_SCALE));
+			samples[i].velocityY = static_cast<std::int32_t>(std::lround(velocity.y * TRAJECTORY_VELOCITY_SCALE));
+		}
+	};
+	jobSystem.parallelFor(0, agentCount, AGENT_BATCH_SIZE, nullptr, 0, quantizeAgents);
+
+	trajectoryRecorder.endFrame();
+}
+
+void Game::publishTelemetry()
+{
+	if (!telemetryPublisher.isPublishing())
+	{
+		return;
+	}
+
+	// The agents are written straight into the slot, readers never wait on the simulation and it never waits on them
+	sf::Clock publishClock;
+	TelemetryFrame frame = telemetryPublisher.beginFrame(simulationTick, static_cast<unsigned int>(agents.size()));
+	auto writeAgents = [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			const Agent& agent = *agents[i];
+			sf::Vector2f position = agent.getPosition();
+			sf::Vector2f velocity = agent.getVelocity();
+			frame.positionX[i] = position.x;
+			frame.positionY[i] = position.y;
+			frame.velocityX[i] = velocity.x;
+			frame.velocityY[i] = velocity.y;
+			frame.behavior[i] = static_cast<std::uint8_t>(agent.getBehavior());
+		}
+	};
+	jobSystem.parallelFor(0, frame.agentCount, AGENT_BATCH_SIZE, nullptr, 0, writeAgents);
+
+	telemetryPublisher.endFrame(publishClock.getElapsedTime().asSeconds() * 1000.0f);
+}
+
+void Game::takeCheckpoint()
+{
+	if (!checkpointing || simulationTick % CHECKPOINT_INTERVAL != 0)
+	{
+		return;
+	}
+
+	// The copy is the only part the simulation waits for, the write happens on the checkpoint writer's thread
+	WorldSnapshotBuffer* buffer = checkpointWriter.acquire();
+	if (buffer == nullptr)
+	{
+		checkpointWriter.skip();
+		return;
+	}
+
+	sf::Clock stallClock;
+	captureWorldSnapshot(*buffer);
+	checkpointWriter.submit(buffer, stallClock.getElapsedTime().asSeconds() * 1000.0f);
+}
+
+bool Game::loadWorldSnapshot(const std::string& path)
+{
+	sf::Clock loadClock;
+
+	MappedWorldSnapshot snapshot;
+	std::string error;
+	if (!snapshot.open(path, error))
+	{
+		std::cerr << error << std::endl;
+		return false;
+	}
+
+	const WorldSnapshotHeader& header = snapshot.header();
+	simulationSeed = header.seed;
+	simulationTick = header.tick;
+	nextAgentId = header.nextAgentId;
+	gameWindowSize = sf::Vector2i(static_cast<int>(header.worldWidth), static_cast<int>(header.worldHeight));
+	targetPosition = sf::Vector2i(header.targetX, header.targetY);
+
+	obstacles.clear();
+	const WorldSnapshotObstacle* obstacleRecords = snapshot.obstacles();
+	for (unsigned int i = 0; i < header.obstacleCount; ++i)
+	{
+		obstacles.add(sf::Vector2f(obstacleRecords[i].x, obstacleRecords[i].y), obstacleRecords[i].radius);
+	}
+	obstacleVersion++;
+
+	// Agents are built straight from the mapped records, then linked once they all exist
+	agents.clear();
+	agents.resize(header.agentCount);
+	const AgentState* states = snapshot.agents();
+	auto restoreAgents = [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			agents[i] = std::make_unique<Agent>(states[i], simulationSeed);
+		}
+	};
+	jobSystem.parallelFor(0, header.agentCount, AGENT_BATCH_SIZE, nullptr, 0, restoreAgents);
+
+	auto linkAgents = [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			if (states[i].followIndex >= 0)
+			{
+				agents[i]->setAgentToFollow(agents[states[i].followIndex].get());
+			}
+		}
+	};
+	jobSystem.parallelFor(0, header.agentCount, AGENT_BATCH_SIZE, nullptr, 0, linkAgents);
+	rebuildFollowOrder();
+
+	// Scripted targets before the restored tick have already been applied
+	nextScriptedTarget = std::lower_bound(scriptedTargets.begin(), scriptedTargets.end(), simulationTick, [](const ScenarioTarget& target, unsigned int tick) { return target.tick < tick; }) - scriptedTargets.begin();
+
+	std::cout << "World loaded from " << path << " at tick " << simulationTick << ": " << agents.size() << " agents, " << obstacles.size() << " obstacles in " << loadClock.getElapsedTime().asSeconds() * 1000.0f << "ms" << std::endl;
+	return true;
 }
 
 void Game::spawnAgent(int spawnPositionX, int spawnPositionY, MovementBehavior agentMovementBehaviour)
+{
+	addAgent(spawnPositionX, spawnPositionY, agentMovementBehaviour);
+
+	std::cout << "Agent spawned at location: " << spawnPositionX << ", " << spawnPositionY << "\n";
+}
+
+void Game::addAgent(int spawnPositionX, int spawnPositionY, MovementBehavior agentMovementBehaviour)
 {
 	// Create a new Agent object dynamically
 	std::unique_ptr<Agent> newAgent;
@@ -128,164 +493,1251 @@ void Game::spawnAgent(int spawnPositionX, int spawnPositionY, MovementBehavior a
 	// Check if the agents vector is empty
 	if (agents.empty()) {
 		// If it's empty, pass nullptr as there is no agent to follow or be in front
-		newAgent = std::make_unique<Agent>(spawnPositionX, spawnPositionY, nullptr, agentMovementBehaviour);
+		newAgent = std::make_unique<Agent>(nextAgentId, simulationSeed, spawnPositionX, spawnPositionY, nullptr, agentMovementBehaviour);
 	}
 	else {
 		// If not empty, decide based on the movement behavior
 		if (agentMovementBehaviour == MovementBehavior::FollowLeader) {
 			// Follow the first agent if the behavior is FollowLeader
-			newAgent = std::make_unique<Agent>(spawnPositionX, spawnPositionY, agents.front().get(), agentMovementBehaviour);
+			newAgent = std::make_unique<Agent>(nextAgentId, simulationSeed, spawnPositionX, spawnPositionY, agents.front().get(), agentMovementBehaviour);
 		}
 		else {
 			// Otherwise, follow the last agent
-			newAgent = std::make_unique<Agent>(spawnPositionX, spawnPositionY, agents.back().get(), agentMovementBehaviour);
+			newAgent = std::make_unique<Agent>(nextAgentId, simulationSeed, spawnPositionX, spawnPositionY, agents.back().get(), agentMovementBehaviour);
 		}
 	}
 
 	// Store the smart pointer to the new Agent object in the agents vector
 	agents.push_back(std::move(newAgent));
-
-	std::cout << "Agent spawned at location: " << spawnPositionX << ", " << spawnPositionY << std::endl;
+	nextAgentId++;
+	followOrderDirty = true;
 }
 
 void Game::spawnObstacle(float spawnPositionX, float spawnPositionY, float radius)
 {
-	// Create a new Obstacle object dynamically
-	std::unique_ptr<Obstacle> newObstacle = std::make_unique<Obstacle>(sf::Vector2f(spawnPositionX, spawnPositionY), radius);
+	// The simulation only keeps the circle, the render thread makes its own sprite from the snapshot
+	obstacles.add(sf::Vector2f(spawnPositionX, spawnPositionY), radius);
+	obstacleVersion++;
 
-	// Store the smart pointer to the new Obstacle object in the obstacles vector
-	obstacles.push_back(std::move(newObstacle));
+	std::cout << "Obstacle spawned at location: " << spawnPositionX << ", " << spawnPositionY << "\n";
+}
 
-	std::cout << "Obstacle spawned at location: " << spawnPositionX << ", " << spawnPositionY << std::endl;
+void Game::toggleForceAccumulation()
+{
+	if (steeringSettings.accumulation == ForceAccumulation::WeightedSum)
+	{
+		steeringSettings.accumulation = ForceAccumulation::Prioritized;
+		std::cout << "Force accumulation: prioritized" << std::endl;
+	}
+	else
+	{
+		steeringSettings.accumulation = ForceAccumulation::WeightedSum;
+		std::cout << "Force accumulation: weighted sum" << std::endl;
+	}
 }
 
-void Game::pollEvents()
+void Game::toggleTimeSlicing()
 {
-	//Game Window
-	while (gameWindow->pollEvent(event))
+	timeSlicing = !timeSlicing;
+	if (timeSlicing)
 	{
-		switch (event.type)
-		{
-		case sf::Event::Closed:
-			gameWindow->close();
-			uiWindow->close();
-			break;
-		case sf::Event::KeyPressed:
-			if (event.key.code == sf::Keyboard::Escape)
-				gameWindow->close();
-				uiWindow->close();
-			break;
-		case sf::Event::MouseButtonPressed:
-			if (event.mouseButton.button == sf::Mouse::Left)
-			{
-				spawnAgent(mousePosWindow.x, mousePosWindow.y, currentSelectedBehaviour);
-			}
-			break;
-		}
+		steeringSettings.updateIntervals = TIME_SLICED_UPDATE_INTERVALS;
+		std::cout << "Time slicing: on" << std::endl;
+	}
+	else
+	{
+		steeringSettings.updateIntervals.fill(1);
+		std::cout << "Time slicing: off" << std::endl;
 	}
+}
 
-	//UI Window
-	while (uiWindow->pollEvent(event))
+void Game::toggleLevelOfDetail()
+{
+	lodEnabled = !lodEnabled;
+	if (!lodEnabled)
 	{
-		switch (event.type)
+		// Nothing puts agents back to sleep once level of detail is off so wake them all now
+		for (auto& agentPtr : agents)
 		{
-		case sf::Event::Closed:
-			gameWindow->close();
-			uiWindow->close();
-			break;
-		case sf::Event::KeyPressed:
-			if (event.key.code == sf::Keyboard::Escape)
-				gameWindow->close();
-				uiWindow->close();
-			break;
-		case sf::Event::MouseButtonPressed:
-			if (event.mouseButton.button == sf::Mouse::Left)
+			if (agentPtr->isSleeping())
 			{
-				for (int i = 0; i < behaviourButtons.size(); ++i) {
-					if (behaviourButtons[i]->isMouseOver(*uiWindow)) {
-						currentSelectedBehaviour = static_cast<MovementBehavior>(i);
-						return;
-					}
-				}
-				for (int i = 0; i < functionalButtons.size(); ++i) {
-					if (functionalButtons[i]->isMouseOver(*uiWindow)) {
-						reset();
-						return;
-					}
-				}
+				agentPtr->wake(targetPosition);
 			}
-			break;
 		}
 	}
+	std::cout << "Level of detail: " << (lodEnabled ? "on" : "off") << std::endl;
 }
 
-void::Game::updateAgents(float deltaTime)
+void Game::toggleFastMath()
 {
-	for (auto& agentPtr : agents) {
-		agentPtr->update(deltaTime, gameWindow->getSize(), agents, obstacles, mousePosWindow);
-	}
+	steeringSettings.fastMath = !steeringSettings.fastMath;
+	std::cout << "Fast math: " << (steeringSettings.fastMath ? "on" : "off") << std::endl;
 }
 
-void::Game::updateMousePositions(float deltaTime)
+void Game::toggleCheckpoints()
 {
-	mousePosScreen = sf::Mouse::getPosition();
-	mousePosWindow = sf::Mouse::getPosition(*gameWindow);
-	mousePosView = gameWindow->mapPixelToCoords(mousePosWindow);
+	checkpointing = !checkpointing;
+	std::cout << "Checkpoints: " << (checkpointing ? "on" : "off") << std::endl;
 }
 
-void Game::update()
+void Game::toggleRecording()
 {
-	pollEvents();
+	if (trajectoryRecorder.isRecording())
+	{
+		trajectoryRecorder.stop();
+		return;
+	}
+	startRecording(TRAJECTORY_PATH);
+}
 
-	float dt = clock.restart().asSeconds();
+void Game::toggleTelemetry()
+{
+	if (telemetryPublisher.isPublishing())
+	{
+		telemetryPublisher.stop();
+		std::cout << "Telemetry: off" << std::endl;
+		return;
+	}
 
-	updateMousePositions(dt);
+	std::string error;
+	if (!telemetryPublisher.start(TELEMETRY_NAME, TELEMETRY_SLOT_CAPACITY, error))
+	{
+		std::cerr << error << std::endl;
+		return;
+	}
+	std::cout << "Telemetry: publishing to " << TELEMETRY_NAME << std::endl;
+}
 
-	updateAgents(dt);
+void Game::toggleAllocationTracking()
+{
+	setAllocationTracking(!isAllocationTracking());
+	std::cout << "Allocation tracking: " << (isAllocationTracking() ? "on" : "off") << std::endl;
+}
 
-	std::stringstream ss;
-	ss << "Screen: " << mousePosScreen.x << " " << mousePosScreen.y << "\n"
-		<< "Window: " << mousePosWindow.x << " " << mousePosWindow.y << "\n"
-		<< "View: " << mousePosView.x << " " << mousePosView.y << "\n"
-		<< "Agents: " << agents.size() << "\n";
+void Game::startRecording(const std::string& path)
+{
+	std::string error;
+	if (!trajectoryRecorder.start(path, sf::Vector2u(gameWindowSize), error))
+	{
+		std::cerr << error << std::endl;
+		return;
+	}
+	std::cout << "Recording trajectories to " << path << std::endl;
+}
 
-	debugText.setString(ss.str());
+void Game::toggleChainOrdering()
+{
+	chainOrdering = !chainOrdering;
+	std::cout << "Follow chain ordering: " << (chainOrdering ? "on" : "off") << std::endl;
 }
 
-void Game::render()
+void Game::toggleFixedTimestep()
 {
-	//Game Window
-	gameWindow->clear(sf::Color::Black);
+	fixedTimestep = !fixedTimestep;
+	std::cout << "Fixed timestep: " << (fixedTimestep ? "on" : "off") << std::endl;
+}
 
-	//Draw Game Objects
-	for (const auto& agentPtr : agents)
+void Game::keyPressed(sf::Keyboard::Key key)
+{
+	if (replay != nullptr)
 	{
-		gameWindow->draw(*agentPtr);
+		replayKeyPressed(key);
+		return;
 	}
-	
-	for (const auto& obstaclePtr : obstacles)
+
+	switch (key)
 	{
-		gameWindow->draw(*obstaclePtr);
+	case sf::Keyboard::Escape:
+		gameWindow->close();
+		uiWindow->close();
+		break;
+	case sf::Keyboard::P:
+		queueCommand({ SimulationCommandType::ToggleForceAccumulation });
+		break;
+	case sf::Keyboard::T:
+		queueCommand({ SimulationCommandType::ToggleTimeSlicing });
+		break;
+	case sf::Keyboard::L:
+		queueCommand({ SimulationCommandType::ToggleLevelOfDetail });
+		break;
+	case sf::Keyboard::F:
+		queueCommand({ SimulationCommandType::ToggleFixedTimestep });
+		break;
+	case sf::Keyboard::Q:
+		queueCommand({ SimulationCommandType::ToggleChainOrdering });
+		break;
+	case sf::Keyboard::M:
+		queueCommand({ SimulationCommandType::ToggleFastMath });
+		break;
+	case sf::Keyboard::F5:
+		queueCommand({ SimulationCommandType::SaveWorld });
+		break;
+	case sf::Keyboard::F9:
+		queueCommand({ SimulationCommandType::LoadWorld });
+		break;
+	case sf::Keyboard::R:
+		queueCommand({ SimulationCommandType::ToggleRecording });
+		break;
+	case sf::Keyboard::E:
+		queueCommand({ SimulationCommandType::ToggleTelemetry });
+		break;
+	case sf::Keyboard::A:
+		queueCommand({ SimulationCommandType::ToggleAllocationTracking });
+		break;
+	case sf::Keyboard::K:
+		queueCommand({ SimulationCommandType::ToggleCheckpoints });
+		break;
+	case sf::Keyboard::C:
+		criticalPathRequested = true;
+		break;
+	case sf::Keyboard::O:
+		queueCommand({ SimulationCommandType::SpawnObstacle, sf::Vector2f(mousePosWindow), SPAWNED_OBSTACLE_RADIUS });
+		break;
+	default:
+		break;
 	}
+}
 
-	//Draw Ui
-	gameWindow->draw(debugText);
-
-	gameWindow->display();
-
-	//UI Window
-	uiWindow->clear(sf::Color::Black);
-	for (const auto& button : behaviourButtons) {
-		uiWindow->draw(*button);
+void Game::replayKeyPressed(sf::Keyboard::Key key)
+{
+	switch (key)
+	{
+	case sf::Keyboard::Escape:
+		gameWindow->close();
+		uiWindow->close();
+		break;
+	case sf::Keyboard::Space:
+		queueCommand({ SimulationCommandType::ReplayTogglePause });
+		break;
+	case sf::Keyboard::Up:
+		queueCommand({ SimulationCommandType::ReplayFaster });
+		break;
+	case sf::Keyboard::Down:
+		queueCommand({ SimulationCommandType::ReplaySlower });
+		break;
+	case sf::Keyboard::Right:
+		queueCommand({ SimulationCommandType::ReplaySeekForward });
+		break;
+	case sf::Keyboard::Left:
+		queueCommand({ SimulationCommandType::ReplaySeekBack });
+		break;
+	case sf::Keyboard::Home:
+		queueCommand({ SimulationCommandType::ReplayRestart });
+		break;
+	default:
+		break;
 	}
-	for (const auto& button : functionalButtons) {
-		uiWindow->draw(*button);
+}
+
+void Game::queueCommand(const SimulationCommand& command)
+{
+	if (!simulationCommands.push(command))
+	{
+		std::cerr << "Simulation command queue is full, the command was dropped" << std::endl;
 	}
-	uiWindow->display();
+}
+
+void Game::applySimulationCommands()
+{
+	SimulationCommand command;
+	while (simulationCommands.pop(command))
+	{
+		// Commands change the world, so the buffers get a while to grow to fit again before the no allocation check applies
+		allocationSettleTick = simulationTick + ALLOCATION_SETTLE_TICKS;
+
+		switch (command.type)
+		{
+		case SimulationCommandType::SpawnAgent:
+			spawnAgent(static_cast<int>(command.position.x), static_cast<int>(command.position.y), command.behavior);
+			break;
+		case SimulationCommandType::DespawnAgent:
+			despawnAgent(command.position.x, command.position.y);
+			break;
+		case SimulationCommandType::Reset:
+			reset();
+			break;
+		case SimulationCommandType::SpawnObstacle:
+			spawnObstacle(command.position.x, command.position.y, command.radius);
+			break;
+		case SimulationCommandType::ToggleForceAccumulation:
+			toggleForceAccumulation();
+			break;
+		case SimulationCommandType::ToggleTimeSlicing:
+			toggleTimeSlicing();
+			break;
+		case SimulationCommandType::ToggleLevelOfDetail:
+			toggleLevelOfDetail();
+			break;
+		case SimulationCommandType::ToggleFixedTimestep:
+			toggleFixedTimestep();
+			break;
+		case SimulationCommandType::ToggleChainOrdering:
+			toggleChainOrdering();
+			break;
+		case SimulationCommandType::ToggleFastMath:
+			toggleFastMath();
+			break;
+		case SimulationCommandType::SaveWorld:
+			saveWorldSnapshot(WORLD_SNAPSHOT_PATH);
+			break;
+		case SimulationCommandType::LoadWorld:
+			loadWorldSnapshot(WORLD_SNAPSHOT_PATH);
+			break;
+		case SimulationCommandType::ToggleCheckpoints:
+			toggleCheckpoints();
+			break;
+		case SimulationCommandType::ToggleRecording:
+			toggleRecording();
+			break;
+		case SimulationCommandType::ToggleTelemetry:
+			toggleTelemetry();
+			break;
+		case SimulationCommandType::ToggleAllocationTracking:
+			toggleAllocationTracking();
+			break;
+		case SimulationCommandType::ReplayTogglePause:
+		case SimulationCommandType::ReplayFaster:
+		case SimulationCommandType::ReplaySlower:
+		case SimulationCommandType::ReplaySeekForward:
+		case SimulationCommandType::ReplaySeekBack:
+		case SimulationCommandType::ReplayRestart:
+			// Playback controls only mean something to the replay loop
+			break;
+		}
+	}
+
+	// Follow links only change when agents are added or removed
+	if (followOrderDirty)
+	{
+		rebuildFollowOrder();
+	}
+}
+
+void Game::despawnAgent(float positionX, float positionY)
+{
+	// Find the agent closest to the position
+	sf::Vector2f position(positionX, positionY);
+	auto closest = agents.end();
+	float closestDistance = DESPAWN_RADIUS;
+	for (auto it = agents.begin(); it != agents.end(); ++it)
+	{
+		float distance = vectorDistance((*it)->getPosition(), position);
+		if (distance < closestDistance)
+		{
+			closest = it;
+			closestDistance = distance;
+		}
+	}
+
+	if (closest == agents.end())
+	{
+		return;
+	}
+
+	// Anything following the removed agent moves up to follow whatever it was following
+	Agent* removedAgent = closest->get();
+	for (auto& agentPtr : agents)
+	{
+		if (agentPtr->getAgentToFollow() == removedAgent)
+		{
+			agentPtr->setAgentToFollow(removedAgent->getAgentToFollow());
+		}
+	}
+
+	agents.erase(closest);
+	followOrderDirty = true;
+
+	std::cout << "Agent despawned at location: " << positionX << ", " << positionY << "\n";
+}
+
+void Game::pollEvents()
+{
+	//Game Window
+	while (gameWindow->pollEvent(event))
+	{
+		switch (event.type)
+		{
+		case sf::Event::Closed:
+			gameWindow->close();
+			uiWindow->close();
+			break;
+		case sf::Event::KeyPressed:
+			keyPressed(event.key.code);
+			break;
+		case sf::Event::MouseButtonPressed:
+			if (event.mouseButton.button == sf::Mouse::Left)
+			{
+				queueCommand({ SimulationCommandType::SpawnAgent, sf::Vector2f(mousePosWindow), 0.0f, currentSelectedBehaviour });
+			}
+			else if (event.mouseButton.button == sf::Mouse::Right)
+			{
+				queueCommand({ SimulationCommandType::DespawnAgent, sf::Vector2f(mousePosWindow) });
+			}
+			break;
+		}
+	}
+
+	//UI Window
+	while (uiWindow->pollEvent(event))
+	{
+		switch (event.type)
+		{
+		case sf::Event::Closed:
+			gameWindow->close();
+			uiWindow->close();
+			break;
+		case sf::Event::KeyPressed:
+			keyPressed(event.key.code);
+			break;
+		case sf::Event::MouseButtonPressed:
+			if (event.mouseButton.button == sf::Mouse::Left)
+			{
+				for (int i = 0; i < behaviourButtons.size(); ++i) {
+					if (behaviourButtons[i]->isMouseOver(*uiWindow)) {
+						currentSelectedBehaviour = static_cast<MovementBehavior>(i);
+						return;
+					}
+				}
+				for (int i = 0; i < functionalButtons.size(); ++i) {
+					if (functionalButtons[i]->isMouseOver(*uiWindow)) {
+						queueCommand({ SimulationCommandType::Reset });
+						return;
+					}
+				}
+			}
+			break;
+		}
+	}
+}
+
+void Game::steerAgents(float deltaTime)
+{
+	SteeringContext context = { deltaTime, agents, spatialGrid, obstacles, targetPosition, steeringSettings, simulationTick };
+
+	activeAgentCount = 0;
+	sleepingAgentCount = 0;
+	reducedRateAgentCount = 0;
+	neighborQueryCount = 0;
+	neighborCandidateCount = 0;
+
+	// Steering pass, batches of agents from neighbouring grid cells, every agent only reads the previous tick's state
+	// With chain ordering the followers are left for their waves in the integration pass
+	const std::vector<unsigned int>& gridOrder = spatialGrid.getAgentIndices();
+	steerAgentRange(context, gridOrder.data(), 0, static_cast<unsigned int>(gridOrder.size()), spatialGrid.getCellStarts(), spatialGrid.getCellCount(), chainOrdering);
+}
+
+void Game::integrateAgents()
+{
+	// Integration pass, once every agent has steered they can all move
+	const std::vector<unsigned int>& gridOrder = spatialGrid.getAgentIndices();
+	integrateAgentRange(gridOrder.data(), 0, static_cast<unsigned int>(gridOrder.size()), spatialGrid.getCellStarts(), spatialGrid.getCellCount(), chainOrdering);
+
+	if (chainOrdering)
+	{
+		// Each wave steers from the agents it follows after they have moved this tick, so long queues don't lag a tick per link
+		SteeringContext context = { frameDeltaTime, agents, spatialGrid, obstacles, targetPosition, steeringSettings, simulationTick };
+		for (size_t wave = 0; wave + 1 < followWaveStarts.size(); ++wave)
+		{
+			steerAgentRange(context, followWaveAgents.data(), followWaveStarts[wave], followWaveStarts[wave + 1], nullptr, 0, false);
+			integrateAgentRange(followWaveAgents.data(), followWaveStarts[wave], followWaveStarts[wave + 1], nullptr, 0, false);
+		}
+	}
+
+	simulationTick++;
+}
+
+void Game::steerAgentRange(const SteeringContext& context, const unsigned int* order, unsigned int begin, unsigned int end, const unsigned int* splitPoints, unsigned int splitPointCount, bool skipFollowers)
+{
+	float deltaTime = context.deltaTime;
+
+	auto steerBatch = [&](unsigned int batchBegin, unsigned int batchEnd) {
+		unsigned int active = 0;
+		unsigned int sleeping = 0;
+		unsigned int reducedRate = 0;
+		unsigned long long neighborQueries = 0;
+		unsigned long long neighborCandidates = 0;
+
+		for (unsigned int i = batchBegin; i < batchEnd; ++i)
+		{
+			Agent& agent = *agents[order[i]];
+			if (skipFollowers && agent.getFollowDepth() > 0)
+			{
+				continue;
+			}
+
+			if (lodEnabled)
+			{
+				// Settled agents stay asleep until something they react to changes
+				if (agent.isSleeping())
+				{
+					if (!agent.shouldWake(context, obstacleVersion))
+					{
+						sleeping++;
+						continue;
+					}
+					agent.requestWake(targetPosition);
+				}
+				else if (agent.updateSettleState(targetPosition, obstacleVersion))
+				{
+					sleeping++;
+					continue;
+				}
+
+				// Agents far from the focus point only update on their slice of the reduced rate
+				if (vectorDistance(agent.getPosition(), sf::Vector2f(targetPosition)) > LOD_FAR_DISTANCE)
+				{
+					reducedRate++;
+					if ((simulationTick + agent.getId()) % LOD_REDUCED_INTERVAL != 0)
+					{
+						agent.deferUpdate(deltaTime);
+						continue;
+					}
+				}
+				else
+				{
+					active++;
+				}
+			}
+			else
+			{
+				active++;
+			}
+
+			agent.steer(context);
+			if (agent.gatheredNeighbors())
+			{
+				neighborQueries++;
+				neighborCandidates += agent.getNeighborCandidates();
+			}
+		}
+
+		activeAgentCount += active;
+		sleepingAgentCount += sleeping;
+		reducedRateAgentCount += reducedRate;
+		neighborQueryCount += neighborQueries;
+		neighborCandidateCount += neighborCandidates;
+	};
+
+	if (end - begin < INLINE_WAVE_SIZE)
+	{
+		steerBatch(begin, end);
+	}
+	else
+	{
+		jobSystem.parallelFor(begin, end, AGENT_BATCH_SIZE, splitPoints, splitPointCount, steerBatch);
+	}
+}
+
+void Game::integrateAgentRange(const unsigned int* order, unsigned int begin, unsigned int end, const unsigned int* splitPoints, unsigned int splitPointCount, bool skipFollowers)
+{
+	sf::Vector2u worldSize(gameWindowSize);
+
+	auto integrateBatch = [&](unsigned int batchBegin, unsigned int batchEnd) {
+		for (unsigned int i = batchBegin; i < batchEnd; ++i)
+		{
+			Agent& agent = *agents[order[i]];
+			if (skipFollowers && agent.getFollowDepth() > 0)
+			{
+				continue;
+			}
+			agent.integrate(worldSize);
+		}
+	};
+
+	if (end - begin < INLINE_WAVE_SIZE)
+	{
+		integrateBatch(begin, end);
+	}
+	else
+	{
+		jobSystem.parallelFor(begin, end, AGENT_BATCH_SIZE, splitPoints, splitPointCount, integrateBatch);
+	}
+}
+
+void Game::rebuildFollowOrder()
+{
+	followOrderDirty = false;
+
+	// Work out every agent's follow depth, leaders always come before their followers in the agents vector
+	unsigned int maxDepth = 0;
+	for (auto& agentPtr : agents)
+	{
+		agentPtr->updateFollowDepth();
+		maxDepth = std::max(maxDepth, agentPtr->getFollowDepth());
+	}
+
+	// Counting sort the followers by depth, wave w holds the agents of depth w + 1
+	followWaveStarts.assign(maxDepth + 1, 0);
+	for (const auto& agentPtr : agents)
+	{
+		if (agentPtr->getFollowDepth() > 0)
+		{
+			followWaveStarts[agentPtr->getFollowDepth()]++;
+		}
+	}
+	for (unsigned int wave = 1; wave <= maxDepth; ++wave)
+	{
+		followWaveStarts[wave] += followWaveStarts[wave - 1];
+	}
+
+	followWaveAgents.resize(followWaveStarts[maxDepth]);
+	std::vector<unsigned int> waveCursor(followWaveStarts.begin(), followWaveStarts.end() - 1);
+	for (unsigned int i = 0; i < agents.size(); ++i)
+	{
+		unsigned int depth = agents[i]->getFollowDepth();
+		if (depth > 0)
+		{
+			followWaveAgents[waveCursor[depth - 1]++] = i;
+		}
+	}
+}
+
+void::Game::updateMousePositions(float deltaTime)
+{
+	mousePosScreen = sf::Mouse::getPosition();
+	mousePosWindow = sf::Mouse::getPosition(*gameWindow);
+	mousePosView = gameWindow->mapPixelToCoords(mousePosWindow);
+}
+
+void Game::initFrameGraph()
+{
+	// Each phase declares what it reads and writes, the graph runs phases that don't conflict at the same time.
+	// Saving and loading a world read and write the tick and target, so target tracking waits for the commands
+	frameGraph.addPhase("ApplyCommands", resourceSet({ SimulationResource::Commands }), resourceSet({ SimulationResource::Commands, SimulationResource::Tick, SimulationResource::Target, SimulationResource::Agents, SimulationResource::Obstacles, SimulationResource::Settings }), [this]() { applySimulationCommands(); });
+	frameGraph.addPhase("TargetTracking", resourceSet({ SimulationResource::Input, SimulationResource::Tick }), resourceSet({ SimulationResource::Target }), [this]() { trackTarget(); });
+	frameGraph.addPhase("SpatialIndex", resourceSet({ SimulationResource::Agents }), resourceSet({ SimulationResource::Grid }), [this]() { spatialGrid.build(agents, sf::Vector2u(gameWindowSize), &jobSystem); });
+	frameGraph.addPhase("Steering", resourceSet({ SimulationResource::Tick, SimulationResource::Agents, SimulationResource::Grid, SimulationResource::Target, SimulationResource::Obstacles, SimulationResource::Settings }), resourceSet({ SimulationResource::Steering }), [this]() { steerAgents(frameDeltaTime); });
+	// Integration also steers the follow chain waves when chain ordering is on
+	frameGraph.addPhase("Integration", resourceSet({ SimulationResource::Grid, SimulationResource::Steering, SimulationResource::Target, SimulationResource::Obstacles, SimulationResource::Settings }), resourceSet({ SimulationResource::Tick, SimulationResource::Agents }), [this]() { integrateAgents(); });
+	frameGraph.addPhase("RenderPrep", resourceSet({ SimulationResource::Agents, SimulationResource::Obstacles }), resourceSet({ SimulationResource::Snapshot }), [this]() { prepareRenderSnapshot(renderSnapshots.back()); });
+	frameGraph.addPhase("Record", resourceSet({ SimulationResource::Tick, SimulationResource::Agents }), resourceSet({ SimulationResource::Recording }), [this]() { recordTrajectories(); });
+	frameGraph.addPhase("Telemetry", resourceSet({ SimulationResource::Tick, SimulationResource::Agents }), resourceSet({ SimulationResource::Telemetry }), [this]() { publishTelemetry(); });
+	frameGraph.addPhase("Checkpoint", resourceSet({ SimulationResource::Tick, SimulationResource::Agents, SimulationResource::Obstacles, SimulationResource::Target }), resourceSet({ SimulationResource::Checkpoint }), [this]() { takeCheckpoint(); });
+	frameGraph.addPhase("HudStats", resourceSet({ SimulationResource::Agents, SimulationResource::Steering, SimulationResource::Settings }), resourceSet({ SimulationResource::Stats }), [this]() { gatherSimulationStats(); });
+	frameGraph.addPhase("Publish", resourceSet({ SimulationResource::Tick, SimulationResource::Stats }), resourceSet({ SimulationResource::Snapshot }), [this]() { publishRenderSnapshot(); });
+	frameGraph.compile();
+}
+
+void Game::trackTarget()
+{
+	if (scriptedTargets.empty())
+	{
+		targetPosition = simulationTarget.load();
+		return;
+	}
+
+	// Scripted targets take over from the mouse, each one holds until the next one's tick
+	while (nextScriptedTarget < scriptedTargets.size() && scriptedTargets[nextScriptedTarget].tick <= simulationTick)
+	{
+		targetPosition = scriptedTargets[nextScriptedTarget].position;
+		nextScriptedTarget++;
+	}
+}
+
+void Game::simulationLoop()
+{
+	// Agents move by their velocity once a tick, so ticks run at a fixed rate however fast the machine is
+	float accumulator = 0.0f;
+	sf::Clock tickIntervalClock;
+	simulationClock.restart();
+
+	while (simulationRunning)
+	{
+		accumulator += simulationClock.restart().asSeconds();
+		if (accumulator < FIXED_TIMESTEP)
+		{
+			// Sleep until the next tick is due instead of keeping a core busy
+			std::this_thread::sleep_for(std::chrono::duration<float>(FIXED_TIMESTEP - accumulator));
+			continue;
+		}
+
+		// After a stall only a few ticks are caught up, otherwise ticks slower than the rate would fall further and further behind
+		accumulator = std::min(accumulator, FIXED_TIMESTEP * MAX_CATCH_UP_TICKS);
+		while (accumulator >= FIXED_TIMESTEP && simulationRunning)
+		{
+			accumulator -= FIXED_TIMESTEP;
+
+			// The measured time between ticks is only used for the steering forces, it stays close to the timestep
+			frameDeltaTime = tickIntervalClock.restart().asSeconds();
+			if (fixedTimestep)
+			{
+				frameDeltaTime = FIXED_TIMESTEP;
+			}
+
+			// Only build a new snapshot once the render thread has picked up the last one
+			snapshotWanted = renderSnapshots.consumed();
+
+			sf::Clock tickClock;
+			beginTickAllocationCheck();
+			frameGraph.execute(jobSystem);
+			endTickAllocationCheck();
+			tickTimes.add(tickClock.getElapsedTime().asSeconds() * 1000.0f);
+
+			if (criticalPathRequested.exchange(false))
+			{
+				frameGraph.printCriticalPath(std::cout);
+				if (isAllocationTracking())
+				{
+					frameGraph.printAllocations(std::cout);
+				}
+				std::cout << "State hash at tick " << simulationTick << ": " << std::hex << simulationStats.stateHash << std::dec << std::endl;
+			}
+		}
+	}
+}
+
+void Game::replayLoop()
+{
+	sf::Clock replayClock;
+	replayTick = replay->getCurrentTick();
+
+	while (simulationRunning)
+	{
+		float deltaTime = replayClock.restart().asSeconds();
+		applyReplayCommands();
+
+		if (!replayPaused)
+		{
+			replayTick = std::min(replayTick + deltaTime * REPLAY_TICK_RATE * replaySpeed, static_cast<double>(replay->getLastTick()));
+		}
+
+		// Normal playback only decodes the frames in between, big jumps seek from a keyframe
+		unsigned int tick = static_cast<unsigned int>(replayTick);
+		if (tick != replay->getCurrentTick() && !replay->advanceTo(tick))
+		{
+			std::cerr << "The recording is damaged around tick " << tick << ", playback has stopped" << std::endl;
+			replayPaused = true;
+		}
+
+		if (renderSnapshots.consumed())
+		{
+			publishReplaySnapshot();
+		}
+		else
+		{
+			// Nothing to do until the render thread takes the last frame
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
+
+void Game::applyReplayCommands()
+{
+	// Anything that would change the world is dropped, only the playback controls do anything
+	SimulationCommand command;
+	while (simulationCommands.pop(command))
+	{
+		double seekTarget = -1.0;
+		switch (command.type)
+		{
+		case SimulationCommandType::ReplayTogglePause:
+			replayPaused = !replayPaused;
+			break;
+		case SimulationCommandType::ReplayFaster:
+			replaySpeed = std::min(replaySpeed * 2.0f, REPLAY_MAX_SPEED);
+			break;
+		case SimulationCommandType::ReplaySlower:
+			replaySpeed = std::max(replaySpeed * 0.5f, REPLAY_MIN_SPEED);
+			break;
+		case SimulationCommandType::ReplaySeekForward:
+			seekTarget = std::min(replayTick + REPLAY_SEEK_TICKS, static_cast<double>(replay->getLastTick()));
+			break;
+		case SimulationCommandType::ReplaySeekBack:
+			seekTarget = std::max(replayTick - REPLAY_SEEK_TICKS, static_cast<double>(replay->getFirstTick()));
+			break;
+		case SimulationCommandType::ReplayRestart:
+			seekTarget = replay->getFirstTick();
+			break;
+		default:
+			break;
+		}
+
+		if (seekTarget >= 0.0)
+		{
+			sf::Clock seekClock;
+			replayTick = seekTarget;
+			replay->seek(static_cast<unsigned int>(replayTick));
+			replaySeekMilliseconds = seekClock.getElapsedTime().asSeconds() * 1000.0f;
+		}
+	}
+}
+
+void Game::publishReplaySnapshot()
+{
+	RenderSnapshot& snapshot = renderSnapshots.back();
+
+	const std::vector<TrajectorySample>& samples = replay->getSamples();
+	float positionScale = replay->getPositionScale();
+	float velocityScale = replay->getVelocityScale();
+	auto agentView = [&](unsigned int i) {
+		const TrajectorySample& sample = samples[i];
+		MovementBehavior behavior = static_cast<MovementBehavior>(std::min<std::uint32_t>(sample.behavior, MOVEMENT_BEHAVIOR_COUNT - 1));
+		return AgentRenderView{ behavior, sf::Vector2f(sample.positionX / positionScale, sample.positionY / positionScale), sf::Vector2f(sample.velocityX / velocityScale, sample.velocityY / velocityScale) };
+	};
+	buildAgentQuads(snapshot, static_cast<unsigned int>(samples.size()), agentView);
+
+	// Recordings only hold the agents
+	snapshot.obstacleVersion = obstacleVersion;
+	snapshot.obstacles.clear();
+
+	snapshot.tick = replay->getCurrentTick();
+	snapshot.stats.replay.active = true;
+	snapshot.stats.replay.paused = replayPaused;
+	snapshot.stats.replay.speed = replaySpeed;
+	snapshot.stats.replay.firstTick = replay->getFirstTick();
+	snapshot.stats.replay.lastTick = replay->getLastTick();
+	snapshot.stats.replay.keyframeCount = replay->getKeyframeCount();
+	snapshot.stats.replay.lastSeekMilliseconds = replaySeekMilliseconds;
+	renderSnapshots.publish();
+}
+
+void Game::prepareRenderSnapshot(RenderSnapshot& snapshot)
+{
+	if (!snapshotWanted)
+	{
+		return;
+	}
+
+	auto agentView = [this](unsigned int i) {
+		const Agent& agent = *agents[i];
+		return AgentRenderView{ agent.getBehavior(), agent.getPosition(), agent.getVelocity() };
+	};
+	buildAgentQuads(snapshot, static_cast<unsigned int>(agents.size()), agentView);
+
+	snapshot.obstacleVersion = obstacleVersion;
+	snapshot.obstacles.clear();
+	for (unsigned int i = 0; i < obstacles.size(); ++i)
+	{
+		snapshot.obstacles.push_back({ obstacles.getCenter(i), obstacles.getRadius(i) });
+	}
+}
+
+template <typename AgentView>
+void Game::buildAgentQuads(RenderSnapshot& snapshot, unsigned int agentCount, const AgentView& agentView)
+{
+	unsigned int chunkCount = (agentCount + RENDER_PREP_CHUNK_SIZE - 1) / RENDER_PREP_CHUNK_SIZE;
+	renderPrepCounts.resize(chunkCount);
+	snapshot.agentCount = agentCount;
+
+	// Agents whose quad can't reach the window are left out, the quad is never bigger than its diagonal
+	sf::FloatRect visibleArea(0.0f, 0.0f, static_cast<float>(gameWindowSize.x), static_cast<float>(gameWindowSize.y));
+	auto isVisible = [&](const AgentRenderView& agent) {
+		sf::Vector2f size = agentQuadSizes[static_cast<int>(agent.behavior)];
+		float reach = vectorMagnitude(size) * 0.5f;
+		return agent.position.x + reach >= visibleArea.left && agent.position.x - reach <= visibleArea.left + visibleArea.width
+			&& agent.position.y + reach >= visibleArea.top && agent.position.y - reach <= visibleArea.top + visibleArea.height;
+	};
+
+	// Count the visible agents of each behaviour in each chunk
+	auto countChunks = [&](unsigned int begin, unsigned int end) {
+		for (unsigned int chunk = begin; chunk < end; ++chunk)
+		{
+			std::array<unsigned int, MOVEMENT_BEHAVIOR_COUNT>& counts = renderPrepCounts[chunk];
+			counts.fill(0);
+
+			unsigned int last = std::min(agentCount, (chunk + 1) * RENDER_PREP_CHUNK_SIZE);
+			for (unsigned int i = chunk * RENDER_PREP_CHUNK_SIZE; i < last; ++i)
+			{
+				AgentRenderView agent = agentView(i);
+				if (isVisible(agent))
+				{
+					counts[static_cast<int>(agent.behavior)]++;
+				}
+			}
+		}
+	};
+	jobSystem.parallelFor(0, chunkCount, 1, nullptr, 0, countChunks);
+
+	// Turn the counts into where each chunk's quads start in each behaviour's vertices
+	for (int behavior = 0; behavior < MOVEMENT_BEHAVIOR_COUNT; ++behavior)
+	{
+		unsigned int total = 0;
+		for (unsigned int chunk = 0; chunk < chunkCount; ++chunk)
+		{
+			unsigned int count = renderPrepCounts[chunk][behavior];
+			renderPrepCounts[chunk][behavior] = total;
+			total += count;
+		}
+		snapshot.agentQuads[behavior].resize(total * 4);
+	}
+
+	// Each chunk writes its quads, the corners are the sprite's corners turned to face along the velocity
+	auto writeChunks = [&](unsigned int begin, unsigned int end) {
+		for (unsigned int chunk = begin; chunk < end; ++chunk)
+		{
+			std::array<unsigned int, MOVEMENT_BEHAVIOR_COUNT>& cursors = renderPrepCounts[chunk];
+
+			unsigned int last = std::min(agentCount, (chunk + 1) * RENDER_PREP_CHUNK_SIZE);
+			for (unsigned int i = chunk * RENDER_PREP_CHUNK_SIZE; i < last; ++i)
+			{
+				AgentRenderView agent = agentView(i);
+				if (!isVisible(agent))
+				{
+					continue;
+				}
+
+				int behavior = static_cast<int>(agent.behavior);
+				sf::Vector2f halfSize = agentQuadSizes[behavior] * 0.5f;
+				sf::Vector2f textureSize(agentTextures[behavior].getSize());
+
+				// A stopped agent faces along the x axis, the same as a sprite with no rotation
+				sf::Vector2f forward = normalize(agent.velocity);
+				if (forward.x == 0.0f && forward.y == 0.0f)
+				{
+					forward = sf::Vector2f(1.0f, 0.0f);
+				}
+				sf::Vector2f side(-forward.y, forward.x);
+				sf::Vector2f position = agent.position;
+
+				sf::Vertex* quad = &snapshot.agentQuads[behavior][cursors[behavior]++ * 4];
+				quad[0] = sf::Vertex(position - forward * halfSize.x - side * halfSize.y, sf::Vector2f(0.0f, 0.0f));
+				quad[1] = sf::Vertex(position + forward * halfSize.x - side * halfSize.y, sf::Vector2f(textureSize.x, 0.0f));
+				quad[2] = sf::Vertex(position + forward * halfSize.x + side * halfSize.y, textureSize);
+				quad[3] = sf::Vertex(position - forward * halfSize.x + side * halfSize.y, sf::Vector2f(0.0f, textureSize.y));
+			}
+		}
+	};
+	jobSystem.parallelFor(0, chunkCount, 1, nullptr, 0, writeChunks);
+}
+
+void Game::gatherSimulationStats()
+{
+	simulationStats.accumulation = steeringSettings.accumulation;
+	if (steeringSettings.accumulation == ForceAccumulation::Prioritized)
+	{
+		// Total up how often each behaviour has been skipped across all agents
+		for (int i = 0; i < STEERING_BEHAVIOR_COUNT; ++i)
+		{
+			SteeringBehavior behavior = static_cast<SteeringBehavior>(i);
+			unsigned long long skipped = 0;
+			for (const auto& agentPtr : agents)
+			{
+				skipped += agentPtr->getSkipCount(behavior);
+			}
+			simulationStats.skipCounts[i] = skipped;
+		}
+	}
+
+	// Sample how busy the workers have been and how long the ticks take a couple of times a second
+	if (workerStatsClock.getElapsedTime().asSeconds() > WORKER_STATS_INTERVAL)
+	{
+		jobSystem.sampleStats(simulationStats.workerStats);
+		tickTimes.getPercentiles(simulationStats.tickTimes);
+		workerStatsClock.restart();
+	}
+
+	simulationStats.timeSlicing = timeSlicing;
+	simulationStats.lodEnabled = lodEnabled;
+	simulationStats.activeAgentCount = activeAgentCount;
+	simulationStats.sleepingAgentCount = sleepingAgentCount;
+	simulationStats.reducedRateAgentCount = reducedRateAgentCount;
+	simulationStats.neighborQueries = neighborQueryCount;
+	simulationStats.neighborCandidates = neighborCandidateCount;
+	simulationStats.fixedTimestep = fixedTimestep;
+	simulationStats.fastMath = steeringSettings.fastMath;
+	simulationStats.chainOrdering = chainOrdering;
+	simulationStats.followWaveCount = followWaveStarts.empty() ? 0 : static_cast<unsigned int>(followWaveStarts.size() - 1);
+	simulationStats.checkpointing = checkpointing;
+	simulationStats.checkpointStats = checkpointWriter.getStats();
+	simulationStats.recording = trajectoryRecorder.isRecording();
+	simulationStats.recordingStats = trajectoryRecorder.getStats();
+	simulationStats.telemetry = telemetryPublisher.isPublishing();
+	simulationStats.telemetryStats = telemetryPublisher.getStats();
+	simulationStats.allocationTracking = isAllocationTracking();
+	simulationStats.tickAllocations = frameGraph.getFrameAllocations();
+	simulationStats.tickAllocatedBytes = frameGraph.getFrameAllocatedBytes();
+	simulationStats.heaviestAllocatingPhase = frameGraph.getHeaviestAllocatingPhase();
+	simulationStats.stateHash = hashSimulationState();
+}
+
+std::uint64_t Game::hashSimulationState()
+{
+	// Each agent's hash is added rather than chained so the total doesn't depend on which worker hashed which batch
+	std::atomic<std::uint64_t> stateHash = 0;
+	auto hashBatch = [&](unsigned int begin, unsigned int end) {
+		std::uint64_t batchHash = 0;
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			batchHash += agents[i]->stateHash();
+		}
+		stateHash += batchHash;
+	};
+	jobSystem.parallelFor(0, static_cast<unsigned int>(agents.size()), AGENT_BATCH_SIZE, nullptr, 0, hashBatch);
+
+	return stateHash;
+}
+
+void Game::beginTickAllocationCheck()
+{
+	// Only settled ticks record their call sites, walking the stack of every allocation while the world is changing would crawl
+	allocationCheckTick = simulationTick;
+	allocationCheckArmed = assertNoAllocations && isAllocationTracking() && simulationTick >= allocationSettleTick;
+	setAllocationSiteCapture(allocationCheckArmed);
+
+	// Sites left over from a tick a command exempted would show up in the report and could fill the table
+	if (allocationCheckArmed)
+	{
+		clearAllocationSites();
+	}
+}
+
+void Game::endTickAllocationCheck()
+{
+	// A command applied during the tick starts the settling again, so whatever it allocated is expected
+	if (!allocationCheckArmed || allocationSettleTick > allocationCheckTick || frameGraph.getFrameAllocations() == 0)
+	{
+		return;
+	}
+
+	setAllocationSiteCapture(false);
+	std::vector<AllocationSite> sites;
+	std::uint64_t dropped = takeAllocationSites(sites);
+
+	std::cerr << "Tick " << allocationCheckTick << " allocated " << frameGraph.getFrameAllocations() << " times (" << frameGraph.getFrameAllocatedBytes() << " bytes) after the simulation had settled\n";
+	frameGraph.printAllocations(std::cerr);
+	for (const AllocationSite& site : sites)
+	{
+		std::cerr << "  " << site.allocations << " allocations, " << site.bytes << " bytes in " << frameGraph.getPhaseName(static_cast<unsigned int>(site.scope)) << ":\n";
+		printAllocationSite(site, std::cerr);
+	}
+	if (dropped > 0)
+	{
+		std::cerr << "  " << dropped << " more allocations from call sites that didn't fit\n";
+	}
+	std::cerr.flush();
+	std::abort();
+}
+
+void Game::publishRenderSnapshot()
+{
+	if (!snapshotWanted)
+	{
+		return;
+	}
+
+	RenderSnapshot& snapshot = renderSnapshots.back();
+	snapshot.tick = simulationTick;
+	snapshot.stats = simulationStats;
+	renderSnapshots.publish();
+}
+
+void Game::appendHudText(size_t& length, const char* format, ...)
+{
+	if (length + 1 >= hudText.size())
+	{
+		return;
+	}
+
+	va_list arguments;
+	va_start(arguments, format);
+	int written = std::vsnprintf(hudText.data() + length, hudText.size() - length, format, arguments);
+	va_end(arguments);
+
+	if (written > 0)
+	{
+		length = std::min(length + written, hudText.size() - 1);
+	}
+}
+
+void Game::buildHudText(const RenderSnapshot& snapshot, float elapsedSeconds)
+{
+	const SimulationStats& stats = snapshot.stats;
+	size_t length = 0;
+
+	FrameTimePercentiles frame;
+	FrameTimePercentiles render;
+	frameTimes.getPercentiles(frame);
+	renderTimes.getPercentiles(render);
+	const FrameTimePercentiles& tick = stats.tickTimes;
+
+	// Rates over the time since the text was last rebuilt
+	float framesPerSecond = hudFrames / elapsedSeconds;
+	float agentUpdatesPerSecond = static_cast<float>(snapshot.tick - hudTick) * snapshot.agentCount / elapsedSeconds;
+	float allocationsPerFrame = static_cast<float>(getAllocationCount() - hudAllocations) / std::max(hudFrames, 1u);
+
+	appendHudText(length, "Frame ms   p50 %6.2f  p95 %6.2f  p99 %6.2f  (%.0f fps)\n", frame.p50, frame.p95, frame.p99, framesPerSecond);
+	appendHudText(length, "Tick ms    p50 %6.2f  p95 %6.2f  p99 %6.2f\n", tick.p50, tick.p95, tick.p99);
+	appendHudText(length, "Render ms  p50 %6.2f  p95 %6.2f  p99 %6.2f\n", render.p50, render.p95, render.p99);
+	appendHudText(length, "Agents: %u, %.2fM agent updates/s\n", snapshot.agentCount, agentUpdatesPerSecond / 1e6f);
+	appendHudText(length, "Neighbour queries: %llu/tick, %.1f candidates each\n", stats.neighborQueries, stats.neighborQueries > 0 ? static_cast<double>(stats.neighborCandidates) / stats.neighborQueries : 0.0);
+	appendHudText(length, "Allocations: %.1f/frame\n", allocationsPerFrame);
+	appendHudText(length, "Allocation tracking: %s (A)", stats.allocationTracking ? "on" : "off");
+	if (stats.allocationTracking)
+	{
+		appendHudText(length, ", %llu allocations, %llu bytes last tick", stats.tickAllocations, stats.tickAllocatedBytes);
+		if (stats.heaviestAllocatingPhase != nullptr)
+		{
+			appendHudText(length, ", most in %s", stats.heaviestAllocatingPhase);
+		}
+	}
+	appendHudText(length, "\n");
+
+	if (stats.accumulation == ForceAccumulation::Prioritized)
+	{
+		appendHudText(length, "Force accumulation: prioritized (P)\n");
+		for (int i = 0; i < STEERING_BEHAVIOR_COUNT; ++i)
+		{
+			if (stats.skipCounts[i] > 0)
+			{
+				appendHudText(length, "  %s skipped: %llu\n", steeringBehaviorName(static_cast<SteeringBehavior>(i)), stats.skipCounts[i]);
+			}
+		}
+	}
+	else
+	{
+		appendHudText(length, "Force accumulation: weighted sum (P)\n");
+	}
+
+	appendHudText(length, "Time slicing: %s (T)\n", stats.timeSlicing ? "on" : "off");
+
+	appendHudText(length, "Level of detail: %s (L)\n", stats.lodEnabled ? "on" : "off");
+	if (stats.lodEnabled)
+	{
+		appendHudText(length, "  Active: %u Sleeping: %u Reduced rate: %u\n", stats.activeAgentCount, stats.sleepingAgentCount, stats.reducedRateAgentCount);
+	}
+
+	appendHudText(length, "Follow chain ordering: %s (Q), %u waves\n", stats.chainOrdering ? "on" : "off", stats.followWaveCount);
+	appendHudText(length, "Fast math: %s (M)\n", stats.fastMath ? "on" : "off");
+	appendHudText(length, "Fixed timestep: %s (F)\n", stats.fixedTimestep ? "on" : "off");
+	appendHudText(length, "Checkpoints: %s (K)", stats.checkpointing ? "on" : "off");
+	if (stats.checkpointStats.written > 0)
+	{
+		const CheckpointStats& checkpoints = stats.checkpointStats;
+		appendHudText(length, ", %u written, %u skipped, stall %.2fms (max %.2fms), write %.2fms", checkpoints.written, checkpoints.skipped, checkpoints.lastStallMilliseconds, checkpoints.maxStallMilliseconds, checkpoints.lastWriteMilliseconds);
+	}
+	appendHudText(length, "\n");
+	appendHudText(length, "Recording: %s (R)", stats.recording ? "on" : "off");
+	if (stats.recording)
+	{
+		const TrajectoryRecorderStats& recording = stats.recordingStats;
+		appendHudText(length, ", %u frames, %u dropped, %llu KB", recording.framesWritten, recording.framesDropped, recording.writtenBytes / 1024);
+		if (recording.writtenBytes > 0)
+		{
+			appendHudText(length, " (%.1f:1)", static_cast<float>(recording.sampleBytes) / recording.writtenBytes);
+		}
+	}
+	appendHudText(length, "\n");
+	appendHudText(length, "Telemetry: %s (E)", stats.telemetry ? "on" : "off");
+	if (stats.telemetry)
+	{
+		const TelemetryStats& telemetry = stats.telemetryStats;
+		appendHudText(length, ", %llu frames, %llu truncated, publish %.2fms", telemetry.framesPublished, telemetry.framesTruncated, telemetry.lastPublishMilliseconds);
+	}
+	appendHudText(length, "\n");
+	appendHudText(length, "State hash: %llx @ tick %u\n", static_cast<unsigned long long>(stats.stateHash), snapshot.tick);
+
+	appendHudText(length, "Workers:");
+	for (const WorkerStats& worker : stats.workerStats)
+	{
+		appendHudText(length, " %d%%", static_cast<int>(worker.utilisation * 100.0f));
+	}
+	appendHudText(length, "\n");
+}
+
+void Game::buildReplayHudText(const RenderSnapshot& snapshot)
+{
+	const ReplayStats& replayStats = snapshot.stats.replay;
+	size_t length = 0;
+	appendHudText(length, "Replay: tick %u of %u - %u%s (Space)\n", snapshot.tick, replayStats.firstTick, replayStats.lastTick, replayStats.paused ? ", paused" : "");
+	appendHudText(length, "Agents: %u\n", snapshot.agentCount);
+	appendHudText(length, "Speed: %gx (Up/Down)\n", replayStats.speed);
+	appendHudText(length, "Seek: %u ticks (Left/Right), start (Home), last seek %.2fms\n", REPLAY_SEEK_TICKS, replayStats.lastSeekMilliseconds);
+	appendHudText(length, "Keyframes: %u\n", replayStats.keyframeCount);
+}
+
+void Game::update()
+{
+	pollEvents();
+
+	float dt = clock.restart().asSeconds();
+	frameTimes.add(dt * 1000.0f);
+	hudFrames++;
+
+	updateMousePositions(dt);
+
+	// Hand the mouse over to the simulation thread as the target
+	simulationTarget.store(mousePosWindow);
+
+	renderSnapshots.acquire();
+	const RenderSnapshot& snapshot = renderSnapshots.front();
+
+	float hudSeconds = hudClock.getElapsedTime().asSeconds();
+	if (hudSeconds < HUD_REFRESH_INTERVAL)
+	{
+		return;
+	}
+
+	if (snapshot.stats.replay.active)
+	{
+		buildReplayHudText(snapshot);
+	}
+	else
+	{
+		buildHudText(snapshot, hudSeconds);
+	}
+	debugText.setString(hudText.data());
+
+	hudClock.restart();
+	hudFrames = 0;
+	hudTick = snapshot.tick;
+	hudAllocations = getAllocationCount();
+}
+
+void Game::render()
+{
+	const RenderSnapshot& snapshot = renderSnapshots.front();
+	sf::Clock renderClock;
+
+	//Game Window
+	gameWindow->clear(sf::Color::Black);
+
+	//Draw Game Objects
+	for (int i = 0; i < MOVEMENT_BEHAVIOR_COUNT; ++i)
+	{
+		const std::vector<sf::Vertex>& quads = snapshot.agentQuads[i];
+		if (!quads.empty())
+		{
+			gameWindow->draw(quads.data(), quads.size(), sf::Quads, &agentTextures[i]);
+		}
+	}
+
+	// Rebuild the obstacle sprites when the simulation has changed the obstacles
+	if (obstacleDrawablesVersion != snapshot.obstacleVersion)
+	{
+		obstacleDrawables.clear();
+		for (const ObstacleRenderData& obstacle : snapshot.obstacles)
+		{
+			obstacleDrawables.push_back(std::make_unique<Obstacle>(obstacle.position, obstacle.radius));
+		}
+		obstacleDrawablesVersion = snapshot.obstacleVersion;
+	}
+
+	for (const auto& obstaclePtr : obstacleDrawables)
+	{
+		gameWindow->draw(*obstaclePtr);
+	}
+
+	//Draw Ui
+	gameWindow->draw(debugText);
+
+	gameWindow->display();
+
+	//UI Window
+	uiWindow->clear(sf::Color::Black);
+	for (const auto& button : behaviourButtons) {
+		uiWindow->draw(*button);
+	}
+	for (const auto& button : functionalButtons) {
+		uiWindow->draw(*button);
+	}
+	uiWindow->display();
+
+	renderTimes.add(renderClock.getElapsedTime().asSeconds() * 1000.0f);
 }
 
 void Game::reset()
 {
 	agents.clear();
+	followOrderDirty = true;
 	std::cout << "Game has been reset. All agents have been cleared." << std::endl;
 }
\ No newline at end of file
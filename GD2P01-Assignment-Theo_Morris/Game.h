@@ -12,17 +12,129 @@ Mail : theo.morris@mds.ac.nz
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <initializer_list>
 #include <iostream>
+#include <thread>
 #include <vector>
 #include "Agent.h"
 #include "Obstacle.h"
+#include "ObstacleTable.h"
 #include "Button.h"
+#include "CheckpointWriter.h"
+#include "CommandQueue.h"
+#include "FrameGraph.h"
+#include "FrameTimeTracker.h"
+#include "JobSystem.h"
+#include "SimulationCommand.h"
+#include "SpatialGrid.h"
+#include "Telemetry.h"
+#include "TrajectoryReader.h"
+#include "TrajectoryRecorder.h"
+#include "RenderSnapshot.h"
+#include "Scenario.h"
+#include "TripleBuffer.h"
+#include "WorldSnapshot.h"
 
 #include <SFML/Graphics.hpp>
 
+// how many agents the job system hands out in one batch
+const unsigned int AGENT_BATCH_SIZE = 256;
+
+const float WORKER_STATS_INTERVAL = 0.5f;
+
+// how often the performance HUD's text is rebuilt, formatting it every frame would cost more than it shows
+const float HUD_REFRESH_INTERVAL = 0.25f;
+const unsigned int HUD_TEXT_CAPACITY = 4096;
+
+// follow waves smaller than this run straight on the simulation thread, handing them to the workers costs more than it saves
+const unsigned int INLINE_WAVE_SIZE = 64;
+
+// agents per chunk of the render preparation, each chunk counts and then writes its own visible agents' quads
+const unsigned int RENDER_PREP_CHUNK_SIZE = 4096;
+const float AGENT_SPRITE_SCALE = 0.1f;
+
+// length of a simulation tick, also the step used instead of the measured tick time when the fixed timestep is on so runs can be repeated exactly
+const float FIXED_TIMESTEP = 1.0f / 60.0f;
+
+// most ticks the simulation thread runs back to back to catch up after a stall
+const unsigned int MAX_CATCH_UP_TICKS = 5;
+
+// how often a headless run prints its progress and state hash
+const unsigned int HEADLESS_REPORT_INTERVAL = 1000;
+
+// how many ticks apart the background checkpoints are taken when they are on
+const unsigned int CHECKPOINT_INTERVAL = 600;
+
+// replays run at this many ticks a second at normal speed, the rate of the fixed timestep
+const float REPLAY_TICK_RATE = 60.0f;
+const float REPLAY_MIN_SPEED = 0.25f;
+const float REPLAY_MAX_SPEED = 64.0f;
+
+// how far the arrow keys jump through a replay
+const unsigned int REPLAY_SEEK_TICKS = 600;
+
+// ticks after the start or the last command before the no allocation check applies, buffers are still growing to fit until then
+const unsigned int ALLOCATION_SETTLE_TICKS = 120;
+
+// How the game is started, a headless game opens no windows and is stepped with runHeadless
+struct GameOptions {
+	bool headless = false;
+	const Scenario* scenario = nullptr;
+
+	// records the run's trajectories from the first tick when set
+	std::string recordingPath;
+
+	// plays back a recording instead of running the simulation, the reader must outlive the game
+	TrajectoryReader* replay = nullptr;
+
+	// threads the simulation runs on, including the one stepping it, zero for one less than the hardware has
+	unsigned int threadCount = 0;
+
+	// publishes every tick to the shared memory telemetry ring from the first tick
+	bool telemetry = false;
+
+	// counts the heap allocations of each phase from the first tick
+	bool trackAllocations = false;
+
+	// stops the program and prints the call sites if a tick allocates once the simulation has settled, tracks allocations too
+	bool assertNoAllocations = false;
+};
+
+// Everything the simulation phases read and write, used by the frame graph to work out which phases can overlap
+enum class SimulationResource {
+	Commands,
+	Input,
+	Tick,
+	Target,
+	Settings,
+	Agents,
+	Obstacles,
+	Grid,
+	Steering,
+	Stats,
+	Snapshot,
+	Checkpoint,
+	Recording,
+	Telemetry
+};
+
+inline ResourceSet resourceSet(std::initializer_list<SimulationResource> resources)
+{
+	ResourceSet set = 0;
+	for (SimulationResource resource : resources)
+	{
+		set |= 1u << static_cast<unsigned int>(resource);
+	}
+	return set;
+}
+
 class Game
 {
 private:
+	bool headless = false;
+
 	sf::Vector2i gameWindowSize;
 	sf::RenderWindow* gameWindow;
 
@@ -38,6 +150,15 @@ private:
 	sf::Font font;
 	sf::Text debugText;
 
+	// performance HUD, the render thread keeps the frame and render times and rebuilds the text every HUD_REFRESH_INTERVAL
+	FrameTimeTracker frameTimes;
+	FrameTimeTracker renderTimes;
+	sf::Clock hudClock;
+	unsigned int hudFrames = 0;
+	unsigned int hudTick = 0;
+	std::uint64_t hudAllocations = 0;
+	std::array<char, HUD_TEXT_CAPACITY> hudText = {};
+
 	float buttonWidth = 260.0f;
 	float buttonHeight = 60.0f;
 	float buttonSpacing = 15.0f;
@@ -45,30 +166,221 @@ private:
 	std::vector<std::unique_ptr<Button>> behaviourButtons;
 	std::vector<std::unique_ptr<Button>> functionalButtons;
 
-	//Game objects
+	std::array<sf::Texture, MOVEMENT_BEHAVIOR_COUNT> agentTextures;
+
+	// size of each behaviour's quad, set before the simulation thread starts and only read after
+	std::array<sf::Vector2f, MOVEMENT_BEHAVIOR_COUNT> agentQuadSizes;
+
+	//Game objects, owned by the simulation thread once it has started
 	std::vector<std::unique_ptr<Agent>> agents;
-	std::vector<std::unique_ptr<Obstacle>> obstacles;
+	ObstacleTable obstacles;
+	SpatialGrid spatialGrid;
+
+	// workers the agent updates are spread over, the simulation thread works as one of them
+	JobSystem jobSystem;
+	sf::Clock workerStatsClock;
+
+	// the phases of a simulation tick
+	FrameGraph frameGraph;
+	float frameDeltaTime = 0.0f;
+	SimulationStats simulationStats;
+	FrameTimeTracker tickTimes;
+	std::atomic<bool> criticalPathRequested = false;
+
+	// render preparation is skipped while the render thread hasn't taken the last snapshot, it would never be seen
+	bool snapshotWanted = true;
+	std::vector<std::array<unsigned int, MOVEMENT_BEHAVIOR_COUNT>> renderPrepCounts;
 
 	MovementBehavior currentSelectedBehaviour = MovementBehavior::Wander;
+	SteeringSettings steeringSettings;
+	bool timeSlicing = false;
+
+	unsigned int nextAgentId = 0;
+	unsigned int simulationSeed = DEFAULT_SIMULATION_SEED;
+	bool fixedTimestep = false;
+	// the Tick resource, Integration moves it on and loading a world sets it
+	unsigned int simulationTick = 0;
+	unsigned int obstacleVersion = 0;
+
+	// level of detail, the counts are added to by every batch of the steering pass
+	bool lodEnabled = false;
+	std::atomic<unsigned int> activeAgentCount = 0;
+	std::atomic<unsigned int> sleepingAgentCount = 0;
+	std::atomic<unsigned int> reducedRateAgentCount = 0;
+
+	// neighbour searches this tick and how many agents they measured the distance to, added to the same way
+	std::atomic<unsigned long long> neighborQueryCount = 0;
+	std::atomic<unsigned long long> neighborCandidateCount = 0;
+
+	// follow chains, agents that steer from the agent they follow update in waves after it has moved
+	bool chainOrdering = false;
+	bool followOrderDirty = false;
+	std::vector<unsigned int> followWaveStarts;
+	std::vector<unsigned int> followWaveAgents;
+
+	// replaying a recording, the simulation thread runs the playback and nothing is simulated
+	TrajectoryReader* replay = nullptr;
+	double replayTick = 0.0;
+	float replaySpeed = 1.0f;
+	bool replayPaused = false;
+	float replaySeekMilliseconds = 0.0f;
+
+	// world snapshots, the buffer is kept between saves and the table maps agent ids to their place in the agents vector
+	WorldSnapshotBuffer worldSnapshotBuffer;
+	std::vector<std::int32_t> agentIndexById;
+
+	// periodic checkpoints, copied into a snapshot buffer between ticks and written out on the checkpoint writer's thread
+	bool checkpointing = false;
+	CheckpointWriter checkpointWriter;
+
+	// every tick's agent states, quantised here and coded and written on the recorder's own thread
+	TrajectoryRecorder trajectoryRecorder;
+
+	// every tick's agent states written straight into shared memory for other processes to watch
+	TelemetryPublisher telemetryPublisher;
+
+	// the no allocation check, settled ticks record the call site of every allocation and stop the program if there are any
+	bool assertNoAllocations = false;
+	bool allocationCheckArmed = false;
+	unsigned int allocationCheckTick = 0;
+	unsigned int allocationSettleTick = ALLOCATION_SETTLE_TICKS;
+
+	// Simulation thread
+	std::thread simulationThread;
+	std::atomic<bool> simulationRunning = false;
+	sf::Clock simulationClock;
+
+	// the mouse position written by the input thread and the copy the simulation works from during a tick
+	std::atomic<sf::Vector2i> simulationTarget;
+	sf::Vector2i targetPosition;
+
+	// targets from the scenario, when there are any they move the target instead of the mouse.
+	// The cursor belongs to the Target resource along with targetPosition
+	std::vector<ScenarioTarget> scriptedTargets;
+	size_t nextScriptedTarget = 0;
+
+	// structural changes from the input thread, applied by the simulation thread between ticks
+	CommandQueue<SimulationCommand, SIMULATION_COMMAND_CAPACITY> simulationCommands;
+
+	// snapshots passed from the simulation thread to the render thread
+	TripleBuffer<RenderSnapshot> renderSnapshots;
+
+	// the render thread's own obstacle sprites, built from the snapshot, obstacles are only drawables on this side
+	std::vector<std::unique_ptr<Obstacle>> obstacleDrawables;
+	unsigned int obstacleDrawablesVersion = 0;
 
 	void initWindow();
 	void initUiWindow();
 	void initGame();
 	void initUi();
+	void initTextures();
 	void initObstacles();
+	void applyScenario(const Scenario& scenario);
+	void addAgent(int spawnPositionX, int spawnPositionY, MovementBehavior agentMovementBehaviour);
+	void trackTarget();
+
+	void keyPressed(sf::Keyboard::Key key);
+	void queueCommand(const SimulationCommand& command);
+	void applySimulationCommands();
+
+	void initFrameGraph();
+	void simulationLoop();
+	void replayLoop();
+	void applyReplayCommands();
+	void publishReplaySnapshot();
+	void replayKeyPressed(sf::Keyboard::Key key);
+	void prepareRenderSnapshot(RenderSnapshot& snapshot);
+
+	// What render preparation needs to know about one agent, live or replayed
+	struct AgentRenderView {
+		MovementBehavior behavior;
+		sf::Vector2f position;
+		sf::Vector2f velocity;
+	};
+
+	// Builds the snapshot's quads in parallel, agentView(i) gives the AgentRenderView of agent i
+	template <typename AgentView>
+	void buildAgentQuads(RenderSnapshot& snapshot, unsigned int agentCount, const AgentView& agentView);
+	void gatherSimulationStats();
+	void rebuildFollowOrder();
+	void steerAgentRange(const SteeringContext& context, const unsigned int* order, unsigned int begin, unsigned int end, const unsigned int* splitPoints, unsigned int splitPointCount, bool skipFollowers);
+	void integrateAgentRange(const unsigned int* order, unsigned int begin, unsigned int end, const unsigned int* splitPoints, unsigned int splitPointCount, bool skipFollowers);
+	std::uint64_t hashSimulationState();
+	void captureWorldSnapshot(WorldSnapshotBuffer& buffer);
+	void writeAgentStates(AgentState* states);
+	void takeCheckpoint();
+	void recordTrajectories();
+	void startRecording(const std::string& path);
+	void publishTelemetry();
+	void publishRenderSnapshot();
+	void beginTickAllocationCheck();
+	void endTickAllocationCheck();
+
+	// Adds printf style text to the end of hudText, anything past its capacity is cut off
+	void appendHudText(size_t& length, const char* format, ...);
+	void buildHudText(const RenderSnapshot& snapshot, float elapsedSeconds);
+	void buildReplayHudText(const RenderSnapshot& snapshot);
 
 public:
-	Game();
+	Game(const GameOptions& options = GameOptions());
 	~Game();
 
 	const bool isRunning() const;
 
+	/***
+	 * Runs the simulation on the calling thread with a fixed timestep, only for headless games.
+	 * @param ticks How many ticks to run.
+	 * @param output Where the progress and the final state hash are printed.
+	 ***/
+	void runHeadless(unsigned int ticks, std::ostream& output);
+
+	// Runs a single fixed timestep tick, only for headless games
+	void stepHeadless();
+
+	/***
+	 * Copies every agent's state, in the order of the agents vector, only called between ticks.
+	 * @param states Replaced with the agents' states.
+	 ***/
+	void getAgentStates(std::vector<AgentState>& states);
+
+	unsigned int getSimulationTick() const { return simulationTick; }
+
+	// the stats gathered at the end of the last tick
+	const SimulationStats& getSimulationStats() const { return simulationStats; }
+
+	/***
+	 * Saves the whole world to a snapshot file, only called between ticks.
+	 * @param path The file to write.
+	 * @return True if the snapshot was saved.
+	 ***/
+	bool saveWorldSnapshot(const std::string& path);
+
+	/***
+	 * Replaces the world with the one in a snapshot file, only called between ticks.
+	 * @param path The file to load.
+	 * @return True if the snapshot was loaded, the world is left alone if it wasn't.
+	 ***/
+	bool loadWorldSnapshot(const std::string& path);
+
 	void spawnAgent(int spawnPositionX, int spawnPositionY, MovementBehavior agentMovementBehaviour);
 	void spawnObstacle(float spawnPositionX, float spawnPositionY, float radius);
+	void despawnAgent(float positionX, float positionY);
 
-	void updateAgents(float deltaTime);
+	void steerAgents(float deltaTime);
+	void integrateAgents();
 	void updateMousePositions(float deltaTime);
 
+	void toggleForceAccumulation();
+	void toggleTimeSlicing();
+	void toggleLevelOfDetail();
+	void toggleFixedTimestep();
+	void toggleChainOrdering();
+	void toggleFastMath();
+	void toggleCheckpoints();
+	void toggleRecording();
+	void toggleTelemetry();
+	void toggleAllocationTracking();
+
 	void pollEvents();
 	void update();
 	void render();
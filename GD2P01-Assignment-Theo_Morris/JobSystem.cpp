@@ -0,0 +1,259 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : JobSystem.cpp
+Description : Implementation of the JobSystem class, a work stealing thread pool that runs ranges of work and splits heavy ranges across idle workers.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "JobSystem.h"
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    // index of the worker running on this thread, threads outside the pool use worker 0
+    thread_local int t_workerIndex = -1;
+
+    // how many jobs this thread is inside of, a job that runs a parallel for of its own helps run the inner jobs
+    thread_local int t_executeDepth = 0;
+
+    // how many times an idle worker looks for work before going to sleep
+    const int IDLE_SPIN_COUNT = 256;
+
+    long long nowNanoseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+JobSystem::JobSystem(unsigned int workerCount)
+{
+    workerCount = std::max(1u, workerCount);
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+
+    for (unsigned int i = 1; i < workerCount; ++i) {
+        m_workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+    }
+
+    m_statsStartNanoseconds = nowNanoseconds();
+}
+
+JobSystem::~JobSystem()
+{
+    m_running = false;
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wakeCondition.notify_all();
+
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+void JobSystem::workerLoop(unsigned int workerIndex)
+{
+    t_workerIndex = static_cast<int>(workerIndex);
+
+    int idleSpins = 0;
+    while (m_running) {
+        Job job;
+        if (findJob(workerIndex, job)) {
+            execute(workerIndex, job);
+            idleSpins = 0;
+            continue;
+        }
+
+        if (++idleSpins < IDLE_SPIN_COUNT) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Nothing to do, sleep until more work is pushed
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_sleepingWorkers++;
+        m_wakeCondition.wait_for(lock, std::chrono::milliseconds(1), [this]() { return !m_running || m_queuedJobs > 0; });
+        m_sleepingWorkers--;
+        idleSpins = 0;
+    }
+}
+
+unsigned int JobSystem::currentWorker() const
+{
+    return t_workerIndex >= 0 ? static_cast<unsigned int>(t_workerIndex) : 0;
+}
+
+bool JobSystem::push(unsigned int workerIndex, const Job& job)
+{
+    Worker& worker = *m_workers[workerIndex];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tail - worker.head >= JOB_DEQUE_CAPACITY) {
+            return false;
+        }
+        worker.jobs[worker.tail % JOB_DEQUE_CAPACITY] = job;
+        worker.tail++;
+    }
+    m_queuedJobs++;
+
+    // Only pay for the wake up when someone is actually asleep
+    if (m_sleepingWorkers > 0) {
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+        }
+        m_wakeCondition.notify_one();
+    }
+    return true;
+}
+
+bool JobSystem::pop(unsigned int workerIndex, Job& job)
+{
+    Worker& worker = *m_workers[workerIndex];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tail == worker.head) {
+        return false;
+    }
+
+    // The owner takes the most recently split range, which is still warm in its cache
+    worker.tail--;
+    job = worker.jobs[worker.tail % JOB_DEQUE_CAPACITY];
+    m_queuedJobs--;
+    return true;
+}
+
+bool JobSystem::steal(unsigned int workerIndex, Job& job)
+{
+    unsigned int workerCount = getWorkerCount();
+    for (unsigned int offset = 1; offset < workerCount; ++offset) {
+        Worker& victim = *m_workers[(workerIndex + offset) % workerCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tail == victim.head) {
+            continue;
+        }
+
+        // Thieves take the oldest range, which is the biggest one left
+        job = victim.jobs[victim.head % JOB_DEQUE_CAPACITY];
+        victim.head++;
+        m_queuedJobs--;
+        m_workers[workerIndex]->steals.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::findJob(unsigned int workerIndex, Job& job)
+{
+    if (m_queuedJobs <= 0) {
+        return false;
+    }
+    return pop(workerIndex, job) || steal(workerIndex, job);
+}
+
+unsigned int JobSystem::splitPoint(const Job& job) const
+{
+    unsigned int middle = job.begin + (job.end - job.begin) / 2;
+    if (job.splitPoints == nullptr || job.splitPointCount == 0) {
+        return middle;
+    }
+
+    // Use the preferred split point closest to the middle as long as it stays within the middle half of the range
+    const unsigned int* first = job.splitPoints;
+    const unsigned int* last = job.splitPoints + job.splitPointCount;
+    const unsigned int* candidate = std::lower_bound(first, last, middle);
+
+    unsigned int best = middle;
+    unsigned int bestDistance = (job.end - job.begin) / 4 + 1;
+    if (candidate != last && *candidate - middle < bestDistance) {
+        best = *candidate;
+        bestDistance = *candidate - middle;
+    }
+    if (candidate != first && middle - *(candidate - 1) < bestDistance) {
+        best = *(candidate - 1);
+    }
+
+    return std::clamp(best, job.begin + 1, job.end - 1);
+}
+
+void JobSystem::execute(unsigned int workerIndex, Job job)
+{
+    // Only the outermost job counts towards busy time so nested jobs are not counted twice
+    bool outermost = t_executeDepth++ == 0;
+    long long start = nowNanoseconds();
+    AllocationScope allocationScope(job.allocationScope);
+
+    // Keep halving the range, leaving the far half where an idle worker can steal it
+    while (job.end - job.begin > job.grainSize && job.end - job.begin > 1) {
+        unsigned int middle = splitPoint(job);
+        Job farHalf = job;
+        farHalf.begin = middle;
+
+        job.remaining->fetch_add(1, std::memory_order_relaxed);
+        if (!push(workerIndex, farHalf)) {
+            // The deque is full so just run the whole range here
+            job.remaining->fetch_sub(1, std::memory_order_relaxed);
+            break;
+        }
+        job.end = middle;
+    }
+
+    job.function(job.data, job.begin, job.end);
+    job.remaining->fetch_sub(1, std::memory_order_release);
+
+    t_executeDepth--;
+
+    Worker& worker = *m_workers[workerIndex];
+    if (outermost) {
+        worker.busyNanoseconds.fetch_add(nowNanoseconds() - start, std::memory_order_relaxed);
+    }
+    worker.jobsExecuted.fetch_add(1, std::memory_order_relaxed);
+}
+
+void JobSystem::run(unsigned int begin, unsigned int end, unsigned int grainSize, const unsigned int* splitPoints, unsigned int splitPointCount, void (*function)(void*, unsigned int, unsigned int), void* data)
+{
+    if (begin >= end) {
+        return;
+    }
+
+    std::atomic<unsigned int> remaining = 1;
+    Job root = { function, data, begin, end, std::max(1u, grainSize), splitPoints, splitPointCount, &remaining, getAllocationScope() };
+
+    unsigned int workerIndex = currentWorker();
+    execute(workerIndex, root);
+
+    // Help out with the rest of the work instead of just waiting for it
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        Job job;
+        if (findJob(workerIndex, job)) {
+            execute(workerIndex, job);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::sampleStats(std::vector<WorkerStats>& stats)
+{
+    long long now = nowNanoseconds();
+    double elapsed = static_cast<double>(std::max(1LL, now - m_statsStartNanoseconds));
+    m_statsStartNanoseconds = now;
+
+    stats.resize(m_workers.size());
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        Worker& worker = *m_workers[i];
+        stats[i].utilisation = static_cast<float>(worker.busyNanoseconds.exchange(0, std::memory_order_relaxed) / elapsed);
+        stats[i].jobs = worker.jobsExecuted.exchange(0, std::memory_order_relaxed);
+        stats[i].steals = worker.steals.exchange(0, std::memory_order_relaxed);
+    }
+}
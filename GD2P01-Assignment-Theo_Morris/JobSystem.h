@@ -0,0 +1,120 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : JobSystem.h
+Description : Declaration of the JobSystem class, a work stealing thread pool that runs ranges of work and splits heavy ranges across idle workers.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+const unsigned int JOB_DEQUE_CAPACITY = 4096;
+
+// A range of work, split in half while it is bigger than the grain size so idle workers can steal the other half
+struct Job {
+    void (*function)(void* data, unsigned int begin, unsigned int end);
+    void* data;
+    unsigned int begin;
+    unsigned int end;
+    unsigned int grainSize;
+
+    // sorted positions the range prefers to be split at, such as where each grid cell starts
+    const unsigned int* splitPoints;
+    unsigned int splitPointCount;
+
+    // how many pieces of the parallel for are still running
+    std::atomic<unsigned int>* remaining;
+
+    // the allocation scope of the thread that started the parallel for, whichever thread runs the job counts against it
+    int allocationScope;
+};
+
+struct WorkerStats {
+    float utilisation = 0.0f;
+    unsigned long long jobs = 0;
+    unsigned long long steals = 0;
+};
+
+class JobSystem
+{
+private:
+    struct alignas(64) Worker {
+        // guards the deque, the owning worker pushes and pops at the back and thieves take from the front
+        std::mutex mutex;
+        std::array<Job, JOB_DEQUE_CAPACITY> jobs;
+        unsigned int head = 0;
+        unsigned int tail = 0;
+
+        std::atomic<unsigned long long> busyNanoseconds{ 0 };
+        std::atomic<unsigned long long> jobsExecuted{ 0 };
+        std::atomic<unsigned long long> steals{ 0 };
+
+        std::thread thread;
+    };
+
+    // worker 0 has no thread of its own, it is whichever thread calls parallelFor
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    std::atomic<bool> m_running = true;
+    std::atomic<int> m_queuedJobs = 0;
+    std::atomic<int> m_sleepingWorkers = 0;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCondition;
+
+    long long m_statsStartNanoseconds;
+
+    void workerLoop(unsigned int workerIndex);
+    unsigned int currentWorker() const;
+
+    bool push(unsigned int workerIndex, const Job& job);
+    bool pop(unsigned int workerIndex, Job& job);
+    bool steal(unsigned int workerIndex, Job& job);
+    bool findJob(unsigned int workerIndex, Job& job);
+
+    unsigned int splitPoint(const Job& job) const;
+    void execute(unsigned int workerIndex, Job job);
+    void run(unsigned int begin, unsigned int end, unsigned int grainSize, const unsigned int* splitPoints, unsigned int splitPointCount, void (*function)(void*, unsigned int, unsigned int), void* data);
+
+    template <typename Function>
+    static void invokeRange(void* data, unsigned int begin, unsigned int end)
+    {
+        (*static_cast<Function*>(data))(begin, end);
+    }
+
+public:
+    // workerCount includes the calling thread, so a count of 1 runs everything inline
+    JobSystem(unsigned int workerCount);
+    ~JobSystem();
+
+    unsigned int getWorkerCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+    /***
+     * Calls the function over sub ranges of [begin, end) spread across the workers and waits for all of them to finish.
+     * @param begin The first item.
+     * @param end One past the last item.
+     * @param grainSize Ranges with more items than this get split.
+     * @param splitPoints Optional sorted item positions to prefer splitting at, nullptr to always split down the middle.
+     * @param splitPointCount The number of split points.
+     * @param function Called as function(rangeBegin, rangeEnd), possibly from several threads at once.
+     ***/
+    template <typename Function>
+    void parallelFor(unsigned int begin, unsigned int end, unsigned int grainSize, const unsigned int* splitPoints, unsigned int splitPointCount, Function& function)
+    {
+        run(begin, end, grainSize, splitPoints, splitPointCount, &invokeRange<Function>, &function);
+    }
+
+    // Fills in how busy each worker has been since the last call
+    void sampleStats(std::vector<WorkerStats>& stats);
+};
@@ -0,0 +1,41 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : LittleEndian.h
+Description : Helpers to store and load the fields of the binary file formats lowest byte first, so the files read the same on any machine.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+
+// Four and eight byte integers and floats, floats are stored as their bits
+template <typename T>
+inline void storeLittleEndian(std::uint8_t* bytes, T value)
+{
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8, "fields are four or eight bytes");
+    using Bits = std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+    Bits bits = std::bit_cast<Bits>(value);
+    for (unsigned int i = 0; i < sizeof(T); ++i) {
+        bytes[i] = static_cast<std::uint8_t>(bits >> (8 * i));
+    }
+}
+
+template <typename T>
+inline T loadLittleEndian(const std::uint8_t* bytes)
+{
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8, "fields are four or eight bytes");
+    using Bits = std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+    Bits bits = 0;
+    for (unsigned int i = 0; i < sizeof(T); ++i) {
+        bits |= static_cast<Bits>(bytes[i]) << (8 * i);
+    }
+    return std::bit_cast<T>(bits);
+}
@@ -0,0 +1,136 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : MappedFile.cpp
+Description : Implementation of the MappedFile class, a read only view of a whole file mapped into memory.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path, std::string& error)
+{
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = "Failed to open '" + path + "'";
+        return false;
+    }
+    m_file = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        error = "'" + path + "' is empty";
+        close();
+        return false;
+    }
+
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr) {
+        error = "Failed to map '" + path + "'";
+        close();
+        return false;
+    }
+
+    m_data = static_cast<const unsigned char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr) {
+        error = "Failed to map '" + path + "'";
+        close();
+        return false;
+    }
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+        m_data = nullptr;
+    }
+    if (m_mapping != nullptr) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    if (m_file != nullptr) {
+        CloseHandle(m_file);
+        m_file = nullptr;
+    }
+    m_size = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path, std::string& error)
+{
+    close();
+
+    m_file = ::open(path.c_str(), O_RDONLY);
+    if (m_file < 0) {
+        error = "Failed to open '" + path + "'";
+        return false;
+    }
+
+    struct stat fileStatus;
+    if (fstat(m_file, &fileStatus) != 0 || fileStatus.st_size == 0) {
+        error = "'" + path + "' is empty";
+        close();
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, m_file, 0);
+    if (data == MAP_FAILED) {
+        error = "Failed to map '" + path + "'";
+        close();
+        return false;
+    }
+
+    // The whole file is read front to back straight away
+    madvise(data, static_cast<size_t>(fileStatus.st_size), MADV_WILLNEED);
+
+    m_data = static_cast<const unsigned char*>(data);
+    m_size = static_cast<size_t>(fileStatus.st_size);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data != nullptr) {
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+        m_data = nullptr;
+    }
+    if (m_file >= 0) {
+        ::close(m_file);
+        m_file = -1;
+    }
+    m_size = 0;
+}
+
+#endif
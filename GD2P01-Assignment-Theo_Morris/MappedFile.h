@@ -0,0 +1,53 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : MappedFile.h
+Description : Declaration of the MappedFile class, a read only view of a whole file mapped into memory.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Maps a file read only so its contents can be used in place without reading them into a buffer first
+class MappedFile
+{
+private:
+    const unsigned char* m_data = nullptr;
+    size_t m_size = 0;
+
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /***
+     * Function to map a file, any file already mapped is closed first.
+     * @param path The file to map.
+     * @param error Set to what went wrong when mapping fails.
+     * @return True if the file was mapped.
+     ***/
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+
+    // the mapping starts on a page boundary, so records of any alignment up to a page can be read from it in place
+    const unsigned char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+};
@@ -93,17 +93,20 @@ inline float vectorDotProduct(sf::Vector2f vectorA, sf::Vector2f vectorB)
  * @param position The starting position of the ray.
  * @param direction The direction in which the ray is cast.
  * @param length The length of the ray.
- * @param points A vector containing points to check for intersections with the ray.
+ * @param pointsX The x coordinates of the points to check.
+ * @param pointsY The y coordinates of the points to check.
+ * @param pointCount How many points there are.
  * @param hitPoint If an intersection is found, this will contain the coordinates of the hit point.
  * @return True if the ray intersects with any of the points, false otherwise.
  ***/
-inline bool castRay(const sf::Vector2f& position, const sf::Vector2f& direction, float length, const std::vector<sf::Vector2f>& points, sf::Vector2f& hitPoint) {
+inline bool castRay(const sf::Vector2f& position, const sf::Vector2f& direction, float length, const float* pointsX, const float* pointsY, unsigned int pointCount, sf::Vector2f& hitPoint) {
     bool hasHit = false;
     float closestDistance = std::numeric_limits<float>::max();
 
     sf::Vector2f normalizedDirection = normalize(direction);
 
-    for (const auto& point : points) {
+    for (unsigned int i = 0; i < pointCount; ++i) {
+        sf::Vector2f point(pointsX[i], pointsY[i]);
         sf::Vector2f toPoint = point - position;
         float projectionLength = vectorDotProduct(toPoint, normalizedDirection);
 
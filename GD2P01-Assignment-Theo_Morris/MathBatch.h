@@ -0,0 +1,149 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : MathBatch.h
+Description : Array versions of the vector helpers in Math.h, working on separate x and y arrays four floats at a time with SSE2.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include "Math.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_BATCH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Every function gives exactly the same result as calling its Math.h version on each element,
+// sqrt and division are exact in SSE2 so the SIMD path only changes how many are done at once
+
+/***
+ * Function to calculate the distance from one point to each point in an array.
+ * @param originX The x coordinate of the point measured from.
+ * @param originY The y coordinate of the point measured from.
+ * @param x The x coordinates of the points.
+ * @param y The y coordinates of the points.
+ * @param count How many points there are.
+ * @param distances Filled with the distance to each point.
+ ***/
+inline void batchDistance(float originX, float originY, const float* x, const float* y, unsigned int count, float* distances)
+{
+    unsigned int i = 0;
+#ifdef MATH_BATCH_SSE2
+    __m128 ox = _mm_set1_ps(originX);
+    __m128 oy = _mm_set1_ps(originY);
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), ox);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), oy);
+        __m128 squared = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        _mm_storeu_ps(distances + i, _mm_sqrt_ps(squared));
+    }
+#endif
+    for (; i < count; ++i) {
+        distances[i] = vectorDistance(sf::Vector2f(originX, originY), sf::Vector2f(x[i], y[i]));
+    }
+}
+
+/***
+ * Function to normalize every vector in an array, vectors with no length are left at zero.
+ * @param x The x components, overwritten with the normalized x components.
+ * @param y The y components, overwritten with the normalized y components.
+ * @param count How many vectors there are.
+ ***/
+inline void batchNormalize(float* x, float* y, unsigned int count)
+{
+    unsigned int i = 0;
+#ifdef MATH_BATCH_SSE2
+    __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 magnitude = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)));
+        __m128 nonZero = _mm_cmpneq_ps(magnitude, zero);
+        _mm_storeu_ps(x + i, _mm_and_ps(nonZero, _mm_div_ps(vx, magnitude)));
+        _mm_storeu_ps(y + i, _mm_and_ps(nonZero, _mm_div_ps(vy, magnitude)));
+    }
+#endif
+    for (; i < count; ++i) {
+        sf::Vector2f normalized = normalize(sf::Vector2f(x[i], y[i]));
+        x[i] = normalized.x;
+        y[i] = normalized.y;
+    }
+}
+
+/***
+ * Function to shorten every vector in an array that is longer than a maximum magnitude, keeping its direction.
+ * @param x The x components, overwritten with the clamped x components.
+ * @param y The y components, overwritten with the clamped y components.
+ * @param count How many vectors there are.
+ * @param maxMagnitude The longest a vector is allowed to be.
+ ***/
+inline void batchClampMagnitude(float* x, float* y, unsigned int count, float maxMagnitude)
+{
+    unsigned int i = 0;
+#ifdef MATH_BATCH_SSE2
+    __m128 limit = _mm_set1_ps(maxMagnitude);
+    for (; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 magnitude = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)));
+        __m128 tooLong = _mm_cmpgt_ps(magnitude, limit);
+        __m128 clampedX = _mm_mul_ps(_mm_div_ps(vx, magnitude), limit);
+        __m128 clampedY = _mm_mul_ps(_mm_div_ps(vy, magnitude), limit);
+        _mm_storeu_ps(x + i, _mm_or_ps(_mm_and_ps(tooLong, clampedX), _mm_andnot_ps(tooLong, vx)));
+        _mm_storeu_ps(y + i, _mm_or_ps(_mm_and_ps(tooLong, clampedY), _mm_andnot_ps(tooLong, vy)));
+    }
+#endif
+    for (; i < count; ++i) {
+        sf::Vector2f vector(x[i], y[i]);
+        if (vectorMagnitude(vector) > maxMagnitude) {
+            vector = normalize(vector) * maxMagnitude;
+        }
+        x[i] = vector.x;
+        y[i] = vector.y;
+    }
+}
+
+/***
+ * Function to wrap every position in an array within the window boundaries, the same way as wrapPosition.
+ * @param x The x coordinates, overwritten with the wrapped x coordinates.
+ * @param y The y coordinates, overwritten with the wrapped y coordinates.
+ * @param count How many positions there are.
+ * @param windowSize The size of the window (in pixels) represented by a vector.
+ ***/
+inline void batchWrapPositions(float* x, float* y, unsigned int count, const sf::Vector2u& windowSize)
+{
+    unsigned int i = 0;
+#ifdef MATH_BATCH_SSE2
+    __m128 zero = _mm_setzero_ps();
+    __m128 width = _mm_set1_ps(static_cast<float>(windowSize.x));
+    __m128 height = _mm_set1_ps(static_cast<float>(windowSize.y));
+    for (; i + 4 <= count; i += 4) {
+        // past the low edge moves to the high edge, past the high edge moves to zero
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 belowX = _mm_cmplt_ps(px, zero);
+        __m128 aboveX = _mm_cmpgt_ps(px, width);
+        px = _mm_or_ps(_mm_and_ps(belowX, width), _mm_andnot_ps(_mm_or_ps(belowX, aboveX), px));
+        _mm_storeu_ps(x + i, px);
+
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 belowY = _mm_cmplt_ps(py, zero);
+        __m128 aboveY = _mm_cmpgt_ps(py, height);
+        py = _mm_or_ps(_mm_and_ps(belowY, height), _mm_andnot_ps(_mm_or_ps(belowY, aboveY), py));
+        _mm_storeu_ps(y + i, py);
+    }
+#endif
+    for (; i < count; ++i) {
+        sf::Vector2f position(x[i], y[i]);
+        wrapPosition(position, windowSize);
+        x[i] = position.x;
+        y[i] = position.y;
+    }
+}
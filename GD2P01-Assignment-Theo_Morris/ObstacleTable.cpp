@@ -0,0 +1,35 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : ObstacleTable.cpp
+Description : Implementation of the ObstacleTable class, the obstacles of the world stored as packed circles for the steering queries.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "ObstacleTable.h"
+
+ObstacleTable::ObstacleTable()
+{
+}
+
+ObstacleTable::~ObstacleTable()
+{
+}
+
+void ObstacleTable::add(const sf::Vector2f& center, float radius)
+{
+    m_centerX.push_back(center.x);
+    m_centerY.push_back(center.y);
+    m_radius.push_back(radius);
+}
+
+void ObstacleTable::clear()
+{
+    m_centerX.clear();
+    m_centerY.clear();
+    m_radius.clear();
+}
@@ -0,0 +1,42 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : ObstacleTable.h
+Description : Declaration of the ObstacleTable class, the obstacles of the world stored as packed circles for the steering queries.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <vector>
+
+#include <SFML/System/Vector2.hpp>
+
+// Every obstacle is a circle, each part of it kept in its own array so a query over all of them reads contiguous memory
+class ObstacleTable
+{
+private:
+    std::vector<float> m_centerX;
+    std::vector<float> m_centerY;
+    std::vector<float> m_radius;
+
+public:
+    ObstacleTable();
+    ~ObstacleTable();
+
+    void add(const sf::Vector2f& center, float radius);
+    void clear();
+
+    unsigned int size() const { return static_cast<unsigned int>(m_centerX.size()); }
+
+    const float* getCenterX() const { return m_centerX.data(); }
+    const float* getCenterY() const { return m_centerY.data(); }
+    const float* getRadius() const { return m_radius.data(); }
+
+    sf::Vector2f getCenter(unsigned int index) const { return sf::Vector2f(m_centerX[index], m_centerY[index]); }
+    float getRadius(unsigned int index) const { return m_radius[index]; }
+};
@@ -0,0 +1,87 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : Random.h
+Description : Counter based random numbers, every draw is a pure function of a key and a counter so results don't depend on update order or thread count.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+const unsigned int DEFAULT_SIMULATION_SEED = 20240601;
+
+// independent streams of numbers for each agent, so adding a new use of randomness never shifts an existing one
+enum class RandomStream : std::uint32_t {
+    Spawn,
+    Wander,
+    Placement
+};
+
+/***
+ * Philox4x32-10 counter based generator, scrambles a 128 bit counter with a 64 bit key in ten rounds.
+ * @param counter The counter to scramble.
+ * @param key The key, one per independent sequence.
+ * @return Four random 32 bit words.
+ ***/
+inline std::array<std::uint32_t, 4> philox4x32(std::array<std::uint32_t, 4> counter, std::array<std::uint32_t, 2> key)
+{
+    const std::uint32_t MULTIPLIER_0 = 0xD2511F53;
+    const std::uint32_t MULTIPLIER_1 = 0xCD9E8D57;
+    const std::uint32_t WEYL_0 = 0x9E3779B9;
+    const std::uint32_t WEYL_1 = 0xBB67AE85;
+
+    for (int round = 0; round < 10; ++round) {
+        if (round > 0) {
+            key[0] += WEYL_0;
+            key[1] += WEYL_1;
+        }
+
+        std::uint64_t product0 = static_cast<std::uint64_t>(MULTIPLIER_0) * counter[0];
+        std::uint64_t product1 = static_cast<std::uint64_t>(MULTIPLIER_1) * counter[2];
+        counter = {
+            static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+            static_cast<std::uint32_t>(product1),
+            static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+            static_cast<std::uint32_t>(product0)
+        };
+    }
+
+    return counter;
+}
+
+/***
+ * Function to get a random float for an agent, the same arguments always give the same number.
+ * @param seed The simulation seed.
+ * @param agentId The id of the agent drawing the number.
+ * @param tick The simulation tick the number is drawn on.
+ * @param stream What the number is used for.
+ * @param draw Which draw from the stream this is when more than one number is needed on the same tick.
+ * @return A random float in the range [0, 1).
+ ***/
+inline float agentRandom(unsigned int seed, unsigned int agentId, unsigned int tick, RandomStream stream, unsigned int draw = 0)
+{
+    std::array<std::uint32_t, 4> bits = philox4x32({ tick, static_cast<std::uint32_t>(stream), draw, 0 }, { agentId, seed });
+
+    // the top 24 bits fill a float's mantissa exactly
+    return (bits[0] >> 8) * (1.0f / 16777216.0f);
+}
+
+/***
+ * Function to mix the bits of a 64 bit value, used for hashing the simulation state.
+ * @param value The value to mix.
+ * @return The mixed value.
+ ***/
+inline std::uint64_t mixBits(std::uint64_t value)
+{
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
@@ -0,0 +1,187 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : Rans.cpp
+Description : Implementation of a byte wise rANS entropy coder, each block is coded with its own frequency table stored in front of it.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "Rans.h"
+#include "VarInt.h"
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+    const int SYMBOL_COUNT = 256;
+
+    // Scales the counts so they add up to RANS_SCALE, every symbol that appears keeps a frequency of at least one
+    void normalizeFrequencies(const std::array<std::uint32_t, SYMBOL_COUNT>& counts, size_t total, std::array<std::uint32_t, SYMBOL_COUNT>& frequencies)
+    {
+        std::uint32_t sum = 0;
+        int largest = 0;
+        for (int symbol = 0; symbol < SYMBOL_COUNT; ++symbol) {
+            frequencies[symbol] = 0;
+            if (counts[symbol] > 0) {
+                std::uint64_t scaled = static_cast<std::uint64_t>(counts[symbol]) * RANS_SCALE / total;
+                frequencies[symbol] = scaled > 0 ? static_cast<std::uint32_t>(scaled) : 1;
+                sum += frequencies[symbol];
+                if (frequencies[symbol] > frequencies[largest]) {
+                    largest = symbol;
+                }
+            }
+        }
+
+        // Rounding down leaves some of the range spare, it goes to the most common symbol where it costs the least
+        if (sum <= RANS_SCALE) {
+            frequencies[largest] += RANS_SCALE - sum;
+            return;
+        }
+
+        // Rounding rare symbols up to one can overshoot instead, take it back from whichever symbol has the most
+        while (sum > RANS_SCALE) {
+            int mostFrequent = 0;
+            for (int symbol = 1; symbol < SYMBOL_COUNT; ++symbol) {
+                if (frequencies[symbol] > frequencies[mostFrequent]) {
+                    mostFrequent = symbol;
+                }
+            }
+            frequencies[mostFrequent]--;
+            sum--;
+        }
+    }
+
+    // Byte i is decoded by state i % StateCount, each state's chain of work doesn't depend on the others so they overlap in the CPU
+    template <unsigned int StateCount>
+    bool decodeSymbols(const std::uint8_t* data, size_t size, size_t position, const std::array<std::uint32_t, SYMBOL_COUNT>& frequencies,
+        const std::array<std::uint32_t, SYMBOL_COUNT>& starts, const std::array<std::uint8_t, RANS_SCALE>& slotSymbols, std::uint8_t* output, size_t outputSize)
+    {
+        if (size - position < StateCount * sizeof(std::uint32_t)) {
+            return false;
+        }
+
+        // The final encoder states were written lowest byte first
+        std::uint32_t states[StateCount] = {};
+        for (std::uint32_t& state : states) {
+            for (int i = 0; i < 4; ++i) {
+                state |= static_cast<std::uint32_t>(data[position++]) << (i * 8);
+            }
+        }
+
+        for (size_t i = 0; i < outputSize; ++i) {
+            std::uint32_t& state = states[i % StateCount];
+            std::uint32_t slot = state & (RANS_SCALE - 1);
+            std::uint8_t symbol = slotSymbols[slot];
+            output[i] = symbol;
+            state = frequencies[symbol] * (state >> RANS_SCALE_BITS) + slot - starts[symbol];
+            while (state < RANS_LOWER_BOUND) {
+                if (position >= size) {
+                    return false;
+                }
+                state = (state << 8) | data[position++];
+            }
+        }
+        return true;
+    }
+}
+
+bool ransEncode(const std::uint8_t* data, size_t size, std::vector<std::uint8_t>& output)
+{
+    output.clear();
+    if (size == 0) {
+        return false;
+    }
+
+    std::array<std::uint32_t, SYMBOL_COUNT> counts = {};
+    for (size_t i = 0; i < size; ++i) {
+        counts[data[i]]++;
+    }
+
+    std::array<std::uint32_t, SYMBOL_COUNT> frequencies;
+    normalizeFrequencies(counts, size, frequencies);
+
+    std::array<std::uint32_t, SYMBOL_COUNT> starts;
+    std::uint32_t start = 0;
+    for (int symbol = 0; symbol < SYMBOL_COUNT; ++symbol) {
+        starts[symbol] = start;
+        start += frequencies[symbol];
+        appendVarInt(output, frequencies[symbol]);
+    }
+    size_t tableSize = output.size();
+
+    // rANS works backwards, the bytes are coded last to first into the end of the buffer so the decoder reads them forwards.
+    // Byte i goes to state i % RANS_INTERLEAVED_STATES, so the decoder can work on the states side by side.
+    // A symbol never costs more than RANS_SCALE_BITS bits, so twice the input size plus the final states always fits
+    size_t capacity = size * 2 + RANS_INTERLEAVED_STATES * sizeof(std::uint32_t);
+    output.resize(tableSize + capacity);
+    std::uint8_t* end = output.data() + output.size();
+    std::uint8_t* cursor = end;
+
+    std::array<std::uint32_t, RANS_INTERLEAVED_STATES> states;
+    states.fill(RANS_LOWER_BOUND);
+    for (size_t i = size; i-- > 0;) {
+        std::uint32_t& state = states[i % RANS_INTERLEAVED_STATES];
+        std::uint32_t frequency = frequencies[data[i]];
+        std::uint32_t stateLimit = ((RANS_LOWER_BOUND >> RANS_SCALE_BITS) << 8) * frequency;
+        while (state >= stateLimit) {
+            *--cursor = static_cast<std::uint8_t>(state & 0xFF);
+            state >>= 8;
+        }
+        state = ((state / frequency) << RANS_SCALE_BITS) + (state % frequency) + starts[data[i]];
+    }
+
+    // The last state goes in first so the decoder reads the first one first
+    for (unsigned int stream = RANS_INTERLEAVED_STATES; stream-- > 0;) {
+        for (int i = 0; i < 4; ++i) {
+            *--cursor = static_cast<std::uint8_t>(states[stream] >> (24 - i * 8));
+        }
+    }
+
+    // Move the coded bytes down to sit straight after the table
+    size_t codedSize = static_cast<size_t>(end - cursor);
+    if (tableSize + codedSize >= size) {
+        output.clear();
+        return false;
+    }
+    std::copy(cursor, end, output.begin() + tableSize);
+    output.resize(tableSize + codedSize);
+    return true;
+}
+
+bool ransDecode(const std::uint8_t* data, size_t size, std::uint8_t* output, size_t outputSize, unsigned int stateCount)
+{
+    std::array<std::uint32_t, SYMBOL_COUNT> frequencies;
+    std::array<std::uint32_t, SYMBOL_COUNT> starts;
+    std::uint32_t start = 0;
+    size_t position = 0;
+    for (int symbol = 0; symbol < SYMBOL_COUNT; ++symbol) {
+        if (!readVarInt(data, size, position, frequencies[symbol]) || frequencies[symbol] > RANS_SCALE) {
+            return false;
+        }
+        starts[symbol] = start;
+        start += frequencies[symbol];
+    }
+    if (start != RANS_SCALE) {
+        return false;
+    }
+
+    // Every slot of the scaled range maps back to the symbol that owns it
+    std::array<std::uint8_t, RANS_SCALE> slotSymbols;
+    for (int symbol = 0; symbol < SYMBOL_COUNT; ++symbol) {
+        std::fill(slotSymbols.begin() + starts[symbol], slotSymbols.begin() + starts[symbol] + frequencies[symbol], static_cast<std::uint8_t>(symbol));
+    }
+
+    switch (stateCount) {
+    case 1:
+        return decodeSymbols<1>(data, size, position, frequencies, starts, slotSymbols, output, outputSize);
+    case RANS_INTERLEAVED_STATES:
+        return decodeSymbols<RANS_INTERLEAVED_STATES>(data, size, position, frequencies, starts, slotSymbols, output, outputSize);
+    default:
+        return false;
+    }
+}
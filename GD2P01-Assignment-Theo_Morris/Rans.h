@@ -0,0 +1,47 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : Rans.h
+Description : Declaration of a byte wise rANS entropy coder, each block is coded with its own frequency table stored in front of it.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// symbol frequencies are scaled to add up to 1 << RANS_SCALE_BITS
+const unsigned int RANS_SCALE_BITS = 14;
+const std::uint32_t RANS_SCALE = 1u << RANS_SCALE_BITS;
+
+// the coder state is kept between RANS_LOWER_BOUND and 256 times it, a byte is moved in or out whenever it leaves that range
+const std::uint32_t RANS_LOWER_BOUND = 1u << 23;
+
+// blocks are coded with this many states taking turns over the bytes, the decoder can also read blocks coded with one
+const unsigned int RANS_INTERLEAVED_STATES = 2;
+
+/***
+ * Function to entropy code a block of bytes, the frequency table goes first followed by the coded bytes.
+ * @param data The bytes to code.
+ * @param size How many bytes there are.
+ * @param output Replaced with the coded block, its capacity is kept between calls.
+ * @return False if coding wouldn't make the block smaller, the bytes should be stored as they are.
+ ***/
+bool ransEncode(const std::uint8_t* data, size_t size, std::vector<std::uint8_t>& output);
+
+/***
+ * Function to decode a block written by ransEncode.
+ * @param data The coded block.
+ * @param size The size of the coded block.
+ * @param output Where the decoded bytes are written.
+ * @param outputSize How many bytes the block decodes to.
+ * @param stateCount How many states the block was coded with, 1 for blocks from before the states were interleaved.
+ * @return False if the block is damaged.
+ ***/
+bool ransDecode(const std::uint8_t* data, size_t size, std::uint8_t* output, size_t outputSize, unsigned int stateCount = RANS_INTERLEAVED_STATES);
@@ -0,0 +1,312 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : ReferenceAgent.cpp
+Description : Implementation of the ReferenceAgent and ReferenceSimulation classes, the plain scalar steering model the optimised simulation is checked against.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "ReferenceAgent.h"
+#include "Math.h"
+#include "Random.h"
+
+#include <cmath>
+
+namespace
+{
+    // The forces are summed in this order, the same order the simulation has always added them in
+    const SteeringBehavior SUMMATION_ORDER[] = {
+        SteeringBehavior::Cohesion,
+        SteeringBehavior::Alignment,
+        SteeringBehavior::Separation,
+        SteeringBehavior::Seek,
+        SteeringBehavior::Flee,
+        SteeringBehavior::Pursuit,
+        SteeringBehavior::Evade,
+        SteeringBehavior::Wander,
+        SteeringBehavior::Arrival,
+        SteeringBehavior::Avoidance,
+        SteeringBehavior::Queueing,
+        SteeringBehavior::FollowingLeader
+    };
+
+    void setWeight(std::array<float, STEERING_BEHAVIOR_COUNT>& weights, SteeringBehavior behavior, float weight)
+    {
+        weights[static_cast<int>(behavior)] = weight;
+    }
+}
+
+ReferenceAgent::ReferenceAgent(const AgentState& state, unsigned int seed) : m_id(state.id), m_behavior(static_cast<MovementBehavior>(state.behavior)), m_followIndex(state.followIndex), m_seed(seed)
+{
+    m_pos = sf::Vector2f(state.positionX, state.positionY);
+    m_velocity = sf::Vector2f(state.velocityX, state.velocityY);
+    m_targetPreviousPos = sf::Vector2i(state.targetPreviousX, state.targetPreviousY);
+    m_wanderAngle = state.wanderAngle;
+    m_randomTick = state.randomTick;
+    m_wanderDraws = state.wanderDraws;
+
+    // Every behaviour keeps clear of obstacles and the agents around it on top of its own force
+    setWeight(m_weights, SteeringBehavior::Avoidance, 2.0f);
+    setWeight(m_weights, SteeringBehavior::Separation, 1.0f);
+    switch (m_behavior) {
+    case MovementBehavior::Seek:
+        setWeight(m_weights, SteeringBehavior::Seek, 1.0f);
+        break;
+    case MovementBehavior::Flee:
+        setWeight(m_weights, SteeringBehavior::Flee, 1.0f);
+        break;
+    case MovementBehavior::Pursue:
+        setWeight(m_weights, SteeringBehavior::Pursuit, 1.0f);
+        break;
+    case MovementBehavior::Evade:
+        setWeight(m_weights, SteeringBehavior::Evade, 1.0f);
+        break;
+    case MovementBehavior::Wander:
+        setWeight(m_weights, SteeringBehavior::Wander, 1.0f);
+        break;
+    case MovementBehavior::Arrival:
+        setWeight(m_weights, SteeringBehavior::Arrival, 1.0f);
+        break;
+    case MovementBehavior::Flocking:
+        setWeight(m_weights, SteeringBehavior::Cohesion, 1.0f);
+        setWeight(m_weights, SteeringBehavior::Alignment, 1.0f);
+        setWeight(m_weights, SteeringBehavior::Separation, 1.5f);
+        break;
+    case MovementBehavior::FollowLeader:
+        setWeight(m_weights, SteeringBehavior::FollowingLeader, 1.0f);
+        break;
+    case MovementBehavior::Queue:
+        setWeight(m_weights, SteeringBehavior::Queueing, 1.5f);
+        break;
+    }
+}
+
+void ReferenceAgent::steer(const ReferenceWorld& world)
+{
+    m_randomTick = world.tick;
+    m_wanderDraws = 0;
+
+    // The target's velocity is tracked every tick whether or not the agent pursues or evades it
+    sf::Vector2f targetDisplacement = sf::Vector2f(world.target - m_targetPreviousPos);
+    m_targetPreviousPos = world.target;
+    sf::Vector2f targetVelocity = targetDisplacement / world.deltaTime;
+
+    sf::Vector2f totalForce(0.0f, 0.0f);
+    for (SteeringBehavior behavior : SUMMATION_ORDER) {
+        float weight = m_weights[static_cast<int>(behavior)];
+        if (weight > 0) {
+            totalForce += behaviorForce(behavior, world, targetVelocity) * weight;
+        }
+    }
+
+    if (vectorMagnitude(totalForce) > MAX_FORCE) {
+        totalForce = normalize(totalForce) * MAX_FORCE;
+    }
+    m_steeringForce = totalForce;
+}
+
+void ReferenceAgent::integrate(const sf::Vector2u& worldSize)
+{
+    m_velocity += m_steeringForce;
+    if (vectorMagnitude(m_velocity) > MAX_SPEED) {
+        m_velocity = normalize(m_velocity) * MAX_SPEED;
+    }
+
+    m_pos += m_velocity;
+    wrapPosition(m_pos, worldSize);
+}
+
+sf::Vector2f ReferenceAgent::behaviorForce(SteeringBehavior behavior, const ReferenceWorld& world, const sf::Vector2f& targetVelocity)
+{
+    float dt = world.deltaTime;
+    sf::Vector2f target(world.target);
+
+    switch (behavior) {
+    case SteeringBehavior::Avoidance:
+        return obstacleAvoidance(world.obstacles, dt);
+    case SteeringBehavior::Separation:
+    case SteeringBehavior::Cohesion:
+    case SteeringBehavior::Alignment:
+        return flockingForce(behavior, world);
+    case SteeringBehavior::Seek:
+        return seek(target, dt);
+    case SteeringBehavior::Flee:
+        return seek(target, dt) * -1.0f;
+    case SteeringBehavior::Pursuit:
+        return seek(target + targetVelocity * PREDICTION_TIME, dt);
+    case SteeringBehavior::Evade:
+        return seek(target + targetVelocity * PREDICTION_TIME, dt) * -1.0f;
+    case SteeringBehavior::Wander:
+        return wander(dt);
+    case SteeringBehavior::Arrival:
+        return arrival(target, dt);
+    case SteeringBehavior::Queueing:
+        return queueing(world, dt);
+    case SteeringBehavior::FollowingLeader:
+        return followingLeader(world, dt);
+    default:
+        return sf::Vector2f(0.0f, 0.0f);
+    }
+}
+
+sf::Vector2f ReferenceAgent::flockingForce(SteeringBehavior behavior, const ReferenceWorld& world) const
+{
+    // Each flocking force looks at every other agent in turn, in the order they were added
+    sf::Vector2f sum(0.0f, 0.0f);
+    int count = 0;
+    for (const ReferenceAgent& other : world.agents) {
+        if (other.m_id == m_id) {
+            continue;
+        }
+
+        float distance = vectorDistance(m_pos, other.m_pos);
+        if (behavior == SteeringBehavior::Separation && distance < SEPARATION_RADIUS) {
+            sf::Vector2f diff = m_pos - other.m_pos;
+            if (distance != 0) {
+                diff /= distance;
+            }
+            sum += diff;
+            count++;
+        }
+        else if (behavior == SteeringBehavior::Cohesion && distance < NEIGHBOR_RADIUS) {
+            sum += other.m_pos;
+            count++;
+        }
+        else if (behavior == SteeringBehavior::Alignment && distance < NEIGHBOR_RADIUS) {
+            sum += other.m_velocity;
+            count++;
+        }
+    }
+
+    if (count == 0) {
+        return sf::Vector2f(0.0f, 0.0f);
+    }
+
+    sf::Vector2f average = sum / static_cast<float>(count);
+    if (behavior == SteeringBehavior::Cohesion) {
+        average -= m_pos;
+    }
+    else if (behavior == SteeringBehavior::Alignment) {
+        average -= m_velocity;
+    }
+    return normalize(average) * world.deltaTime;
+}
+
+sf::Vector2f ReferenceAgent::seek(const sf::Vector2f& target, float dt) const
+{
+    sf::Vector2f desiredVelocity = target - m_pos;
+    if (vectorMagnitude(desiredVelocity) <= 0) {
+        return sf::Vector2f(0.0f, 0.0f);
+    }
+
+    desiredVelocity = normalize(desiredVelocity) * MAX_SPEED;
+    sf::Vector2f steering = normalize(desiredVelocity - m_velocity) * MAX_FORCE;
+    return steering * dt;
+}
+
+sf::Vector2f ReferenceAgent::arrival(const sf::Vector2f& target, float dt) const
+{
+    sf::Vector2f desiredVelocity = target - m_pos;
+    float distance = vectorMagnitude(desiredVelocity);
+    if (distance <= 0) {
+        return sf::Vector2f(0.0f, 0.0f);
+    }
+
+    // Slows down inside the arrival radius
+    desiredVelocity = normalize(desiredVelocity);
+    if (distance < ARRIVAL_RADIUS) {
+        desiredVelocity *= MAX_SPEED * (distance / ARRIVAL_RADIUS);
+    }
+    else {
+        desiredVelocity *= MAX_SPEED;
+    }
+
+    sf::Vector2f steering = normalize(desiredVelocity - m_velocity) * MAX_FORCE;
+    return steering * dt;
+}
+
+sf::Vector2f ReferenceAgent::wander(float dt)
+{
+    // Seeks a point on a unit circle in front of the agent, the angle drifts by a small random amount each time
+    sf::Vector2f center = m_pos + normalize(m_velocity);
+    m_wanderAngle += agentRandom(m_seed, m_id, m_randomTick, RandomStream::Wander, m_wanderDraws++) * 0.25 * WANDERNOICE - 0.125 * WANDERNOICE;
+
+    sf::Vector2f offset(std::cos(m_wanderAngle), std::sin(m_wanderAngle));
+    return seek(center + offset, dt);
+}
+
+sf::Vector2f ReferenceAgent::obstacleAvoidance(const std::vector<ScenarioObstacle>& obstacles, float dt) const
+{
+    sf::Vector2f avoidanceForce(0.0f, 0.0f);
+    int count = 0;
+    for (const ScenarioObstacle& obstacle : obstacles) {
+        sf::Vector2f toObstacle = obstacle.center - m_pos;
+        float reach = obstacle.radius + AVOIDANCE_DISTANCE;
+        if (vectorDotProduct(toObstacle, toObstacle) < reach * reach) {
+            avoidanceForce += normalize(toObstacle) * -1.0f;
+            count++;
+        }
+    }
+
+    if (count > 0) {
+        avoidanceForce /= static_cast<float>(count);
+        avoidanceForce = normalize(avoidanceForce) * MAX_FORCE;
+    }
+    return avoidanceForce * dt;
+}
+
+sf::Vector2f ReferenceAgent::queueing(const ReferenceWorld& world, float dt)
+{
+    // The agent at the front of the queue has nobody to follow and wanders
+    if (m_followIndex < 0) {
+        return wander(dt);
+    }
+
+    sf::Vector2f frontPosition = world.agents[m_followIndex].m_pos;
+    if (vectorMagnitude(frontPosition - m_pos) > QUEUE_DISTANCE) {
+        return seek(frontPosition, dt);
+    }
+    return sf::Vector2f(0.0f, 0.0f);
+}
+
+sf::Vector2f ReferenceAgent::followingLeader(const ReferenceWorld& world, float dt)
+{
+    // The leader has nobody to follow and wanders
+    if (m_followIndex < 0) {
+        return wander(dt);
+    }
+
+    const ReferenceAgent& leader = world.agents[m_followIndex];
+    sf::Vector2f behindPoint = leader.m_pos - normalize(leader.m_velocity) * LEADER_BEHIND_DIST;
+    return arrival(behindPoint, dt);
+}
+
+ReferenceSimulation::ReferenceSimulation(const Scenario& scenario, const std::vector<AgentState>& states) : m_obstacles(scenario.obstacles), m_targets(scenario.targets), m_worldSize(scenario.worldSize)
+{
+    m_agents.reserve(states.size());
+    for (const AgentState& state : states) {
+        m_agents.emplace_back(state, scenario.seed);
+    }
+}
+
+void ReferenceSimulation::step(float deltaTime)
+{
+    // Each scripted target holds until the next one's tick
+    while (m_nextTarget < m_targets.size() && m_targets[m_nextTarget].tick <= m_tick) {
+        m_target = m_targets[m_nextTarget].position;
+        m_nextTarget++;
+    }
+
+    ReferenceWorld world = { deltaTime, m_tick, m_target, m_agents, m_obstacles };
+    for (ReferenceAgent& agent : m_agents) {
+        agent.steer(world);
+    }
+    for (ReferenceAgent& agent : m_agents) {
+        agent.integrate(m_worldSize);
+    }
+    m_tick++;
+}
@@ -0,0 +1,111 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : ReferenceAgent.h
+Description : Declaration of the ReferenceAgent and ReferenceSimulation classes, the plain scalar steering model the optimised simulation is checked against.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include "Agent.h"
+#include "Scenario.h"
+
+#include <SFML/System/Vector2.hpp>
+
+class ReferenceAgent;
+
+// Everything a reference agent reads while steering, the agents are searched one by one with no spatial index
+struct ReferenceWorld {
+    float deltaTime;
+    unsigned int tick;
+    sf::Vector2i target;
+    const std::vector<ReferenceAgent>& agents;
+    const std::vector<ScenarioObstacle>& obstacles;
+};
+
+// The steering model written the simplest way, one agent at a time with exact math. Every behaviour is evaluated on
+// every tick, the forces are always summed by weight, and there is no time slicing, level of detail or chain ordering.
+// Nothing here should be optimised, it is what the optimised Agent is measured against
+class ReferenceAgent
+{
+private:
+    unsigned int m_id;
+    MovementBehavior m_behavior;
+    int m_followIndex;
+    unsigned int m_seed;
+
+    sf::Vector2f m_pos;
+    sf::Vector2f m_velocity;
+    sf::Vector2i m_targetPreviousPos;
+    float m_wanderAngle;
+    unsigned int m_randomTick;
+    unsigned int m_wanderDraws;
+
+    std::array<float, STEERING_BEHAVIOR_COUNT> m_weights = {};
+    sf::Vector2f m_steeringForce;
+
+    sf::Vector2f behaviorForce(SteeringBehavior behavior, const ReferenceWorld& world, const sf::Vector2f& targetVelocity);
+    sf::Vector2f flockingForce(SteeringBehavior behavior, const ReferenceWorld& world) const;
+    sf::Vector2f seek(const sf::Vector2f& target, float dt) const;
+    sf::Vector2f arrival(const sf::Vector2f& target, float dt) const;
+    sf::Vector2f wander(float dt);
+    sf::Vector2f obstacleAvoidance(const std::vector<ScenarioObstacle>& obstacles, float dt) const;
+    sf::Vector2f queueing(const ReferenceWorld& world, float dt);
+    sf::Vector2f followingLeader(const ReferenceWorld& world, float dt);
+
+public:
+    /***
+     * Constructor to start a reference agent from the same state as an agent in the simulation.
+     * @param state The agent's state, followIndex is where the followed agent sits in the same agent list.
+     * @param seed The simulation's seed, so wandering draws the same random numbers.
+     ***/
+    ReferenceAgent(const AgentState& state, unsigned int seed);
+
+    // steering pass, only reads the previous tick's state of the other agents
+    void steer(const ReferenceWorld& world);
+
+    // integration pass, applies the steering force to the velocity and position
+    void integrate(const sf::Vector2u& worldSize);
+
+    unsigned int getId() const { return m_id; }
+    MovementBehavior getBehavior() const { return m_behavior; }
+    sf::Vector2f getPosition() const { return m_pos; }
+    sf::Vector2f getVelocity() const { return m_velocity; }
+};
+
+// Steps a list of reference agents through a scenario, following its scripted targets the way the simulation does
+class ReferenceSimulation
+{
+private:
+    std::vector<ReferenceAgent> m_agents;
+    std::vector<ScenarioObstacle> m_obstacles;
+    std::vector<ScenarioTarget> m_targets;
+    size_t m_nextTarget = 0;
+    sf::Vector2i m_target;
+    sf::Vector2u m_worldSize;
+    unsigned int m_tick = 0;
+
+public:
+    /***
+     * Constructor to start the reference from the simulation's agents, taken before its first tick.
+     * @param scenario The scenario the simulation was started from, for its obstacles, targets, world size and seed.
+     * @param states The simulation's agents.
+     ***/
+    ReferenceSimulation(const Scenario& scenario, const std::vector<AgentState>& states);
+
+    /***
+     * Function to run one tick, every agent steers and then every agent moves.
+     * @param deltaTime The length of the tick.
+     ***/
+    void step(float deltaTime);
+
+    const std::vector<ReferenceAgent>& getAgents() const { return m_agents; }
+    unsigned int getTick() const { return m_tick; }
+};
@@ -0,0 +1,96 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : RenderSnapshot.h
+Description : Declaration of the RenderSnapshot struct, an immutable copy of everything the render thread needs to draw one simulation tick.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "Agent.h"
+#include "CheckpointWriter.h"
+#include "FrameTimeTracker.h"
+#include "JobSystem.h"
+#include "Telemetry.h"
+#include "TrajectoryRecorder.h"
+
+#include <SFML/Graphics.hpp>
+
+struct ObstacleRenderData {
+    sf::Vector2f position;
+    float radius;
+};
+
+// playback state shown in the debug text while replaying a recording
+struct ReplayStats {
+    bool active = false;
+    bool paused = false;
+    float speed = 1.0f;
+    unsigned int firstTick = 0;
+    unsigned int lastTick = 0;
+    unsigned int keyframeCount = 0;
+    float lastSeekMilliseconds = 0.0f;
+};
+
+// simulation state shown in the debug text
+struct SimulationStats {
+    ForceAccumulation accumulation = ForceAccumulation::WeightedSum;
+    std::array<unsigned long long, STEERING_BEHAVIOR_COUNT> skipCounts = {};
+    bool timeSlicing = false;
+    bool lodEnabled = false;
+    unsigned int activeAgentCount = 0;
+    unsigned int sleepingAgentCount = 0;
+    unsigned int reducedRateAgentCount = 0;
+
+    // how long the recent ticks took in milliseconds, worked out every WORKER_STATS_INTERVAL
+    FrameTimePercentiles tickTimes;
+
+    // neighbour searches on the last tick and how many agents they measured the distance to
+    unsigned long long neighborQueries = 0;
+    unsigned long long neighborCandidates = 0;
+
+    bool fixedTimestep = false;
+    bool fastMath = false;
+    bool chainOrdering = false;
+    unsigned int followWaveCount = 0;
+    bool checkpointing = false;
+    CheckpointStats checkpointStats;
+    bool recording = false;
+    TrajectoryRecorderStats recordingStats;
+    bool telemetry = false;
+    TelemetryStats telemetryStats;
+
+    // heap allocations of the last tick, only counted while allocation tracking is on
+    bool allocationTracking = false;
+    unsigned long long tickAllocations = 0;
+    unsigned long long tickAllocatedBytes = 0;
+    const char* heaviestAllocatingPhase = nullptr;
+    ReplayStats replay;
+
+    // hash of every agent's position and velocity, the same for any number of worker threads
+    std::uint64_t stateHash = 0;
+
+    std::vector<WorkerStats> workerStats;
+};
+
+struct RenderSnapshot {
+    unsigned int tick = 0;
+    unsigned int agentCount = 0;
+
+    // the visible agents of each behaviour as textured quads, four vertices each, drawn with one call per behaviour
+    std::array<std::vector<sf::Vertex>, MOVEMENT_BEHAVIOR_COUNT> agentQuads;
+
+    // the render thread rebuilds its obstacle sprites whenever the version changes
+    unsigned int obstacleVersion = 0;
+    std::vector<ObstacleRenderData> obstacles;
+
+    SimulationStats stats;
+};
@@ -0,0 +1,407 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : ScalingBenchmark.cpp
+Description : Implementation of the scaling benchmark, the whole simulation timed on canonical scenes from a thousand to a million agents.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "ScalingBenchmark.h"
+#include "Game.h"
+#include "Random.h"
+#include "Scenario.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#include <malloc.h>
+#else
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#endif
+
+namespace
+{
+    const unsigned int SCALING_AGENT_COUNTS[] = { 1000, 10000, 100000, 1000000 };
+
+    // thread scaling is measured at this size, big enough to keep every thread busy and small enough to run on one
+    const unsigned int SCALING_THREAD_AGENT_COUNT = 100000;
+
+    // each measurement runs for at least this long and this many ticks, after a few untimed ticks to size the buffers
+    const double SCALING_MIN_SECONDS = 0.5;
+    const unsigned int SCALING_MIN_TICKS = 3;
+    const unsigned int SCALING_MAX_TICKS = 200;
+    const unsigned int SCALING_WARMUP_TICKS = 2;
+
+    // queues are split into chains of at most this many agents, each led by a wandering agent
+    const unsigned int SCALING_QUEUE_CHAIN_LENGTH = 10000;
+
+    // the maze is a lattice of pillars, at most this many a side however big the world gets
+    const unsigned int SCALING_MAZE_PILLARS = 20;
+
+    enum class SceneKind {
+        DenseFlock,
+        SparseWander,
+        QueueChains,
+        FollowLeaderSwarm,
+        SeekMaze,
+        Mixed
+    };
+
+    // The world grows with the agent count so every size of a scene has the same density
+    struct SceneDefinition {
+        const char* name;
+        SceneKind kind;
+        float areaPerAgent;
+    };
+
+    const SceneDefinition SCALING_SCENES[] = {
+        { "dense_flock", SceneKind::DenseFlock, 900.0f },
+        { "sparse_wander", SceneKind::SparseWander, 10000.0f },
+        { "queue_chains", SceneKind::QueueChains, 2500.0f },
+        { "follow_leader_swarm", SceneKind::FollowLeaderSwarm, 2500.0f },
+        { "seek_maze", SceneKind::SeekMaze, 2500.0f },
+        { "mixed", SceneKind::Mixed, 2500.0f }
+    };
+
+    struct ScalingResult {
+        std::string suite;                  // "sizes" or "threads", the same run can be in both
+        std::string scene;
+        unsigned int agents = 0;
+        unsigned int threads = 0;
+        unsigned int ticks = 0;
+        double nsPerAgentStep = 0.0;
+        double candidatesPerAgentStep = 0.0;
+        double bytesPerAgent = 0.0;
+    };
+
+    Scenario buildScene(const SceneDefinition& scene, unsigned int agentCount)
+    {
+        unsigned int side = static_cast<unsigned int>(std::ceil(std::sqrt(agentCount * scene.areaPerAgent)));
+        sf::Vector2f center(side * 0.5f, side * 0.5f);
+        float worldSpread = side * 0.5f;
+
+        Scenario scenario;
+        scenario.worldSize = sf::Vector2u(side, side);
+        unsigned int draw = 0;
+        auto random = [&]() { return agentRandom(scenario.seed, agentCount, 0, RandomStream::Placement, draw++); };
+        auto randomPosition = [&]() { return sf::Vector2f(random() * side, random() * side); };
+
+        switch (scene.kind) {
+        case SceneKind::DenseFlock:
+            scenario.spawns.push_back({ MovementBehavior::Flocking, agentCount, center, worldSpread, 1 });
+            break;
+        case SceneKind::SparseWander:
+            scenario.spawns.push_back({ MovementBehavior::Wander, agentCount, center, worldSpread, 1 });
+            break;
+        case SceneKind::QueueChains:
+            // The first agent of each chain wanders, so it doesn't follow the end of the chain before it
+            for (unsigned int first = 0; first < agentCount; first += SCALING_QUEUE_CHAIN_LENGTH) {
+                unsigned int length = std::min(SCALING_QUEUE_CHAIN_LENGTH, agentCount - first);
+                sf::Vector2f position = randomPosition();
+                float spread = std::sqrt(length * scene.areaPerAgent / PI);
+                scenario.spawns.push_back({ MovementBehavior::Wander, 1, position, 0.0f, first });
+                scenario.spawns.push_back({ MovementBehavior::Queue, length - 1, position, spread, first + 1 });
+            }
+            break;
+        case SceneKind::FollowLeaderSwarm:
+            scenario.spawns.push_back({ MovementBehavior::Wander, 1, center, 0.0f, 1 });
+            scenario.spawns.push_back({ MovementBehavior::FollowLeader, agentCount - 1, center, worldSpread, 2 });
+            break;
+        case SceneKind::SeekMaze:
+        {
+            unsigned int pillars = std::min(SCALING_MAZE_PILLARS, std::max(2u, side / 150));
+            float spacing = static_cast<float>(side) / pillars;
+            for (unsigned int row = 0; row < pillars; ++row) {
+                for (unsigned int column = 0; column < pillars; ++column) {
+                    sf::Vector2f pillar((column + 0.5f) * spacing, (row + 0.5f) * spacing);
+                    scenario.obstacles.push_back({ pillar, spacing * 0.25f });
+                }
+            }
+            scenario.spawns.push_back({ MovementBehavior::Seek, agentCount, center, worldSpread, 1 });
+            scenario.targets.push_back({ 0, sf::Vector2i(0, 0) });
+            break;
+        }
+        case SceneKind::Mixed:
+        {
+            for (unsigned int i = 0; i < 8; ++i) {
+                scenario.obstacles.push_back({ randomPosition(), 20.0f + random() * 60.0f });
+            }
+            unsigned int share = agentCount / MOVEMENT_BEHAVIOR_COUNT;
+            for (int behavior = 0; behavior < MOVEMENT_BEHAVIOR_COUNT; ++behavior) {
+                unsigned int count = behavior == 0 ? agentCount - share * (MOVEMENT_BEHAVIOR_COUNT - 1) : share;
+                scenario.spawns.push_back({ static_cast<MovementBehavior>(behavior), count, randomPosition(), side * 0.25f, static_cast<unsigned int>(behavior) + 1 });
+            }
+            for (unsigned int tick = 0; tick < SCALING_MAX_TICKS + SCALING_WARMUP_TICKS; tick += 60) {
+                sf::Vector2f position = randomPosition();
+                scenario.targets.push_back({ tick, sf::Vector2i(static_cast<int>(position.x), static_cast<int>(position.y)) });
+            }
+            break;
+        }
+        }
+        return scenario;
+    }
+
+    size_t residentMemoryBytes()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return counters.WorkingSetSize;
+        }
+        return 0;
+#else
+        std::ifstream statm("/proc/self/statm");
+        size_t pages = 0;
+        size_t resident = 0;
+        statm >> pages >> resident;
+        return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+    // Hands memory freed by the last scene back to the system, so the next one's growth isn't hidden by reused pages
+    void releaseFreedMemory()
+    {
+#ifdef _WIN32
+        _heapmin();
+#elif defined(__GLIBC__)
+        malloc_trim(0);
+#endif
+    }
+
+    ScalingResult measureScene(const char* suite, const SceneDefinition& scene, unsigned int agentCount, unsigned int threads)
+    {
+        Scenario scenario = buildScene(scene, agentCount);
+
+        releaseFreedMemory();
+        size_t memoryBefore = residentMemoryBytes();
+
+        GameOptions options;
+        options.headless = true;
+        options.scenario = &scenario;
+        options.threadCount = threads;
+        Game game(options);
+        for (unsigned int i = 0; i < SCALING_WARMUP_TICKS; ++i) {
+            game.stepHeadless();
+        }
+        size_t memoryAfter = residentMemoryBytes();
+
+        unsigned long long candidates = 0;
+        unsigned int ticks = 0;
+        auto start = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed(0.0);
+        while (ticks < SCALING_MAX_TICKS && (ticks < SCALING_MIN_TICKS || elapsed.count() < SCALING_MIN_SECONDS)) {
+            game.stepHeadless();
+            candidates += game.getSimulationStats().neighborCandidates;
+            ticks++;
+            elapsed = std::chrono::steady_clock::now() - start;
+        }
+
+        double agentSteps = static_cast<double>(agentCount) * ticks;
+        ScalingResult result;
+        result.suite = suite;
+        result.scene = scene.name;
+        result.agents = agentCount;
+        result.threads = threads;
+        result.ticks = ticks;
+        result.nsPerAgentStep = elapsed.count() * 1e9 / agentSteps;
+        result.candidatesPerAgentStep = candidates / agentSteps;
+        result.bytesPerAgent = memoryAfter > memoryBefore ? static_cast<double>(memoryAfter - memoryBefore) / agentCount : 0.0;
+        return result;
+    }
+
+    std::string resultKey(const std::string& suite, const std::string& scene, unsigned int agents, unsigned int threads)
+    {
+        return suite + "/" + scene + "/" + std::to_string(agents) + "/" + std::to_string(threads);
+    }
+
+    // Finds "key": value on a line written by writeResults, strings have their quotes taken off
+    bool readJsonField(const std::string& line, const char* key, std::string& value)
+    {
+        std::string pattern = std::string("\"") + key + "\": ";
+        size_t start = line.find(pattern);
+        if (start == std::string::npos) {
+            return false;
+        }
+        start += pattern.size();
+        size_t end = line.find_first_of(",}", start);
+        value = line.substr(start, end - start);
+        if (value.size() >= 2 && value.front() == '"') {
+            value = value.substr(1, value.size() - 2);
+        }
+        return true;
+    }
+
+    // Reads a number field, false if it is missing or isn't only a number
+    template <typename T>
+    bool readJsonNumber(const std::string& line, const char* key, T& value)
+    {
+        std::string text;
+        if (!readJsonField(line, key, text)) {
+            return false;
+        }
+        const char* end = text.data() + text.size();
+        std::from_chars_result result = std::from_chars(text.data(), end, value);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    // Reads results written by an earlier run, keyed by scene, agent count and thread count. The baseline may have been
+    // copied or edited by hand, so a result line that doesn't read is reported and skipped rather than ending the run
+    bool readBaseline(const std::string& path, std::map<std::string, double>& baseline)
+    {
+        std::ifstream file(path);
+        if (!file) {
+            return false;
+        }
+
+        std::string line;
+        unsigned int lineNumber = 0;
+        while (std::getline(file, line)) {
+            lineNumber++;
+            std::string suite;
+            if (!readJsonField(line, "suite", suite)) {
+                continue;
+            }
+
+            std::string scene;
+            unsigned int agents;
+            unsigned int threads;
+            double nanoseconds;
+            if (readJsonField(line, "scene", scene) && readJsonNumber(line, "agents", agents) && readJsonNumber(line, "threads", threads) && readJsonNumber(line, "ns_per_agent_step", nanoseconds)) {
+                baseline[resultKey(suite, scene, agents, threads)] = nanoseconds;
+            }
+            else {
+                std::cerr << "Skipped unreadable result on line " << lineNumber << " of " << path << std::endl;
+            }
+        }
+        return true;
+    }
+
+    // One result to a line so the baseline can be read back without a JSON library
+    bool writeResults(const std::string& path, const std::vector<ScalingResult>& results)
+    {
+        std::ofstream file(path);
+        if (!file) {
+            return false;
+        }
+
+        file << "{\n  \"benchmark\": \"scaling\",\n  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const ScalingResult& result = results[i];
+            char line[256];
+            std::snprintf(line, sizeof(line), "    { \"suite\": \"%s\", \"scene\": \"%s\", \"agents\": %u, \"threads\": %u, \"ticks\": %u, \"ns_per_agent_step\": %.3f, \"candidates_per_agent_step\": %.1f, \"bytes_per_agent\": %.1f }%s\n",
+                result.suite.c_str(), result.scene.c_str(), result.agents, result.threads, result.ticks, result.nsPerAgentStep, result.candidatesPerAgentStep, result.bytesPerAgent, i + 1 < results.size() ? "," : "");
+            file << line;
+        }
+        file << "  ]\n}\n";
+        return static_cast<bool>(file);
+    }
+
+    // The change against the baseline, or a dash when the baseline doesn't have the result. Counts the regressions
+    std::string compareToBaseline(const ScalingResult& result, const std::map<std::string, double>& baseline, unsigned int& regressions)
+    {
+        auto found = baseline.find(resultKey(result.suite, result.scene, result.agents, result.threads));
+        if (found == baseline.end() || found->second <= 0.0) {
+            return "-";
+        }
+
+        double change = result.nsPerAgentStep / found->second - 1.0;
+        char text[32];
+        std::snprintf(text, sizeof(text), "%+.1f%%%s", change * 100.0, change > SCALING_REGRESSION_THRESHOLD ? " REGRESSION" : "");
+        if (change > SCALING_REGRESSION_THRESHOLD) {
+            regressions++;
+        }
+        return text;
+    }
+}
+
+int runScalingBenchmark(const std::string& resultsPath, const std::string& baselinePath, unsigned int maxAgents, std::ostream& output)
+{
+    std::map<std::string, double> baseline;
+    bool haveBaseline = readBaseline(baselinePath, baseline);
+
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned int defaultThreads = std::max(2u, hardwareThreads) - 1;
+
+    std::vector<ScalingResult> results;
+    unsigned int regressions = 0;
+    char line[256];
+
+    output << "Scaling, " << defaultThreads << " threads, at least " << SCALING_MIN_SECONDS << "s or " << SCALING_MIN_TICKS << " ticks per measurement\n";
+    for (const SceneDefinition& scene : SCALING_SCENES) {
+        output << scene.name << "\n";
+        output << "     agents  ticks  ns/agent-step  candidates/agent-step  bytes/agent  vs baseline\n";
+        for (unsigned int agentCount : SCALING_AGENT_COUNTS) {
+            if (agentCount > maxAgents) {
+                continue;
+            }
+            ScalingResult result = measureScene("sizes", scene, agentCount, defaultThreads);
+            results.push_back(result);
+
+            std::string change = compareToBaseline(result, baseline, regressions);
+            std::snprintf(line, sizeof(line), "  %9u  %5u  %13.2f  %21.1f  %11.1f  %s\n", result.agents, result.ticks, result.nsPerAgentStep, result.candidatesPerAgentStep, result.bytesPerAgent, change.c_str());
+            output << line;
+        }
+    }
+
+    // Powers of two up to every hardware thread, and every hardware thread itself when that isn't one
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < hardwareThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hardwareThreads);
+
+    unsigned int threadAgentCount = std::min(SCALING_THREAD_AGENT_COUNT, maxAgents);
+    output << "Thread scaling at " << threadAgentCount << " agents\n";
+    output << "  scene                 threads  ns/agent-step  speedup  efficiency  vs baseline\n";
+    for (const SceneDefinition& scene : SCALING_SCENES) {
+        double singleThreadTime = 0.0;
+        for (unsigned int threads : threadCounts) {
+            ScalingResult result = measureScene("threads", scene, threadAgentCount, threads);
+            results.push_back(result);
+            if (threads == 1) {
+                singleThreadTime = result.nsPerAgentStep;
+            }
+
+            double speedup = singleThreadTime / result.nsPerAgentStep;
+            std::string change = compareToBaseline(result, baseline, regressions);
+            std::snprintf(line, sizeof(line), "  %-20s  %7u  %13.2f  %6.2fx  %9.0f%%  %s\n", scene.name, threads, result.nsPerAgentStep, speedup, speedup / threads * 100.0, change.c_str());
+            output << line;
+        }
+    }
+
+    if (!writeResults(resultsPath, results)) {
+        std::cerr << "Failed to write " << resultsPath << std::endl;
+        return 1;
+    }
+    output << "Results written to " << resultsPath << "\n";
+
+    if (!haveBaseline) {
+        output << "No baseline at " << baselinePath << ", copy the results there to compare later runs against them\n";
+        return 0;
+    }
+    if (regressions > 0) {
+        output << regressions << " results are more than " << SCALING_REGRESSION_THRESHOLD * 100.0 << "% slower than " << baselinePath << "\n";
+        return 1;
+    }
+    output << "No results are more than " << SCALING_REGRESSION_THRESHOLD * 100.0 << "% slower than " << baselinePath << "\n";
+    return 0;
+}
@@ -0,0 +1,32 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : ScalingBenchmark.h
+Description : Declaration of the scaling benchmark, the whole simulation timed on canonical scenes from a thousand to a million agents.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <iostream>
+#include <string>
+
+const char SCALING_RESULTS_PATH[] = "benchmark_scaling.json";
+const char SCALING_BASELINE_PATH[] = "benchmark_baseline.json";
+
+// a result is flagged as a regression when a step takes this much longer per agent than in the baseline
+const double SCALING_REGRESSION_THRESHOLD = 0.15;
+
+/***
+ * Function to run every canonical scene at every size, then each scene on one to all of the hardware threads.
+ * @param resultsPath Where the results are written as JSON.
+ * @param baselinePath Results from an earlier run to compare against, skipped if the file doesn't exist.
+ * @param maxAgents Sizes above this are left out, to get a quicker run.
+ * @param output Where the tables are printed.
+ * @return The exit code for the program, non zero if a result regressed or the results couldn't be written.
+ ***/
+int runScalingBenchmark(const std::string& resultsPath, const std::string& baselinePath, unsigned int maxAgents, std::ostream& output);
@@ -0,0 +1,452 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : Scenario.cpp
+Description : Implementation of the scenario files that describe a world to load, its size, obstacles, agents and scripted targets, in a text and a binary format.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "Scenario.h"
+#include "LittleEndian.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    const char* BEHAVIOR_NAMES[MOVEMENT_BEHAVIOR_COUNT] = {
+        "Seek",
+        "Flee",
+        "Pursue",
+        "Evade",
+        "Wander",
+        "Arrival",
+        "Flocking",
+        "FollowLeader",
+        "Queue"
+    };
+
+    // Counts of each section, written after the header of a binary scenario. Every field of the records is
+    // four bytes, stored little endian whatever the machine so binary scenarios can be shared
+    struct BinaryScenarioHeader {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t worldWidth;
+        std::uint32_t worldHeight;
+        std::uint32_t seed;
+        std::uint32_t obstacleCount;
+        std::uint32_t spawnCount;
+        std::uint32_t targetCount;
+    };
+
+    struct BinaryObstacle {
+        float x;
+        float y;
+        float radius;
+    };
+
+    struct BinarySpawn {
+        std::uint32_t behavior;
+        std::uint32_t count;
+        float x;
+        float y;
+        float spread;
+        std::uint32_t seed;
+    };
+
+    struct BinaryTarget {
+        std::uint32_t tick;
+        std::int32_t x;
+        std::int32_t y;
+    };
+
+    bool readFile(const std::string& path, std::vector<char>& contents, std::string& error)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            error = "Failed to open '" + path + "'";
+            return false;
+        }
+
+        contents.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        if (!file.read(contents.data(), contents.size())) {
+            error = "Failed to read '" + path + "'";
+            return false;
+        }
+        return true;
+    }
+
+    // Splits a line into whitespace separated fields without copying them
+    class FieldReader
+    {
+    private:
+        const char* m_position;
+        const char* m_end;
+
+        void skipSpaces()
+        {
+            while (m_position < m_end && (*m_position == ' ' || *m_position == '\t' || *m_position == '\r')) {
+                ++m_position;
+            }
+        }
+
+    public:
+        FieldReader(const char* begin, const char* end) : m_position(begin), m_end(end) {}
+
+        // True once only spaces or a comment are left on the line
+        bool atEnd()
+        {
+            skipSpaces();
+            return m_position == m_end || *m_position == '#';
+        }
+
+        bool next(const char*& fieldBegin, const char*& fieldEnd)
+        {
+            if (atEnd()) {
+                return false;
+            }
+
+            fieldBegin = m_position;
+            while (m_position < m_end && *m_position != ' ' && *m_position != '\t' && *m_position != '\r') {
+                ++m_position;
+            }
+            fieldEnd = m_position;
+            return true;
+        }
+
+        template <typename T>
+        bool number(T& value)
+        {
+            const char* begin;
+            const char* end;
+            if (!next(begin, end)) {
+                return false;
+            }
+            std::from_chars_result result = std::from_chars(begin, end, value);
+            return result.ec == std::errc() && result.ptr == end;
+        }
+
+        bool word(std::string& value)
+        {
+            const char* begin;
+            const char* end;
+            if (!next(begin, end)) {
+                return false;
+            }
+            value.assign(begin, end);
+            return true;
+        }
+    };
+
+    bool parseTextScenario(const std::vector<char>& contents, Scenario& scenario, std::string& error)
+    {
+        const char* position = contents.data();
+        const char* end = contents.data() + contents.size();
+        unsigned int lineNumber = 0;
+
+        std::string keyword;
+        std::string behaviorName;
+        while (position < end) {
+            const char* lineEnd = std::find(position, end, '\n');
+            FieldReader fields(position, lineEnd);
+            position = lineEnd + (lineEnd < end ? 1 : 0);
+            lineNumber++;
+
+            if (!fields.word(keyword)) {
+                continue;
+            }
+
+            bool valid = false;
+            if (keyword == "world") {
+                valid = fields.number(scenario.worldSize.x) && fields.number(scenario.worldSize.y) && scenario.worldSize.x > 0 && scenario.worldSize.y > 0;
+            }
+            else if (keyword == "seed") {
+                valid = fields.number(scenario.seed);
+            }
+            else if (keyword == "obstacle") {
+                ScenarioObstacle obstacle;
+                valid = fields.number(obstacle.center.x) && fields.number(obstacle.center.y) && fields.number(obstacle.radius);
+                scenario.obstacles.push_back(obstacle);
+            }
+            else if (keyword == "agent") {
+                ScenarioSpawn spawn = { MovementBehavior::Wander, 1, sf::Vector2f(), 0.0f, 0 };
+                valid = fields.word(behaviorName) && parseMovementBehavior(behaviorName, spawn.behavior)
+                    && fields.number(spawn.position.x) && fields.number(spawn.position.y);
+                scenario.spawns.push_back(spawn);
+            }
+            else if (keyword == "spawn") {
+                ScenarioSpawn spawn = { MovementBehavior::Wander, 0, sf::Vector2f(), 0.0f, 0 };
+                valid = fields.word(behaviorName) && parseMovementBehavior(behaviorName, spawn.behavior)
+                    && fields.number(spawn.count) && fields.number(spawn.position.x) && fields.number(spawn.position.y) && fields.number(spawn.spread);
+
+                // the seed is optional, groups without one each get their own from their place in the file
+                spawn.seed = static_cast<unsigned int>(scenario.spawns.size());
+                if (valid && !fields.atEnd()) {
+                    valid = fields.number(spawn.seed);
+                }
+                scenario.spawns.push_back(spawn);
+            }
+            else if (keyword == "target") {
+                ScenarioTarget target;
+                valid = fields.number(target.tick) && fields.number(target.position.x) && fields.number(target.position.y);
+                scenario.targets.push_back(target);
+            }
+            else {
+                error = "Unknown entry '" + keyword + "' on line " + std::to_string(lineNumber);
+                return false;
+            }
+
+            if (!valid || !fields.atEnd()) {
+                error = "Invalid '" + keyword + "' entry on line " + std::to_string(lineNumber);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Reads the next four byte field
+    template <typename T>
+    bool readValue(const char*& position, const char* end, T& value)
+    {
+        static_assert(sizeof(T) == sizeof(std::uint32_t), "binary scenario fields are four bytes");
+        if (static_cast<size_t>(end - position) < sizeof(T)) {
+            return false;
+        }
+        value = loadLittleEndian<T>(reinterpret_cast<const std::uint8_t*>(position));
+        position += sizeof(T);
+        return true;
+    }
+
+    bool readRecord(const char*& position, const char* end, BinaryScenarioHeader& header)
+    {
+        if (static_cast<size_t>(end - position) < sizeof(header.magic)) {
+            return false;
+        }
+        std::memcpy(header.magic, position, sizeof(header.magic));
+        position += sizeof(header.magic);
+        return readValue(position, end, header.version) && readValue(position, end, header.worldWidth) && readValue(position, end, header.worldHeight)
+            && readValue(position, end, header.seed) && readValue(position, end, header.obstacleCount) && readValue(position, end, header.spawnCount)
+            && readValue(position, end, header.targetCount);
+    }
+
+    bool readRecord(const char*& position, const char* end, BinaryObstacle& record)
+    {
+        return readValue(position, end, record.x) && readValue(position, end, record.y) && readValue(position, end, record.radius);
+    }
+
+    bool readRecord(const char*& position, const char* end, BinarySpawn& record)
+    {
+        return readValue(position, end, record.behavior) && readValue(position, end, record.count) && readValue(position, end, record.x)
+            && readValue(position, end, record.y) && readValue(position, end, record.spread) && readValue(position, end, record.seed);
+    }
+
+    bool readRecord(const char*& position, const char* end, BinaryTarget& record)
+    {
+        return readValue(position, end, record.tick) && readValue(position, end, record.x) && readValue(position, end, record.y);
+    }
+
+    bool parseBinaryScenario(const std::vector<char>& contents, Scenario& scenario, std::string& error)
+    {
+        const char* position = contents.data();
+        const char* end = contents.data() + contents.size();
+
+        BinaryScenarioHeader header;
+        if (!readRecord(position, end, header)) {
+            error = "Binary scenario is too short";
+            return false;
+        }
+        if (header.version != SCENARIO_BINARY_VERSION) {
+            error = "Unsupported binary scenario version " + std::to_string(header.version);
+            return false;
+        }
+
+        // Check the whole file is there before reserving anything, so a corrupt count can't allocate gigabytes.
+        // The size is worked out in 64 bits so the counts can't wrap it round on a 32 bit build
+        std::uint64_t expectedSize = sizeof(BinaryScenarioHeader) + static_cast<std::uint64_t>(header.obstacleCount) * sizeof(BinaryObstacle)
+            + static_cast<std::uint64_t>(header.spawnCount) * sizeof(BinarySpawn) + static_cast<std::uint64_t>(header.targetCount) * sizeof(BinaryTarget);
+        if (contents.size() != expectedSize || header.worldWidth == 0 || header.worldHeight == 0) {
+            error = "Binary scenario is corrupt";
+            return false;
+        }
+
+        scenario.worldSize = sf::Vector2u(header.worldWidth, header.worldHeight);
+        scenario.seed = header.seed;
+
+        scenario.obstacles.resize(header.obstacleCount);
+        for (ScenarioObstacle& obstacle : scenario.obstacles) {
+            BinaryObstacle record;
+            if (!readRecord(position, end, record)) {
+                error = "Binary scenario is corrupt";
+                return false;
+            }
+            obstacle = { sf::Vector2f(record.x, record.y), record.radius };
+        }
+
+        scenario.spawns.resize(header.spawnCount);
+        for (ScenarioSpawn& spawn : scenario.spawns) {
+            BinarySpawn record;
+            if (!readRecord(position, end, record)) {
+                error = "Binary scenario is corrupt";
+                return false;
+            }
+            if (record.behavior >= static_cast<std::uint32_t>(MOVEMENT_BEHAVIOR_COUNT)) {
+                error = "Binary scenario has an unknown behaviour";
+                return false;
+            }
+            spawn = { static_cast<MovementBehavior>(record.behavior), record.count, sf::Vector2f(record.x, record.y), record.spread, record.seed };
+        }
+
+        scenario.targets.resize(header.targetCount);
+        for (ScenarioTarget& target : scenario.targets) {
+            BinaryTarget record;
+            if (!readRecord(position, end, record)) {
+                error = "Binary scenario is corrupt";
+                return false;
+            }
+            target = { record.tick, sf::Vector2i(record.x, record.y) };
+        }
+
+        return true;
+    }
+
+    template <typename T>
+    void appendValue(std::vector<char>& buffer, const T& value)
+    {
+        static_assert(sizeof(T) == sizeof(std::uint32_t), "binary scenario fields are four bytes");
+        std::uint8_t bytes[sizeof(T)];
+        storeLittleEndian(bytes, value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    void appendRecord(std::vector<char>& buffer, const BinaryScenarioHeader& header)
+    {
+        buffer.insert(buffer.end(), header.magic, header.magic + sizeof(header.magic));
+        appendValue(buffer, header.version);
+        appendValue(buffer, header.worldWidth);
+        appendValue(buffer, header.worldHeight);
+        appendValue(buffer, header.seed);
+        appendValue(buffer, header.obstacleCount);
+        appendValue(buffer, header.spawnCount);
+        appendValue(buffer, header.targetCount);
+    }
+
+    void appendRecord(std::vector<char>& buffer, const BinaryObstacle& record)
+    {
+        appendValue(buffer, record.x);
+        appendValue(buffer, record.y);
+        appendValue(buffer, record.radius);
+    }
+
+    void appendRecord(std::vector<char>& buffer, const BinarySpawn& record)
+    {
+        appendValue(buffer, record.behavior);
+        appendValue(buffer, record.count);
+        appendValue(buffer, record.x);
+        appendValue(buffer, record.y);
+        appendValue(buffer, record.spread);
+        appendValue(buffer, record.seed);
+    }
+
+    void appendRecord(std::vector<char>& buffer, const BinaryTarget& record)
+    {
+        appendValue(buffer, record.tick);
+        appendValue(buffer, record.x);
+        appendValue(buffer, record.y);
+    }
+}
+
+const char* movementBehaviorName(MovementBehavior behavior)
+{
+    int index = static_cast<int>(behavior);
+    return index >= 0 && index < MOVEMENT_BEHAVIOR_COUNT ? BEHAVIOR_NAMES[index] : "Unknown";
+}
+
+bool parseMovementBehavior(const std::string& name, MovementBehavior& behavior)
+{
+    for (int i = 0; i < MOVEMENT_BEHAVIOR_COUNT; ++i) {
+        if (name == BEHAVIOR_NAMES[i]) {
+            behavior = static_cast<MovementBehavior>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool loadScenario(const std::string& path, Scenario& scenario, std::string& error)
+{
+    std::vector<char> contents;
+    if (!readFile(path, contents, error)) {
+        return false;
+    }
+
+    scenario = Scenario();
+
+    bool loaded;
+    if (contents.size() >= sizeof(SCENARIO_BINARY_MAGIC) && std::memcmp(contents.data(), SCENARIO_BINARY_MAGIC, sizeof(SCENARIO_BINARY_MAGIC)) == 0) {
+        loaded = parseBinaryScenario(contents, scenario, error);
+    }
+    else {
+        loaded = parseTextScenario(contents, scenario, error);
+    }
+
+    // The counts are only checked here, nothing is allocated for the agents until the scenario is spawned
+    std::uint64_t agentCount = 0;
+    for (const ScenarioSpawn& spawn : scenario.spawns) {
+        agentCount += spawn.count;
+    }
+    if (loaded && agentCount > SCENARIO_MAX_AGENTS) {
+        error = "Scenario asks for " + std::to_string(agentCount) + " agents, the most is " + std::to_string(SCENARIO_MAX_AGENTS);
+        loaded = false;
+    }
+
+    // Targets are applied in tick order however they were written
+    std::stable_sort(scenario.targets.begin(), scenario.targets.end(), [](const ScenarioTarget& a, const ScenarioTarget& b) { return a.tick < b.tick; });
+
+    if (!loaded) {
+        error = path + ": " + error;
+    }
+    return loaded;
+}
+
+bool saveScenarioBinary(const std::string& path, const Scenario& scenario, std::string& error)
+{
+    BinaryScenarioHeader header;
+    std::memcpy(header.magic, SCENARIO_BINARY_MAGIC, sizeof(header.magic));
+    header.version = SCENARIO_BINARY_VERSION;
+    header.worldWidth = scenario.worldSize.x;
+    header.worldHeight = scenario.worldSize.y;
+    header.seed = scenario.seed;
+    header.obstacleCount = static_cast<std::uint32_t>(scenario.obstacles.size());
+    header.spawnCount = static_cast<std::uint32_t>(scenario.spawns.size());
+    header.targetCount = static_cast<std::uint32_t>(scenario.targets.size());
+
+    // Everything goes into one buffer so the file is written in a single call
+    std::vector<char> buffer;
+    buffer.reserve(sizeof(header) + scenario.obstacles.size() * sizeof(BinaryObstacle) + scenario.spawns.size() * sizeof(BinarySpawn) + scenario.targets.size() * sizeof(BinaryTarget));
+    appendRecord(buffer, header);
+    for (const ScenarioObstacle& obstacle : scenario.obstacles) {
+        appendRecord(buffer, BinaryObstacle{ obstacle.center.x, obstacle.center.y, obstacle.radius });
+    }
+    for (const ScenarioSpawn& spawn : scenario.spawns) {
+        appendRecord(buffer, BinarySpawn{ static_cast<std::uint32_t>(spawn.behavior), spawn.count, spawn.position.x, spawn.position.y, spawn.spread, spawn.seed });
+    }
+    for (const ScenarioTarget& target : scenario.targets) {
+        appendRecord(buffer, BinaryTarget{ target.tick, target.position.x, target.position.y });
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file || !file.write(buffer.data(), buffer.size())) {
+        error = "Failed to write '" + path + "'";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,84 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : Scenario.h
+Description : Declaration of the scenario files that describe a world to load, its size, obstacles, agents and scripted targets, in a text and a binary format.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Agent.h"
+
+#include <SFML/System/Vector2.hpp>
+
+// first bytes of a binary scenario, anything else is read as text
+const char SCENARIO_BINARY_MAGIC[4] = { 'B', 'S', 'C', 'N' };
+const unsigned int SCENARIO_BINARY_VERSION = 1;
+
+// the most agents a scenario can ask for across all its groups, the most the benchmarks run
+const unsigned int SCENARIO_MAX_AGENTS = 1000000;
+
+struct ScenarioObstacle {
+    sf::Vector2f center;
+    float radius;
+};
+
+// count agents of one behaviour placed at random within spread of the position, a single agent is a group of one with no spread
+struct ScenarioSpawn {
+    MovementBehavior behavior;
+    unsigned int count;
+    sf::Vector2f position;
+    float spread;
+    unsigned int seed;
+};
+
+// the target moves to the position once the simulation reaches the tick
+struct ScenarioTarget {
+    unsigned int tick;
+    sf::Vector2i position;
+};
+
+struct Scenario {
+    sf::Vector2u worldSize = sf::Vector2u(1000, 1000);
+    unsigned int seed = DEFAULT_SIMULATION_SEED;
+    std::vector<ScenarioObstacle> obstacles;
+    std::vector<ScenarioSpawn> spawns;
+    std::vector<ScenarioTarget> targets;
+};
+
+/***
+ * Function to load a scenario, the binary format is recognised by its magic bytes and anything else is parsed as text.
+ * Text scenarios have one entry per line, # starts a comment:
+ *   world <width> <height>
+ *   seed <seed>
+ *   obstacle <x> <y> <radius>
+ *   agent <behavior> <x> <y>
+ *   spawn <behavior> <count> <x> <y> <spread> [seed]
+ *   target <tick> <x> <y>
+ * Scenarios asking for more than SCENARIO_MAX_AGENTS agents are rejected.
+ * @param path The file to load.
+ * @param scenario Filled in with the scenario.
+ * @param error Set to what went wrong when loading fails.
+ * @return True if the scenario was loaded.
+ ***/
+bool loadScenario(const std::string& path, Scenario& scenario, std::string& error);
+
+/***
+ * Function to save a scenario in the binary format, every field little endian and the file written with a single write.
+ * @param path The file to write.
+ * @param scenario The scenario to save.
+ * @param error Set to what went wrong when saving fails.
+ * @return True if the scenario was saved.
+ ***/
+bool saveScenarioBinary(const std::string& path, const Scenario& scenario, std::string& error);
+
+// Name of a behaviour as written in scenario files, and the behaviour for a name
+const char* movementBehaviorName(MovementBehavior behavior);
+bool parseMovementBehavior(const std::string& name, MovementBehavior& behavior);
@@ -0,0 +1,190 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : SharedMemory.cpp
+Description : Implementation of the SharedMemory class, a named block of memory other processes on the same machine can map.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "SharedMemory.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef _WIN32
+    // Windows names have no leading slash and live in the session's namespace
+    std::string platformName(const std::string& name)
+    {
+        return "Local\\" + (name.empty() || name[0] != '/' ? name : name.substr(1));
+    }
+#endif
+}
+
+SharedMemory::SharedMemory()
+{
+}
+
+SharedMemory::~SharedMemory()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool SharedMemory::create(const std::string& name, size_t size, std::string& error)
+{
+    close();
+
+    // The mapping is backed by the page file and disappears once every process has closed it
+    unsigned long long mappingSize = size;
+    m_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(mappingSize >> 32), static_cast<DWORD>(mappingSize & 0xFFFFFFFF), platformName(name).c_str());
+    if (m_mapping == nullptr) {
+        error = "Failed to create shared memory '" + name + "'";
+        return false;
+    }
+
+    m_data = static_cast<unsigned char*>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+    if (m_data == nullptr) {
+        error = "Failed to map shared memory '" + name + "'";
+        close();
+        return false;
+    }
+    m_size = size;
+    m_name = name;
+    m_owner = true;
+    return true;
+}
+
+bool SharedMemory::open(const std::string& name, std::string& error)
+{
+    close();
+
+    m_mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, platformName(name).c_str());
+    if (m_mapping == nullptr) {
+        error = "Shared memory '" + name + "' doesn't exist, is the game running with telemetry on?";
+        return false;
+    }
+
+    m_data = static_cast<unsigned char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr) {
+        error = "Failed to map shared memory '" + name + "'";
+        close();
+        return false;
+    }
+
+    MEMORY_BASIC_INFORMATION information;
+    VirtualQuery(m_data, &information, sizeof(information));
+    m_size = information.RegionSize;
+    m_name = name;
+    m_owner = false;
+    return true;
+}
+
+void SharedMemory::close()
+{
+    if (m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+        m_data = nullptr;
+    }
+    if (m_mapping != nullptr) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    m_size = 0;
+    m_owner = false;
+}
+
+#else
+
+bool SharedMemory::create(const std::string& name, size_t size, std::string& error)
+{
+    close();
+
+    // A block left behind by a crash would keep its old size, so start from a new one
+    shm_unlink(name.c_str());
+    m_file = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (m_file < 0) {
+        error = "Failed to create shared memory '" + name + "'";
+        return false;
+    }
+    m_name = name;
+    m_owner = true;
+
+    if (ftruncate(m_file, static_cast<off_t>(size)) != 0) {
+        error = "Failed to size shared memory '" + name + "'";
+        close();
+        return false;
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+    if (data == MAP_FAILED) {
+        error = "Failed to map shared memory '" + name + "'";
+        close();
+        return false;
+    }
+    m_data = static_cast<unsigned char*>(data);
+    m_size = size;
+    return true;
+}
+
+bool SharedMemory::open(const std::string& name, std::string& error)
+{
+    close();
+
+    m_file = shm_open(name.c_str(), O_RDONLY, 0);
+    if (m_file < 0) {
+        error = "Shared memory '" + name + "' doesn't exist, is the game running with telemetry on?";
+        return false;
+    }
+
+    struct stat fileStatus;
+    if (fstat(m_file, &fileStatus) != 0 || fileStatus.st_size == 0) {
+        error = "Shared memory '" + name + "' is empty";
+        close();
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_SHARED, m_file, 0);
+    if (data == MAP_FAILED) {
+        error = "Failed to map shared memory '" + name + "'";
+        close();
+        return false;
+    }
+    m_data = static_cast<unsigned char*>(data);
+    m_size = static_cast<size_t>(fileStatus.st_size);
+    m_name = name;
+    return true;
+}
+
+void SharedMemory::close()
+{
+    if (m_data != nullptr) {
+        munmap(m_data, m_size);
+        m_data = nullptr;
+    }
+    if (m_file >= 0) {
+        ::close(m_file);
+        m_file = -1;
+    }
+    if (m_owner) {
+        shm_unlink(m_name.c_str());
+        m_owner = false;
+    }
+    m_size = 0;
+}
+
+#endif
@@ -0,0 +1,64 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : SharedMemory.h
+Description : Declaration of the SharedMemory class, a named block of memory other processes on the same machine can map.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// A named shared memory block, created read write by one process and opened read only by any number of others
+class SharedMemory
+{
+private:
+    unsigned char* m_data = nullptr;
+    size_t m_size = 0;
+    std::string m_name;
+    bool m_owner = false;
+
+#ifdef _WIN32
+    void* m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+
+public:
+    SharedMemory();
+
+    // Unmaps the block, the creator also removes the name
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    /***
+     * Function to create the block, replacing any left behind under the same name by a process that didn't exit cleanly.
+     * @param name The block's name, a POSIX shared memory name starting with a slash.
+     * @param size How many bytes the block holds, they start out zeroed.
+     * @param error Set to what went wrong when the block can't be created.
+     * @return True if the block was created.
+     ***/
+    bool create(const std::string& name, size_t size, std::string& error);
+
+    /***
+     * Function to open a block another process created, read only.
+     * @param name The block's name.
+     * @param error Set to what went wrong when the block can't be opened.
+     * @return True if the block was opened.
+     ***/
+    bool open(const std::string& name, std::string& error);
+
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+    unsigned char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+};
@@ -0,0 +1,54 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : SimulationCommand.h
+Description : Declaration of the SimulationCommand struct, a structural change to the simulation recorded by the input thread and applied between ticks.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include "Agent.h"
+
+const size_t SIMULATION_COMMAND_CAPACITY = 1024;
+
+// how close a right click has to be to an agent to despawn it
+const float DESPAWN_RADIUS = 20.0f;
+
+const float SPAWNED_OBSTACLE_RADIUS = 50.0f;
+
+enum class SimulationCommandType {
+    SpawnAgent,
+    DespawnAgent,
+    Reset,
+    SpawnObstacle,
+    ToggleForceAccumulation,
+    ToggleTimeSlicing,
+    ToggleLevelOfDetail,
+    ToggleFixedTimestep,
+    ToggleChainOrdering,
+    ToggleFastMath,
+    SaveWorld,
+    LoadWorld,
+    ToggleCheckpoints,
+    ToggleRecording,
+    ToggleTelemetry,
+    ToggleAllocationTracking,
+    ReplayTogglePause,
+    ReplayFaster,
+    ReplaySlower,
+    ReplaySeekForward,
+    ReplaySeekBack,
+    ReplayRestart
+};
+
+struct SimulationCommand {
+    SimulationCommandType type = SimulationCommandType::Reset;
+    sf::Vector2f position;
+    float radius = 0.0f;
+    MovementBehavior behavior = MovementBehavior::Wander;
+};
@@ -0,0 +1,180 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : SpatialGrid.cpp
+Description : Implementation of the SpatialGrid class, a uniform grid that sorts the agents by cell for neighbour queries and batching updates.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "SpatialGrid.h"
+#include "Agent.h"
+#include "JobSystem.h"
+
+#include <cmath>
+
+SpatialGrid::SpatialGrid(float cellSize) : m_cellSize(cellSize)
+{
+}
+
+SpatialGrid::~SpatialGrid()
+{
+}
+
+void SpatialGrid::build(const std::vector<std::unique_ptr<Agent>>& agents, const sf::Vector2u& worldSize, JobSystem* jobSystem)
+{
+    unsigned int agentCount = static_cast<unsigned int>(agents.size());
+    resize(agentCount, worldSize);
+
+    auto assignCells = [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            sf::Vector2f position = agents[i]->getPosition();
+            m_agentCells[i] = getRow(position.y) * m_columns + getColumn(position.x);
+        }
+    };
+
+    if (jobSystem != nullptr) {
+        jobSystem->parallelFor(0, agentCount, GRID_BUILD_CHUNK_SIZE, nullptr, 0, assignCells);
+    }
+    else {
+        assignCells(0, agentCount);
+    }
+
+    sortByCell(jobSystem);
+
+    // Copy the agents' state into cell order for the neighbour queries
+    m_agentIds.resize(agentCount);
+    m_positionX.resize(agentCount);
+    m_positionY.resize(agentCount);
+    m_velocityX.resize(agentCount);
+    m_velocityY.resize(agentCount);
+
+    auto gatherState = [&](unsigned int begin, unsigned int end) {
+        for (unsigned int slot = begin; slot < end; ++slot) {
+            const Agent& agent = *agents[m_agentIndices[slot]];
+            m_agentIds[slot] = agent.getId();
+            m_positionX[slot] = agent.getPosition().x;
+            m_positionY[slot] = agent.getPosition().y;
+            m_velocityX[slot] = agent.getVelocity().x;
+            m_velocityY[slot] = agent.getVelocity().y;
+        }
+    };
+
+    if (jobSystem != nullptr) {
+        jobSystem->parallelFor(0, agentCount, GRID_BUILD_CHUNK_SIZE, nullptr, 0, gatherState);
+    }
+    else {
+        gatherState(0, agentCount);
+    }
+}
+
+void SpatialGrid::build(const std::vector<sf::Vector2f>& positions, const sf::Vector2u& worldSize, JobSystem* jobSystem)
+{
+    unsigned int agentCount = static_cast<unsigned int>(positions.size());
+    resize(agentCount, worldSize);
+
+    auto assignCells = [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            m_agentCells[i] = getRow(positions[i].y) * m_columns + getColumn(positions[i].x);
+        }
+    };
+
+    if (jobSystem != nullptr) {
+        jobSystem->parallelFor(0, agentCount, GRID_BUILD_CHUNK_SIZE, nullptr, 0, assignCells);
+    }
+    else {
+        assignCells(0, agentCount);
+    }
+
+    sortByCell(jobSystem);
+}
+
+void SpatialGrid::resize(unsigned int agentCount, const sf::Vector2u& worldSize)
+{
+    m_columns = std::max(1, static_cast<int>(std::ceil(worldSize.x / m_cellSize)));
+    m_rows = std::max(1, static_cast<int>(std::ceil(worldSize.y / m_cellSize)));
+
+    m_cellStart.resize(getCellCount() + 1);
+    m_agentIndices.resize(agentCount);
+    m_agentCells.resize(agentCount);
+}
+
+void SpatialGrid::sortByCell(JobSystem* jobSystem)
+{
+    unsigned int cellCount = getCellCount();
+    unsigned int agentCount = static_cast<unsigned int>(m_agentCells.size());
+
+    // Without a job system the whole build is one chunk, which is the plain serial counting sort
+    unsigned int chunkCount = 1;
+    if (jobSystem != nullptr) {
+        chunkCount = std::max(1u, (agentCount + GRID_BUILD_CHUNK_SIZE - 1) / GRID_BUILD_CHUNK_SIZE);
+    }
+    unsigned int chunkSize = chunkCount == 1 ? agentCount : GRID_BUILD_CHUNK_SIZE;
+    m_chunkCounts.resize(static_cast<size_t>(chunkCount) * cellCount);
+
+    auto forEachChunk = [&](auto function) {
+        if (chunkCount > 1) {
+            jobSystem->parallelFor(0, chunkCount, 1, nullptr, 0, function);
+        }
+        else {
+            function(0, chunkCount);
+        }
+    };
+
+    // Each chunk counts its own agents per cell
+    auto countChunks = [&](unsigned int begin, unsigned int end) {
+        for (unsigned int chunk = begin; chunk < end; ++chunk) {
+            unsigned int* counts = m_chunkCounts.data() + static_cast<size_t>(chunk) * cellCount;
+            std::fill(counts, counts + cellCount, 0u);
+
+            unsigned int last = std::min(agentCount, (chunk + 1) * chunkSize);
+            for (unsigned int i = chunk * chunkSize; i < last; ++i) {
+                counts[m_agentCells[i]]++;
+            }
+        }
+    };
+    forEachChunk(countChunks);
+
+    // Each chunk's counts become its offset inside the cell, earlier chunks go first so agents stay in order within a cell
+    auto offsetCells = [&](unsigned int begin, unsigned int end) {
+        for (unsigned int cell = begin; cell < end; ++cell) {
+            unsigned int total = 0;
+            for (unsigned int chunk = 0; chunk < chunkCount; ++chunk) {
+                unsigned int& count = m_chunkCounts[static_cast<size_t>(chunk) * cellCount + cell];
+                unsigned int offset = total;
+                total += count;
+                count = offset;
+            }
+            m_cellStart[cell + 1] = total;
+        }
+    };
+    if (chunkCount > 1) {
+        jobSystem->parallelFor(0, cellCount, 64, nullptr, 0, offsetCells);
+    }
+    else {
+        offsetCells(0, cellCount);
+    }
+
+    // Turn the counts into where each cell starts, there are few enough cells that this stays serial
+    m_cellStart[0] = 0;
+    for (unsigned int cell = 0; cell < cellCount; ++cell) {
+        m_cellStart[cell + 1] += m_cellStart[cell];
+    }
+
+    // Each chunk scatters its agent indices into the slots it was given
+    auto scatterChunks = [&](unsigned int begin, unsigned int end) {
+        for (unsigned int chunk = begin; chunk < end; ++chunk) {
+            unsigned int* cursors = m_chunkCounts.data() + static_cast<size_t>(chunk) * cellCount;
+
+            unsigned int last = std::min(agentCount, (chunk + 1) * chunkSize);
+            for (unsigned int i = chunk * chunkSize; i < last; ++i) {
+                unsigned int cell = m_agentCells[i];
+                m_agentIndices[m_cellStart[cell] + cursors[cell]++] = i;
+            }
+        }
+    };
+    forEachChunk(scatterChunks);
+}
@@ -0,0 +1,126 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : SpatialGrid.h
+Description : Declaration of the SpatialGrid class, a uniform grid that sorts the agents by cell for neighbour queries and batching updates.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <SFML/System/Vector2.hpp>
+
+class Agent;
+class JobSystem;
+
+const float GRID_CELL_SIZE = 100.0f;
+
+// agents per chunk when the grid is built in parallel, every chunk counts and scatters its own agents
+const unsigned int GRID_BUILD_CHUNK_SIZE = 16384;
+
+class SpatialGrid
+{
+private:
+    float m_cellSize;
+    int m_columns = 0;
+    int m_rows = 0;
+
+    // agents in cell c are m_agentIndices[m_cellStart[c]] up to m_agentIndices[m_cellStart[c + 1]]
+    std::vector<unsigned int> m_cellStart;
+    std::vector<unsigned int> m_agentIndices;
+
+    // each agent's id, position and velocity copied in cell order when the grid is built, so neighbour queries read contiguous arrays
+    std::vector<unsigned int> m_agentIds;
+    std::vector<float> m_positionX;
+    std::vector<float> m_positionY;
+    std::vector<float> m_velocityX;
+    std::vector<float> m_velocityY;
+
+    // cell of each agent in the agents vector and each chunk's agents per cell, kept between builds to avoid reallocating
+    std::vector<unsigned int> m_agentCells;
+    std::vector<unsigned int> m_chunkCounts;
+
+    void resize(unsigned int agentCount, const sf::Vector2u& worldSize);
+
+    // counts the agents per cell, works out where each cell starts and scatters the agent indices, in parallel when given a job system
+    void sortByCell(JobSystem* jobSystem);
+
+public:
+    SpatialGrid(float cellSize);
+    ~SpatialGrid();
+
+    // Sorts the agents into their cells, spread over the job system's workers when one is given
+    void build(const std::vector<std::unique_ptr<Agent>>& agents, const sf::Vector2u& worldSize, JobSystem* jobSystem = nullptr);
+    void build(const std::vector<sf::Vector2f>& positions, const sf::Vector2u& worldSize, JobSystem* jobSystem = nullptr);
+
+    unsigned int getCellCount() const { return static_cast<unsigned int>(m_columns * m_rows); }
+
+    // prefix sum of the agents per cell, getCellCount() + 1 entries
+    const unsigned int* getCellStarts() const { return m_cellStart.data(); }
+
+    // agent indices sorted by cell
+    const std::vector<unsigned int>& getAgentIndices() const { return m_agentIndices; }
+
+    // agent state in cell order as it was when the grid was built, only filled in when built from the agents
+    const unsigned int* getAgentIds() const { return m_agentIds.data(); }
+    const float* getPositionX() const { return m_positionX.data(); }
+    const float* getPositionY() const { return m_positionY.data(); }
+    const float* getVelocityX() const { return m_velocityX.data(); }
+    const float* getVelocityY() const { return m_velocityY.data(); }
+
+    int getColumn(float x) const { return std::clamp(static_cast<int>(x / m_cellSize), 0, m_columns - 1); }
+    int getRow(float y) const { return std::clamp(static_cast<int>(y / m_cellSize), 0, m_rows - 1); }
+
+    /***
+     * Calls the function with the index of every agent in the cells overlapping a square around the position.
+     * The caller still has to check the distance, this only narrows down the candidates.
+     * @param position The centre of the query.
+     * @param radius The distance from the centre that has to be covered.
+     * @param function Called with each candidate agent index.
+     ***/
+    template <typename Function>
+    void forEachAgentNear(const sf::Vector2f& position, float radius, Function function) const
+    {
+        forEachSpanNear(position, radius, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int i = begin; i < end; ++i) {
+                function(m_agentIndices[i]);
+            }
+        });
+    }
+
+    /***
+     * Calls the function with each span of cell ordered slots covering a square around the position.
+     * Cells in a row are contiguous so every row of the square is a single span.
+     * @param position The centre of the query.
+     * @param radius The distance from the centre that has to be covered.
+     * @param function Called as function(begin, end) with slots into the cell ordered arrays.
+     ***/
+    template <typename Function>
+    void forEachSpanNear(const sf::Vector2f& position, float radius, Function function) const
+    {
+        if (m_columns == 0 || m_rows == 0) {
+            return;
+        }
+
+        int firstColumn = getColumn(position.x - radius);
+        int lastColumn = getColumn(position.x + radius);
+        int firstRow = getRow(position.y - radius);
+        int lastRow = getRow(position.y + radius);
+
+        for (int row = firstRow; row <= lastRow; ++row) {
+            unsigned int begin = m_cellStart[row * m_columns + firstColumn];
+            unsigned int end = m_cellStart[row * m_columns + lastColumn + 1];
+            if (begin < end) {
+                function(begin, end);
+            }
+        }
+    }
+};
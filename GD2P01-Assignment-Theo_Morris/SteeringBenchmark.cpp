@@ -0,0 +1,358 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : SteeringBenchmark.cpp
+Description : Implementation of the steering microbenchmarks, each steering behaviour and vector helper timed on its own in cycles per call.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "SteeringBenchmark.h"
+#include "Agent.h"
+#include "FastMath.h"
+#include "Game.h"
+#include "Math.h"
+#include "MathBatch.h"
+#include "ObstacleTable.h"
+#include "Random.h"
+
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define STEERING_BENCHMARK_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace
+{
+    const unsigned int STEERING_BENCHMARK_CALLS = 1 << 20;
+    const unsigned int STEERING_BENCHMARK_REPETITIONS = 5;
+
+    // the behaviours are called on these agents in turn, more than fit in the caches like a real crowd
+    const unsigned int STEERING_BENCHMARK_AGENTS = 1 << 16;
+    const unsigned int STEERING_BENCHMARK_OBSTACLES = 16;
+    const sf::Vector2u STEERING_BENCHMARK_WORLD_SIZE(1000, 1000);
+
+#ifdef MATH_BATCH_SSE2
+    const char BATCH_VERSION_NAME[] = "sse2";
+#else
+    const char BATCH_VERSION_NAME[] = "batch";
+#endif
+
+    std::uint64_t readCycleCounter()
+    {
+#ifdef STEERING_BENCHMARK_TSC
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    // Counter ticks per second, measured against the steady clock. The time stamp counter runs at a fixed rate on
+    // current CPUs, so these are reference cycles rather than the core's own while it boosts or throttles
+    double cycleCounterFrequency()
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::uint64_t startCycles = readCycleCounter();
+        std::chrono::duration<double> elapsed(0.0);
+        while (elapsed.count() < 0.05) {
+            elapsed = std::chrono::steady_clock::now() - start;
+        }
+        return (readCycleCounter() - startCycles) / elapsed.count();
+    }
+
+    struct Measurement {
+        double cyclesPerCall = DBL_MAX;
+        double callsPerSecond = 0.0;
+    };
+
+    // The best of a few passes over every input. Prepare runs untimed before each pass to reset inputs changed in place,
+    // the counter isn't serialising but a million calls between the reads hides that
+    template <typename Prepare, typename Run>
+    Measurement measure(Prepare prepare, Run run, float& sink)
+    {
+        Measurement best;
+        for (unsigned int i = 0; i < STEERING_BENCHMARK_REPETITIONS; ++i) {
+            prepare();
+            auto start = std::chrono::steady_clock::now();
+            std::uint64_t startCycles = readCycleCounter();
+            sink += run();
+            std::uint64_t cycles = readCycleCounter() - startCycles;
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            double cyclesPerCall = static_cast<double>(cycles) / STEERING_BENCHMARK_CALLS;
+            if (cyclesPerCall < best.cyclesPerCall) {
+                best.cyclesPerCall = cyclesPerCall;
+                best.callsPerSecond = STEERING_BENCHMARK_CALLS / elapsed.count();
+            }
+        }
+        return best;
+    }
+
+    template <typename Run>
+    Measurement measure(Run run, float& sink)
+    {
+        return measure([]() {}, run, sink);
+    }
+
+    // Random agents, obstacles and vectors, the vectors reach well past the world so wrapping and clamping both have work to do
+    struct BenchmarkInputs {
+        std::vector<std::unique_ptr<Agent>> agents;
+        ObstacleTable obstacles;
+        std::vector<sf::Vector2f> points;
+        std::vector<sf::Vector2f> velocities;
+        std::vector<float> angles;
+        std::vector<float> x;
+        std::vector<float> y;
+    };
+
+    void generateInputs(BenchmarkInputs& inputs)
+    {
+        auto random = [](unsigned int index, unsigned int draw) { return agentRandom(DEFAULT_SIMULATION_SEED, index, 0, RandomStream::Spawn, draw); };
+        sf::Vector2f worldSize(STEERING_BENCHMARK_WORLD_SIZE);
+
+        inputs.agents.reserve(STEERING_BENCHMARK_AGENTS);
+        for (unsigned int i = 0; i < STEERING_BENCHMARK_AGENTS; ++i) {
+            float heading = random(i, 2) * 2.0f * PI;
+            float speed = random(i, 3) * MAX_SPEED;
+
+            AgentState state = {};
+            state.id = i;
+            state.behavior = static_cast<std::uint32_t>(MovementBehavior::Wander);
+            state.followIndex = -1;
+            state.positionX = random(i, 0) * worldSize.x;
+            state.positionY = random(i, 1) * worldSize.y;
+            state.velocityX = std::cos(heading) * speed;
+            state.velocityY = std::sin(heading) * speed;
+            state.wanderAngle = heading;
+            inputs.agents.push_back(std::make_unique<Agent>(state, DEFAULT_SIMULATION_SEED));
+        }
+
+        for (unsigned int i = 0; i < STEERING_BENCHMARK_OBSTACLES; ++i) {
+            sf::Vector2f center(random(i, 4) * worldSize.x, random(i, 5) * worldSize.y);
+            inputs.obstacles.add(center, 20.0f + random(i, 6) * 60.0f);
+        }
+
+        inputs.points.resize(STEERING_BENCHMARK_CALLS);
+        inputs.velocities.resize(STEERING_BENCHMARK_CALLS);
+        inputs.angles.resize(STEERING_BENCHMARK_CALLS);
+        inputs.x.resize(STEERING_BENCHMARK_CALLS);
+        inputs.y.resize(STEERING_BENCHMARK_CALLS);
+        for (unsigned int i = 0; i < STEERING_BENCHMARK_CALLS; ++i) {
+            inputs.points[i] = sf::Vector2f((random(i, 7) - 0.25f) * 1.5f * worldSize.x, (random(i, 8) - 0.25f) * 1.5f * worldSize.y);
+            inputs.velocities[i] = sf::Vector2f((random(i, 9) - 0.5f) * 2.0f * MAX_SPEED, (random(i, 10) - 0.5f) * 2.0f * MAX_SPEED);
+            inputs.angles[i] = random(i, 11) * 360.0f;
+            inputs.x[i] = inputs.points[i].x;
+            inputs.y[i] = inputs.points[i].y;
+        }
+    }
+}
+
+int runSteeringBenchmark(std::ostream& output)
+{
+    BenchmarkInputs inputs;
+    generateInputs(inputs);
+
+    const float dt = FIXED_TIMESTEP;
+    const float clampMagnitude = 500.0f;
+    const sf::Vector2f origin(400.0f, 600.0f);
+    const std::vector<sf::Vector2f>& points = inputs.points;
+    const std::vector<sf::Vector2f>& velocities = inputs.velocities;
+
+    output << "Steering microbenchmarks, " << STEERING_BENCHMARK_CALLS << " calls over " << STEERING_BENCHMARK_AGENTS << " agents and " << STEERING_BENCHMARK_OBSTACLES << " obstacles, best of " << STEERING_BENCHMARK_REPETITIONS << " runs\n";
+#ifdef STEERING_BENCHMARK_TSC
+    char frequency[64];
+    std::snprintf(frequency, sizeof(frequency), "%.2f", cycleCounterFrequency() / 1e9);
+    output << "Cycles counted by the time stamp counter at " << frequency << " GHz\n";
+#else
+    output << "No cycle counter on this CPU, cycles are nanoseconds\n";
+#endif
+    output << "  function            version  cycles/call  Mcalls/s  speedup\n";
+
+    // Every version of a function is compared with the first, the scalar one
+    Measurement scalar;
+    auto report = [&](const char* name, const char* version, const Measurement& measurement) {
+        if (std::strcmp(version, "scalar") == 0) {
+            scalar = measurement;
+        }
+        char line[128];
+        std::snprintf(line, sizeof(line), "  %-18s  %-7s  %11.2f  %8.1f  %6.2fx\n", name, version, measurement.cyclesPerCall, measurement.callsPerSecond / 1e6, scalar.cyclesPerCall / measurement.cyclesPerCall);
+        output << line;
+    };
+
+    float sink = 0.0f;
+
+    // Agent behaviours, with the exact and then the approximate math
+    auto agentAt = [&](unsigned int i) -> Agent& { return *inputs.agents[i & (STEERING_BENCHMARK_AGENTS - 1)]; };
+    auto timeBehavior = [&](const char* name, auto behavior) {
+        const char* versions[] = { "scalar", "fast" };
+        for (int fastMath = 0; fastMath < 2; ++fastMath) {
+            for (const std::unique_ptr<Agent>& agent : inputs.agents) {
+                agent->setFastMath(fastMath != 0);
+            }
+            Measurement measurement = measure([&]() {
+                float sum = 0.0f;
+                for (unsigned int i = 0; i < STEERING_BENCHMARK_CALLS; ++i) {
+                    sf::Vector2f force = behavior(agentAt(i), i);
+                    sum += force.x + force.y;
+                }
+                return sum;
+            }, sink);
+            report(name, versions[fastMath], measurement);
+        }
+    };
+
+    timeBehavior("seek", [&](Agent& agent, unsigned int i) { return agent.seek(points[i], dt); });
+    timeBehavior("flee", [&](Agent& agent, unsigned int i) { return agent.flee(points[i], dt); });
+    timeBehavior("pursuit", [&](Agent& agent, unsigned int i) { return agent.pursuit(points[i], velocities[i], dt); });
+    timeBehavior("evade", [&](Agent& agent, unsigned int i) { return agent.evade(points[i], velocities[i], dt); });
+    timeBehavior("arrival", [&](Agent& agent, unsigned int i) { return agent.arrival(points[i], dt); });
+    timeBehavior("wander", [&](Agent& agent, unsigned int) { return agent.wander(dt); });
+    timeBehavior("obstacleAvoidance", [&](Agent& agent, unsigned int) { return agent.obstacleAvoidance(inputs.obstacles, dt); });
+    timeBehavior("wallFollowing", [&](Agent& agent, unsigned int) { return agent.wallFollowing(inputs.obstacles, dt); });
+
+    // Math.h helpers, next to their MathBatch.h and FastMath.h versions
+    std::vector<float> scalarX(STEERING_BENCHMARK_CALLS);
+    std::vector<float> scalarY(STEERING_BENCHMARK_CALLS);
+    std::vector<float> batchX;
+    std::vector<float> batchY;
+    auto copyInputs = [&]() {
+        batchX = inputs.x;
+        batchY = inputs.y;
+    };
+    bool batchMatches = true;
+
+    report("normalize", "scalar", measure([&]() {
+        for (unsigned int i = 0; i < STEERING_BENCHMARK_CALLS; ++i) {
+            sf::Vector2f normalized = normalize(points[i]);
+            scalarX[i] = normalized.x;
+            scalarY[i] = normalized.y;
+        }
+        return scalarX[STEERING_BENCHMARK_CALLS / 2];
+    }, sink));
+    report("normalize", BATCH_VERSION_NAME, measure(copyInputs, [&]() {
+        batchNormalize(batchX.data(), batchY.data(), STEERING_BENCHMARK_CALLS);
+        return batchX[STEERING_BENCHMARK_CALLS / 2];
+    }, sink));
+    batchMatches = batchMatches && scalarX == batchX && scalarY == batchY;
+    report("normalize", "fast", measure([&]() {
+        for (unsigned int i = 0; i < STEERING_BENCHMARK_CALLS; ++i) {
+            sf::Vector2f normalized = fastNormalize(points[i]);
+            scalarX[i] = normalized.x;
+            scalarY[i] = normalized.y;
+        }
+        return scalarX[STEERING_BENCHMARK_CALLS / 2];
+    }, sink));
+
+    report("vectorMagnitude", "scalar", measure([&]() {
+        float sum = 0.0f;
+        for (unsigned int i = 0; i < STEERING_BENCHMARK_CALLS; ++i) {
+            sum += vectorMagnitude(points[i]);
+        }
+        return sum;
+    }, sink));
+    report("vectorMagnitude", "fast", measure([&]() {
+        float sum = 0.0f;
+        for (unsigned int i = 0; i < STEERING_BENCHMARK_CALLS; ++i) {
+            sum += fastVectorMagnitude(points[i]);
+        }
+        return sum;
+    }, sink));
+
+    std::vector<float> scalarDistances(STEERING_BENCHMARK_CALLS);
+    std::vector<float> batchDistances(STEERING_BENCHMARK_CALLS);
+    report("vectorDistance", "scalar", measure([&]() {
+        for (unsigned int i = 0; i < STEERING_BENCHMARK_CALLS; ++i) {
+            scalarDistances[i] = vectorDistance(origin, points[i]);
+        }
+        return scalarDistances[STEERING_BENCHMARK_CALLS / 2];
+    }, sink));
+    report("vectorDistance", BATCH_VERSION_NAME, measure([&]() {
+        batchDistance(origin.x, origin.y, inputs.x.data(), inputs.y.data(), STEERING_BENCHMARK_CALLS, batchDistances.data());
+        return batchDistances[STEERING_BENCHMARK_CALLS / 2];
+    }, sink));
+    batchMatches = batchMatches && scalarDistances == batchDistances;
+
+    report("vectorDotProduct", "scalar", measure([&]() {
+        float sum = 0.0f;
+        for (unsigned int i = 0; i < STEERING_BENCHMARK_CALLS; ++i) {
+            sum += vectorDotProduct(points[i], velocities[i]);
+        }
+        return sum;
+    }, sink));
+
+    report("clamp magnitude", "scalar", measure([&]() {
+        for (unsigned int i = 0; i < STEERING_BENCHMARK_CALLS; ++i) {
+            sf::Vector2f vector = points[i];
+            if (vectorMagnitude(vector) > clampMagnitude) {
+                vector = normalize(vector) * clampMagnitude;
+            }
+            scalarX[i] = vector.x;
+            scalarY[i] = vector.y;
+        }
+        return scalarX[STEERING_BENCHMARK_CALLS / 2];
+    }, sink));
+    report("clamp magnitude", BATCH_VERSION_NAME, measure(copyInputs, [&]() {
+        batchClampMagnitude(batchX.data(), batchY.data(), STEERING_BENCHMARK_CALLS, clampMagnitude);
+        return batchX[STEERING_BENCHMARK_CALLS / 2];
+    }, sink));
+    batchMatches = batchMatches && scalarX == batchX && scalarY == batchY;
+
+    report("wrapPosition", "scalar", measure([&]() {
+        for (unsigned int i = 0; i < STEERING_BENCHMARK_CALLS; ++i) {
+            sf::Vector2f position = points[i];
+            wrapPosition(position, STEERING_BENCHMARK_WORLD_SIZE);
+            scalarX[i] = position.x;
+            scalarY[i] = position.y;
+        }
+        return scalarX[STEERING_BENCHMARK_CALLS / 2];
+    }, sink));
+    report("wrapPosition", BATCH_VERSION_NAME, measure(copyInputs, [&]() {
+        batchWrapPositions(batchX.data(), batchY.data(), STEERING_BENCHMARK_CALLS, STEERING_BENCHMARK_WORLD_SIZE);
+        return batchX[STEERING_BENCHMARK_CALLS / 2];
+    }, sink));
+    batchMatches = batchMatches && scalarX == batchX && scalarY == batchY;
+
+    report("rotate", "scalar", measure([&]() {
+        float sum = 0.0f;
+        for (unsigned int i = 0; i < STEERING_BENCHMARK_CALLS; ++i) {
+            sf::Vector2f rotated = rotate(velocities[i], inputs.angles[i]);
+            sum += rotated.x + rotated.y;
+        }
+        return sum;
+    }, sink));
+
+    report("castRay", "scalar", measure([&]() {
+        float sum = 0.0f;
+        for (unsigned int i = 0; i < STEERING_BENCHMARK_CALLS; ++i) {
+            sf::Vector2f hitPoint;
+            if (castRay(agentAt(i).getPosition(), velocities[i], DETECTION_RAY_LENGTH, inputs.obstacles.getCenterX(), inputs.obstacles.getCenterY(), inputs.obstacles.size(), hitPoint)) {
+                sum += hitPoint.x;
+            }
+        }
+        return sum;
+    }, sink));
+
+    // printing the sink keeps the timed loops from being removed
+    output << "  (checksum " << sink << ")\n";
+
+    if (!batchMatches) {
+        output << "Batch math does not match the scalar versions\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,23 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : SteeringBenchmark.h
+Description : Declaration of the steering microbenchmarks, each steering behaviour and vector helper timed on its own in cycles per call.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <iostream>
+
+/***
+ * Function to time every Agent steering behaviour and Math.h helper over large random input arrays, with the
+ * SIMD batch and fast math versions next to the scalar one where they exist.
+ * @param output Where the cycles per call and throughput of each version are printed.
+ * @return The exit code for the program, non zero if a batch version gives different results to the scalar one.
+ ***/
+int runSteeringBenchmark(std::ostream& output);
@@ -0,0 +1,321 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : Telemetry.cpp
+Description : Implementation of the live telemetry ring, every tick's agent states published to shared memory for other processes to read in place.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "Telemetry.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <new>
+#include <thread>
+
+namespace
+{
+    const size_t CACHE_LINE_SIZE = 64;
+
+    // Where a slot's columns start, relative to the slot
+    struct TelemetryColumns {
+        size_t positionX;
+        size_t positionY;
+        size_t velocityX;
+        size_t velocityY;
+        size_t behavior;
+    };
+
+    TelemetryColumns telemetryColumns(unsigned int slotCapacity)
+    {
+        size_t floatColumnSize = static_cast<size_t>(slotCapacity) * sizeof(float);
+        TelemetryColumns columns;
+        columns.positionX = sizeof(TelemetrySlotHeader);
+        columns.positionY = columns.positionX + floatColumnSize;
+        columns.velocityX = columns.positionY + floatColumnSize;
+        columns.velocityY = columns.velocityX + floatColumnSize;
+        columns.behavior = columns.velocityY + floatColumnSize;
+        return columns;
+    }
+
+    // How often the reader looks for a new frame when it has read the newest one
+    const std::chrono::microseconds TELEMETRY_POLL_INTERVAL(500);
+}
+
+size_t telemetrySlotSize(unsigned int slotCapacity)
+{
+    size_t size = telemetryColumns(slotCapacity).behavior + slotCapacity;
+    return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+TelemetryPublisher::TelemetryPublisher()
+{
+}
+
+TelemetryPublisher::~TelemetryPublisher()
+{
+    stop();
+}
+
+bool TelemetryPublisher::start(const std::string& name, unsigned int slotCapacity, std::string& error)
+{
+    stop();
+
+    size_t slotSize = telemetrySlotSize(slotCapacity);
+    size_t slotsOffset = sizeof(TelemetryHeader);
+    if (!m_memory.create(name, slotsOffset + slotSize * TELEMETRY_SLOT_COUNT, error)) {
+        return false;
+    }
+
+    // The memory starts zeroed, the atomics are still constructed in it so they are properly alive
+    unsigned char* data = m_memory.data();
+    m_header = new (data) TelemetryHeader();
+    std::copy(TELEMETRY_MAGIC, TELEMETRY_MAGIC + sizeof(TELEMETRY_MAGIC), m_header->magic);
+    m_header->version = TELEMETRY_VERSION;
+    m_header->slotCount = TELEMETRY_SLOT_COUNT;
+    m_header->slotCapacity = slotCapacity;
+    m_header->slotSize = slotSize;
+    m_header->slotsOffset = slotsOffset;
+    m_header->publishedFrames.store(0, std::memory_order_relaxed);
+    for (unsigned int i = 0; i < TELEMETRY_SLOT_COUNT; ++i) {
+        TelemetrySlotHeader* slot = new (data + slotsOffset + slotSize * i) TelemetrySlotHeader();
+        slot->sequence.store(0, std::memory_order_relaxed);
+    }
+    m_header->writerActive.store(1, std::memory_order_release);
+
+    m_frame = 0;
+    m_stats = TelemetryStats();
+    return true;
+}
+
+void TelemetryPublisher::stop()
+{
+    if (m_header == nullptr) {
+        return;
+    }
+    m_header->writerActive.store(0, std::memory_order_release);
+    m_header = nullptr;
+    m_slot = nullptr;
+    m_memory.close();
+}
+
+TelemetryFrame TelemetryPublisher::beginFrame(unsigned int tick, unsigned int agentCount)
+{
+    unsigned char* slotData = m_memory.data() + m_header->slotsOffset + (m_frame % m_header->slotCount) * m_header->slotSize;
+    m_slot = reinterpret_cast<TelemetrySlotHeader*>(slotData);
+
+    // An odd sequence tells readers the slot is changing, the fence keeps the writes below from moving ahead of it
+    std::uint32_t sequence = m_slot->sequence.load(std::memory_order_relaxed);
+    m_slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    unsigned int capacity = m_header->slotCapacity;
+    m_slot->tick = tick;
+    m_slot->agentCount = std::min(agentCount, capacity);
+    m_slot->totalAgentCount = agentCount;
+    m_slot->frame = m_frame;
+    if (agentCount > capacity) {
+        m_stats.framesTruncated++;
+    }
+
+    TelemetryColumns columns = telemetryColumns(capacity);
+    TelemetryFrame frame;
+    frame.agentCount = m_slot->agentCount;
+    frame.positionX = reinterpret_cast<float*>(slotData + columns.positionX);
+    frame.positionY = reinterpret_cast<float*>(slotData + columns.positionY);
+    frame.velocityX = reinterpret_cast<float*>(slotData + columns.velocityX);
+    frame.velocityY = reinterpret_cast<float*>(slotData + columns.velocityY);
+    frame.behavior = slotData + columns.behavior;
+    return frame;
+}
+
+void TelemetryPublisher::endFrame(float publishMilliseconds)
+{
+    // Back to even once every column is written, then the frame becomes the newest
+    m_slot->sequence.store(m_slot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    m_frame++;
+    m_header->publishedFrames.store(m_frame, std::memory_order_release);
+    m_slot = nullptr;
+
+    m_stats.framesPublished = m_frame;
+    m_stats.lastPublishMilliseconds = publishMilliseconds;
+}
+
+TelemetrySubscriber::TelemetrySubscriber()
+{
+}
+
+TelemetrySubscriber::~TelemetrySubscriber()
+{
+}
+
+bool TelemetrySubscriber::open(const std::string& name, std::string& error)
+{
+    m_header = nullptr;
+    if (!m_memory.open(name, error)) {
+        return false;
+    }
+
+    const TelemetryHeader* header = reinterpret_cast<const TelemetryHeader*>(m_memory.data());
+    if (m_memory.size() < sizeof(TelemetryHeader) || !std::equal(TELEMETRY_MAGIC, TELEMETRY_MAGIC + sizeof(TELEMETRY_MAGIC), header->magic)) {
+        error = "Shared memory '" + name + "' isn't a telemetry ring";
+        m_memory.close();
+        return false;
+    }
+    if (header->version != TELEMETRY_VERSION) {
+        error = "Shared memory '" + name + "' is telemetry version " + std::to_string(header->version) + ", expected version " + std::to_string(TELEMETRY_VERSION);
+        m_memory.close();
+        return false;
+    }
+    if (header->slotCount == 0 || header->slotSize < telemetrySlotSize(header->slotCapacity) || header->slotsOffset + header->slotSize * header->slotCount > m_memory.size()) {
+        error = "Shared memory '" + name + "' has a damaged telemetry header";
+        m_memory.close();
+        return false;
+    }
+
+    m_header = header;
+    return true;
+}
+
+bool TelemetrySubscriber::beginRead(TelemetryFrameView& view) const
+{
+    std::uint64_t publishedFrames = m_header->publishedFrames.load(std::memory_order_acquire);
+    if (publishedFrames == 0) {
+        return false;
+    }
+
+    const unsigned char* slotData = m_memory.data() + m_header->slotsOffset + ((publishedFrames - 1) % m_header->slotCount) * m_header->slotSize;
+    const TelemetrySlotHeader* slot = reinterpret_cast<const TelemetrySlotHeader*>(slotData);
+    std::uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+    if (sequence & 1) {
+        return false;
+    }
+
+    // The count is clamped so a frame written over mid read can't send the reader past the slot
+    TelemetryColumns columns = telemetryColumns(m_header->slotCapacity);
+    view.frame = slot->frame;
+    view.tick = slot->tick;
+    view.agentCount = std::min(slot->agentCount, m_header->slotCapacity);
+    view.totalAgentCount = slot->totalAgentCount;
+    view.positionX = reinterpret_cast<const float*>(slotData + columns.positionX);
+    view.positionY = reinterpret_cast<const float*>(slotData + columns.positionY);
+    view.velocityX = reinterpret_cast<const float*>(slotData + columns.velocityX);
+    view.velocityY = reinterpret_cast<const float*>(slotData + columns.velocityY);
+    view.behavior = slotData + columns.behavior;
+    view.slot = slot;
+    view.sequence = sequence;
+    return true;
+}
+
+bool TelemetrySubscriber::endRead(const TelemetryFrameView& view) const
+{
+    // The fence keeps the reads of the columns from moving after the second look at the sequence
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return view.slot->sequence.load(std::memory_order_relaxed) == view.sequence;
+}
+
+int runTelemetryReader(unsigned int seconds, std::ostream& output)
+{
+    TelemetrySubscriber subscriber;
+    std::string error;
+    if (!subscriber.open(TELEMETRY_NAME, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    output << "Reading telemetry from " << TELEMETRY_NAME << "\n";
+
+    // What the last whole frame looked like, worked out straight from the shared memory
+    unsigned int tick = 0;
+    unsigned int agentCount = 0;
+    unsigned int totalAgentCount = 0;
+    double centroidX = 0.0;
+    double centroidY = 0.0;
+    double meanSpeed = 0.0;
+    std::array<unsigned int, 256> behaviorCounts = {};
+    std::array<unsigned int, 256> frameBehaviorCounts;
+
+    std::uint64_t lastFrame = 0;
+    unsigned long long framesRead = 0;
+    unsigned long long framesMissed = 0;
+    unsigned long long framesTorn = 0;
+    unsigned long long totalFramesRead = 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+    auto nextReport = startTime + std::chrono::seconds(1);
+    while (seconds == 0 || std::chrono::steady_clock::now() - startTime < std::chrono::seconds(seconds)) {
+        if (!subscriber.isWriterActive()) {
+            output << "The simulation stopped publishing\n";
+            break;
+        }
+
+        if (std::chrono::steady_clock::now() >= nextReport) {
+            nextReport += std::chrono::seconds(1);
+            output << "tick " << tick << ": " << agentCount << " agents";
+            if (totalAgentCount > agentCount) {
+                output << " of " << totalAgentCount;
+            }
+            output << ", centroid (" << centroidX << ", " << centroidY << "), mean speed " << meanSpeed << " px/tick, behaviours";
+            for (unsigned int behavior = 0; behavior < behaviorCounts.size(); ++behavior) {
+                if (behaviorCounts[behavior] > 0) {
+                    output << " " << behavior << ":" << behaviorCounts[behavior];
+                }
+            }
+            output << ", " << framesRead << " frames read, " << framesMissed << " missed, " << framesTorn << " torn\n";
+            framesRead = 0;
+            framesMissed = 0;
+            framesTorn = 0;
+        }
+
+        TelemetryFrameView view;
+        if (!subscriber.beginRead(view) || (totalFramesRead > 0 && view.frame == lastFrame)) {
+            std::this_thread::sleep_for(TELEMETRY_POLL_INTERVAL);
+            continue;
+        }
+
+        double sumX = 0.0;
+        double sumY = 0.0;
+        double sumSpeed = 0.0;
+        frameBehaviorCounts.fill(0);
+        for (unsigned int i = 0; i < view.agentCount; ++i) {
+            sumX += view.positionX[i];
+            sumY += view.positionY[i];
+            sumSpeed += std::sqrt(view.velocityX[i] * view.velocityX[i] + view.velocityY[i] * view.velocityY[i]);
+            frameBehaviorCounts[view.behavior[i]]++;
+        }
+
+        // The simulation wrote over the slot while it was being read, try again with the newest frame
+        if (!subscriber.endRead(view)) {
+            framesTorn++;
+            continue;
+        }
+
+        if (totalFramesRead > 0 && view.frame > lastFrame + 1) {
+            framesMissed += view.frame - lastFrame - 1;
+        }
+        lastFrame = view.frame;
+        framesRead++;
+        totalFramesRead++;
+
+        tick = view.tick;
+        agentCount = view.agentCount;
+        totalAgentCount = view.totalAgentCount;
+        double count = std::max(view.agentCount, 1u);
+        centroidX = sumX / count;
+        centroidY = sumY / count;
+        meanSpeed = sumSpeed / count;
+        behaviorCounts = frameBehaviorCounts;
+    }
+
+    if (totalFramesRead == 0) {
+        std::cerr << "No telemetry frames were read" << std::endl;
+        return 1;
+    }
+    output << totalFramesRead << " frames read in total, the last from tick " << tick << "\n";
+    return 0;
+}
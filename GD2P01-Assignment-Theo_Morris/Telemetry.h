@@ -0,0 +1,193 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : Telemetry.h
+Description : Declaration of the live telemetry ring, every tick's agent states published to shared memory for other processes to read in place.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include "SharedMemory.h"
+
+const char TELEMETRY_MAGIC[4] = { 'B', 'T', 'E', 'L' };
+const unsigned int TELEMETRY_VERSION = 1;
+const char TELEMETRY_NAME[] = "/agent_telemetry";
+
+// a reader has this many ticks to finish with a frame before the simulation writes over it
+const unsigned int TELEMETRY_SLOT_COUNT = 4;
+
+// agents past this many are left out of a frame, the frame's totalAgentCount still says how many there were
+const unsigned int TELEMETRY_SLOT_CAPACITY = 262144;
+
+// The sequence numbers are shared between processes, so they have to work without a lock
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free && std::atomic<std::uint64_t>::is_always_lock_free, "Telemetry needs lock free atomics");
+
+// The start of the shared memory. The slots follow it at slotsOffset, each slotSize bytes
+struct alignas(64) TelemetryHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t slotCount;
+    std::uint32_t slotCapacity;
+    std::uint64_t slotSize;
+    std::uint64_t slotsOffset;
+
+    // how many frames have been published, the newest is in slot (publishedFrames - 1) % slotCount
+    std::atomic<std::uint64_t> publishedFrames;
+
+    // cleared when the simulation stops publishing, so readers know no more frames are coming
+    std::atomic<std::uint32_t> writerActive;
+};
+
+// Each slot is this header then the positionX, positionY, velocityX and velocityY columns of slotCapacity floats
+// and the behavior column of slotCapacity bytes. The sequence is odd while the slot is being written, a reader
+// reads it before and after looking at the slot and only trusts what it saw if both reads are the same even number
+struct alignas(64) TelemetrySlotHeader {
+    std::atomic<std::uint32_t> sequence;
+    std::uint32_t tick;
+    std::uint32_t agentCount;
+    std::uint32_t totalAgentCount;
+    std::uint64_t frame;
+};
+
+// One frame's columns, written in place by the simulation
+struct TelemetryFrame {
+    unsigned int agentCount = 0;
+    float* positionX = nullptr;
+    float* positionY = nullptr;
+    float* velocityX = nullptr;
+    float* velocityY = nullptr;
+    std::uint8_t* behavior = nullptr;
+};
+
+// One frame's columns as a reader sees them, straight from the shared memory
+struct TelemetryFrameView {
+    std::uint64_t frame = 0;
+    unsigned int tick = 0;
+    unsigned int agentCount = 0;
+    unsigned int totalAgentCount = 0;
+    const float* positionX = nullptr;
+    const float* positionY = nullptr;
+    const float* velocityX = nullptr;
+    const float* velocityY = nullptr;
+    const std::uint8_t* behavior = nullptr;
+
+    // the slot and the sequence it had when the view was taken, checked again by endRead
+    const TelemetrySlotHeader* slot = nullptr;
+    std::uint32_t sequence = 0;
+};
+
+// published frames and the time the simulation spent writing the last one, shown in the debug text
+struct TelemetryStats {
+    unsigned long long framesPublished = 0;
+    unsigned long long framesTruncated = 0;
+    float lastPublishMilliseconds = 0.0f;
+};
+
+/***
+ * Function to work out how many bytes one slot takes, a multiple of the cache line size.
+ * @param slotCapacity The most agents a slot holds.
+ * @return The slot's size in bytes.
+ ***/
+size_t telemetrySlotSize(unsigned int slotCapacity);
+
+// Writes frames into the ring, only used by the simulation thread
+class TelemetryPublisher
+{
+private:
+    SharedMemory m_memory;
+    TelemetryHeader* m_header = nullptr;
+    TelemetrySlotHeader* m_slot = nullptr;
+    std::uint64_t m_frame = 0;
+    TelemetryStats m_stats;
+
+public:
+    TelemetryPublisher();
+
+    // Stops publishing if it hasn't been already
+    ~TelemetryPublisher();
+
+    /***
+     * Function to create the shared memory and start publishing.
+     * @param name The shared memory's name.
+     * @param slotCapacity The most agents a frame holds.
+     * @param error Set to what went wrong when publishing can't start.
+     * @return True if publishing started.
+     ***/
+    bool start(const std::string& name, unsigned int slotCapacity, std::string& error);
+
+    // Tells readers no more frames are coming and removes the shared memory's name, readers keep their mapping
+    void stop();
+
+    bool isPublishing() const { return m_header != nullptr; }
+
+    /***
+     * Function to mark the next slot as being written and hand out its columns.
+     * @param tick The tick the frame is from.
+     * @param agentCount How many agents there are, only the first slotCapacity of them fit.
+     * @return The frame's columns, its agentCount says how many agents to write.
+     ***/
+    TelemetryFrame beginFrame(unsigned int tick, unsigned int agentCount);
+
+    /***
+     * Function to mark the slot from beginFrame as written and make it the newest frame.
+     * @param publishMilliseconds How long the simulation spent on the frame, for the stats.
+     ***/
+    void endFrame(float publishMilliseconds);
+
+    const TelemetryStats& getStats() const { return m_stats; }
+};
+
+// Reads frames out of the ring without copying them, for processes watching the simulation
+class TelemetrySubscriber
+{
+private:
+    SharedMemory m_memory;
+    const TelemetryHeader* m_header = nullptr;
+
+public:
+    TelemetrySubscriber();
+    ~TelemetrySubscriber();
+
+    /***
+     * Function to open the shared memory a running simulation is publishing to.
+     * @param name The shared memory's name.
+     * @param error Set to what went wrong when the shared memory can't be read.
+     * @return True if the shared memory was opened.
+     ***/
+    bool open(const std::string& name, std::string& error);
+
+    std::uint64_t getPublishedFrames() const { return m_header->publishedFrames.load(std::memory_order_acquire); }
+    bool isWriterActive() const { return m_header->writerActive.load(std::memory_order_acquire) != 0; }
+
+    /***
+     * Function to point a view at the newest frame. Nothing in the view can be trusted until endRead says so.
+     * @param view Set to the newest frame's columns.
+     * @return False if there is no frame yet or the newest one is being written.
+     ***/
+    bool beginRead(TelemetryFrameView& view) const;
+
+    /***
+     * Function to check the frame wasn't written over while it was being read.
+     * @param view The view from beginRead.
+     * @return True if everything read through the view since beginRead is one whole frame.
+     ***/
+    bool endRead(const TelemetryFrameView& view) const;
+};
+
+/***
+ * Function to run the reference telemetry reader, which prints what a running simulation is publishing once a second.
+ * @param seconds How long to read for, zero to read until the simulation stops publishing.
+ * @param output Where the summaries are printed.
+ * @return The exit code for the program, non zero if there was nothing to read.
+ ***/
+int runTelemetryReader(unsigned int seconds, std::ostream& output);
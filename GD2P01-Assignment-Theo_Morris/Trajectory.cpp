@@ -0,0 +1,151 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : Trajectory.cpp
+Description : Implementation of the trajectory recording format, quantised agent states delta coded against the previous frame and entropy coded.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "Trajectory.h"
+#include "LittleEndian.h"
+#include "VarInt.h"
+
+#include <cstring>
+
+// Nothing is padded, so a record's offsets in the file are the sizes of the records before it
+static_assert(sizeof(TrajectoryFileHeader) == 24 && sizeof(TrajectoryFrameHeader) == 20 && sizeof(TrajectoryIndexEntry) == 16 && sizeof(TrajectoryFooter) == 16, "trajectory records must not be padded");
+
+namespace
+{
+    // The columns in the order they are coded, each one read through a pointer to its member
+    using SampleColumn = std::uint32_t TrajectorySample::*;
+
+    const SampleColumn UNSIGNED_COLUMNS[] = { &TrajectorySample::id, &TrajectorySample::behavior };
+
+    using SignedColumn = std::int32_t TrajectorySample::*;
+
+    const SignedColumn SIGNED_COLUMNS[] = { &TrajectorySample::positionX, &TrajectorySample::positionY, &TrajectorySample::velocityX, &TrajectorySample::velocityY };
+
+    // Differences wrap rather than overflow, decoding adds them back with the same wrap
+    std::int32_t difference(std::uint32_t value, std::uint32_t base)
+    {
+        return static_cast<std::int32_t>(value - base);
+    }
+}
+
+void encodeTrajectoryFrame(const TrajectorySample* samples, const TrajectorySample* previous, unsigned int count, std::vector<std::uint8_t>& raw)
+{
+    raw.clear();
+
+    for (SampleColumn column : UNSIGNED_COLUMNS) {
+        for (unsigned int i = 0; i < count; ++i) {
+            std::uint32_t base = previous != nullptr ? previous[i].*column : 0;
+            appendVarInt(raw, zigzagEncode(difference(samples[i].*column, base)));
+        }
+    }
+
+    for (SignedColumn column : SIGNED_COLUMNS) {
+        for (unsigned int i = 0; i < count; ++i) {
+            std::uint32_t base = previous != nullptr ? static_cast<std::uint32_t>(previous[i].*column) : 0;
+            appendVarInt(raw, zigzagEncode(difference(static_cast<std::uint32_t>(samples[i].*column), base)));
+        }
+    }
+}
+
+bool decodeTrajectoryFrame(const std::uint8_t* raw, size_t size, const TrajectorySample* previous, unsigned int count, TrajectorySample* samples)
+{
+    size_t position = 0;
+    std::uint32_t value;
+
+    for (SampleColumn column : UNSIGNED_COLUMNS) {
+        for (unsigned int i = 0; i < count; ++i) {
+            if (!readVarInt(raw, size, position, value)) {
+                return false;
+            }
+            std::uint32_t base = previous != nullptr ? previous[i].*column : 0;
+            samples[i].*column = base + static_cast<std::uint32_t>(zigzagDecode(value));
+        }
+    }
+
+    for (SignedColumn column : SIGNED_COLUMNS) {
+        for (unsigned int i = 0; i < count; ++i) {
+            if (!readVarInt(raw, size, position, value)) {
+                return false;
+            }
+            std::uint32_t base = previous != nullptr ? static_cast<std::uint32_t>(previous[i].*column) : 0;
+            samples[i].*column = static_cast<std::int32_t>(base + static_cast<std::uint32_t>(zigzagDecode(value)));
+        }
+    }
+
+    return position == size;
+}
+
+void storeTrajectoryRecord(std::uint8_t* bytes, const TrajectoryFileHeader& header)
+{
+    std::memcpy(bytes, header.magic, sizeof(header.magic));
+    storeLittleEndian(bytes + 4, header.version);
+    storeLittleEndian(bytes + 8, header.positionScale);
+    storeLittleEndian(bytes + 12, header.velocityScale);
+    storeLittleEndian(bytes + 16, header.worldWidth);
+    storeLittleEndian(bytes + 20, header.worldHeight);
+}
+
+void storeTrajectoryRecord(std::uint8_t* bytes, const TrajectoryFrameHeader& header)
+{
+    storeLittleEndian(bytes, header.tick);
+    storeLittleEndian(bytes + 4, header.agentCount);
+    storeLittleEndian(bytes + 8, header.flags);
+    storeLittleEndian(bytes + 12, header.rawSize);
+    storeLittleEndian(bytes + 16, header.payloadSize);
+}
+
+void storeTrajectoryRecord(std::uint8_t* bytes, const TrajectoryIndexEntry& entry)
+{
+    storeLittleEndian(bytes, entry.tick);
+    storeLittleEndian(bytes + 4, entry.frame);
+    storeLittleEndian(bytes + 8, entry.offset);
+}
+
+void storeTrajectoryRecord(std::uint8_t* bytes, const TrajectoryFooter& footer)
+{
+    storeLittleEndian(bytes, footer.indexOffset);
+    storeLittleEndian(bytes + 8, footer.entryCount);
+    std::memcpy(bytes + 12, footer.magic, sizeof(footer.magic));
+}
+
+void loadTrajectoryRecord(const std::uint8_t* bytes, TrajectoryFileHeader& header)
+{
+    std::memcpy(header.magic, bytes, sizeof(header.magic));
+    header.version = loadLittleEndian<std::uint32_t>(bytes + 4);
+    header.positionScale = loadLittleEndian<float>(bytes + 8);
+    header.velocityScale = loadLittleEndian<float>(bytes + 12);
+    header.worldWidth = loadLittleEndian<std::uint32_t>(bytes + 16);
+    header.worldHeight = loadLittleEndian<std::uint32_t>(bytes + 20);
+}
+
+void loadTrajectoryRecord(const std::uint8_t* bytes, TrajectoryFrameHeader& header)
+{
+    header.tick = loadLittleEndian<std::uint32_t>(bytes);
+    header.agentCount = loadLittleEndian<std::uint32_t>(bytes + 4);
+    header.flags = loadLittleEndian<std::uint32_t>(bytes + 8);
+    header.rawSize = loadLittleEndian<std::uint32_t>(bytes + 12);
+    header.payloadSize = loadLittleEndian<std::uint32_t>(bytes + 16);
+}
+
+void loadTrajectoryRecord(const std::uint8_t* bytes, TrajectoryIndexEntry& entry)
+{
+    entry.tick = loadLittleEndian<std::uint32_t>(bytes);
+    entry.frame = loadLittleEndian<std::uint32_t>(bytes + 4);
+    entry.offset = loadLittleEndian<std::uint64_t>(bytes + 8);
+}
+
+void loadTrajectoryRecord(const std::uint8_t* bytes, TrajectoryFooter& footer)
+{
+    footer.indexOffset = loadLittleEndian<std::uint64_t>(bytes);
+    footer.entryCount = loadLittleEndian<std::uint32_t>(bytes + 8);
+    std::memcpy(footer.magic, bytes + 12, sizeof(footer.magic));
+}
@@ -0,0 +1,108 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : Trajectory.h
+Description : Declaration of the trajectory recording format, quantised agent states delta coded against the previous frame and entropy coded.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const char TRAJECTORY_MAGIC[4] = { 'B', 'T', 'R', 'J' };
+const char TRAJECTORY_INDEX_MAGIC[4] = { 'T', 'I', 'D', 'X' };
+const unsigned int TRAJECTORY_VERSION = 2;
+
+// version 1 recordings coded their frames with a single rANS state, they can still be read
+const unsigned int TRAJECTORY_SINGLE_STATE_VERSION = 1;
+
+// positions are kept to 1/64 of a pixel and velocities to 1/65536 of a pixel per tick
+const float TRAJECTORY_POSITION_SCALE = 64.0f;
+const float TRAJECTORY_VELOCITY_SCALE = 65536.0f;
+
+// a frame that isn't coded against the one before it is written at least this often, so playback can start from it
+const unsigned int TRAJECTORY_KEYFRAME_INTERVAL = 120;
+
+// One agent on one tick, quantised to integers so the differences between ticks are exact
+struct TrajectorySample {
+    std::uint32_t id;
+    std::uint32_t behavior;
+    std::int32_t positionX;
+    std::int32_t positionY;
+    std::int32_t velocityX;
+    std::int32_t velocityY;
+};
+
+// A recording is this header, the frames one after another, then the keyframe index and the footer. The records are written
+// a field at a time by storeTrajectoryRecord, little endian whatever the machine, and take exactly their sizeof in the file
+struct TrajectoryFileHeader {
+    char magic[4];
+    std::uint32_t version;
+    float positionScale;
+    float velocityScale;
+    std::uint32_t worldWidth;
+    std::uint32_t worldHeight;
+};
+
+enum TrajectoryFrameFlags : std::uint32_t {
+    TRAJECTORY_FRAME_KEYFRAME = 1,  // coded against zero instead of the previous frame
+    TRAJECTORY_FRAME_STORED = 2     // the payload is the varint bytes as they are, entropy coding didn't make them smaller
+};
+
+struct TrajectoryFrameHeader {
+    std::uint32_t tick;
+    std::uint32_t agentCount;
+    std::uint32_t flags;
+    std::uint32_t rawSize;
+    std::uint32_t payloadSize;
+};
+
+struct TrajectoryIndexEntry {
+    std::uint32_t tick;
+    std::uint32_t frame;
+    std::uint64_t offset;
+};
+
+// The last bytes of a finished recording, a recording without one was cut short and can still be read from the front
+struct TrajectoryFooter {
+    std::uint64_t indexOffset;
+    std::uint32_t entryCount;
+    char magic[4];
+};
+
+/***
+ * Function to turn a frame into varint bytes, one column at a time so each column's similar values sit together.
+ * @param samples The frame's samples.
+ * @param previous The previous frame's samples to code against, nullptr for a keyframe, it must have as many samples.
+ * @param count The number of samples.
+ * @param raw Replaced with the coded bytes.
+ ***/
+void encodeTrajectoryFrame(const TrajectorySample* samples, const TrajectorySample* previous, unsigned int count, std::vector<std::uint8_t>& raw);
+
+/***
+ * Function to turn varint bytes back into a frame.
+ * @param raw The coded bytes.
+ * @param size The number of coded bytes.
+ * @param previous The previous frame's samples, nullptr for a keyframe.
+ * @param count The number of samples.
+ * @param samples Where the frame is written, may be the same as previous.
+ * @return False if the bytes are damaged.
+ ***/
+bool decodeTrajectoryFrame(const std::uint8_t* raw, size_t size, const TrajectorySample* previous, unsigned int count, TrajectorySample* samples);
+
+// Copies a record to or from its sizeof(record) bytes in the file
+void storeTrajectoryRecord(std::uint8_t* bytes, const TrajectoryFileHeader& header);
+void storeTrajectoryRecord(std::uint8_t* bytes, const TrajectoryFrameHeader& header);
+void storeTrajectoryRecord(std::uint8_t* bytes, const TrajectoryIndexEntry& entry);
+void storeTrajectoryRecord(std::uint8_t* bytes, const TrajectoryFooter& footer);
+void loadTrajectoryRecord(const std::uint8_t* bytes, TrajectoryFileHeader& header);
+void loadTrajectoryRecord(const std::uint8_t* bytes, TrajectoryFrameHeader& header);
+void loadTrajectoryRecord(const std::uint8_t* bytes, TrajectoryIndexEntry& entry);
+void loadTrajectoryRecord(const std::uint8_t* bytes, TrajectoryFooter& footer);
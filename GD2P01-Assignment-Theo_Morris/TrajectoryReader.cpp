@@ -0,0 +1,194 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : TrajectoryReader.cpp
+Description : Implementation of the TrajectoryReader class, which plays back a memory mapped trajectory recording and seeks through it by its keyframes.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "TrajectoryReader.h"
+#include "Rans.h"
+
+#include <algorithm>
+#include <cstring>
+
+TrajectoryReader::TrajectoryReader()
+{
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+}
+
+bool TrajectoryReader::open(const std::string& path, std::string& error)
+{
+    m_index.clear();
+    m_haveFrame = false;
+
+    if (!m_file.open(path, error)) {
+        return false;
+    }
+
+    if (m_file.size() < sizeof(TrajectoryFileHeader)) {
+        error = "'" + path + "' is not a trajectory recording";
+        m_file.close();
+        return false;
+    }
+    loadTrajectoryRecord(m_file.data(), m_header);
+    if (std::memcmp(m_header.magic, TRAJECTORY_MAGIC, sizeof(m_header.magic)) != 0) {
+        error = "'" + path + "' is not a trajectory recording";
+        m_file.close();
+        return false;
+    }
+    if (m_header.version != TRAJECTORY_VERSION && m_header.version != TRAJECTORY_SINGLE_STATE_VERSION) {
+        error = "'" + path + "' is trajectory version " + std::to_string(m_header.version) + ", expected version " + std::to_string(TRAJECTORY_VERSION);
+        m_file.close();
+        return false;
+    }
+
+    if (!buildIndex() || !seek(0)) {
+        error = "'" + path + "' has no frames that can be read";
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+bool TrajectoryReader::buildIndex()
+{
+    const unsigned char* data = m_file.data();
+    size_t size = m_file.size();
+
+    // A finished recording ends with the footer, which points back at the keyframe index just before it
+    TrajectoryFooter footer;
+    bool haveFooter = false;
+    if (size >= sizeof(TrajectoryFileHeader) + sizeof(TrajectoryFooter)) {
+        loadTrajectoryRecord(data + size - sizeof(footer), footer);
+        haveFooter = std::memcmp(footer.magic, TRAJECTORY_INDEX_MAGIC, sizeof(footer.magic)) == 0
+            && footer.indexOffset >= sizeof(TrajectoryFileHeader)
+            && footer.indexOffset + static_cast<std::uint64_t>(footer.entryCount) * sizeof(TrajectoryIndexEntry) + sizeof(footer) == size;
+    }
+
+    if (haveFooter) {
+        m_framesEnd = static_cast<size_t>(footer.indexOffset);
+        m_index.resize(footer.entryCount);
+        for (size_t i = 0; i < m_index.size(); ++i) {
+            loadTrajectoryRecord(data + m_framesEnd + i * sizeof(TrajectoryIndexEntry), m_index[i]);
+        }
+    }
+    else {
+        // Without a footer the recording stopped early, walk the frame headers up to the last whole frame
+        size_t offset = sizeof(TrajectoryFileHeader);
+        unsigned int frame = 0;
+        TrajectoryFrameHeader header;
+        m_framesEnd = size;
+        while (readFrameHeader(offset, header)) {
+            if (header.flags & TRAJECTORY_FRAME_KEYFRAME) {
+                m_index.push_back({ header.tick, frame, offset });
+            }
+            offset += sizeof(header) + header.payloadSize;
+            frame++;
+        }
+        m_framesEnd = offset;
+    }
+
+    if (m_index.empty()) {
+        return false;
+    }
+
+    // The last tick is found by walking on from the last keyframe, never more than a keyframe interval of headers
+    TrajectoryFrameHeader header;
+    size_t offset = static_cast<size_t>(m_index.back().offset);
+    while (readFrameHeader(offset, header)) {
+        m_lastTick = header.tick;
+        offset += sizeof(header) + header.payloadSize;
+    }
+    m_firstTick = m_index.front().tick;
+    return true;
+}
+
+bool TrajectoryReader::readFrameHeader(size_t offset, TrajectoryFrameHeader& header) const
+{
+    if (offset + sizeof(header) > m_framesEnd) {
+        return false;
+    }
+    loadTrajectoryRecord(m_file.data() + offset, header);
+    return offset + sizeof(header) + header.payloadSize <= m_framesEnd;
+}
+
+bool TrajectoryReader::decodeFrame(size_t offset)
+{
+    TrajectoryFrameHeader header;
+    if (!readFrameHeader(offset, header)) {
+        return false;
+    }
+
+    // A delta frame only makes sense on top of a frame with the same agents
+    bool keyframe = (header.flags & TRAJECTORY_FRAME_KEYFRAME) != 0;
+    if (!keyframe && (!m_haveFrame || m_samples.size() != header.agentCount)) {
+        return false;
+    }
+
+    const std::uint8_t* payload = m_file.data() + offset + sizeof(header);
+    const std::uint8_t* raw = payload;
+    if ((header.flags & TRAJECTORY_FRAME_STORED) == 0) {
+        m_rawBytes.resize(header.rawSize);
+        unsigned int stateCount = m_header.version == TRAJECTORY_SINGLE_STATE_VERSION ? 1 : RANS_INTERLEAVED_STATES;
+        if (!ransDecode(payload, header.payloadSize, m_rawBytes.data(), m_rawBytes.size(), stateCount)) {
+            return false;
+        }
+        raw = m_rawBytes.data();
+    }
+    else if (header.payloadSize != header.rawSize) {
+        return false;
+    }
+
+    m_samples.resize(header.agentCount);
+    if (!decodeTrajectoryFrame(raw, header.rawSize, keyframe ? nullptr : m_samples.data(), header.agentCount, m_samples.data())) {
+        m_haveFrame = false;
+        return false;
+    }
+
+    m_currentTick = header.tick;
+    m_nextOffset = offset + sizeof(header) + header.payloadSize;
+    m_haveFrame = true;
+    return true;
+}
+
+bool TrajectoryReader::seek(unsigned int tick)
+{
+    // The last keyframe at or before the tick, or the first one when the tick is before the recording
+    auto keyframe = std::upper_bound(m_index.begin(), m_index.end(), tick, [](unsigned int value, const TrajectoryIndexEntry& entry) { return value < entry.tick; });
+    if (keyframe != m_index.begin()) {
+        --keyframe;
+    }
+
+    if (!decodeFrame(static_cast<size_t>(keyframe->offset))) {
+        return false;
+    }
+    return decodeForwardTo(tick);
+}
+
+bool TrajectoryReader::advanceTo(unsigned int tick)
+{
+    // Going backwards, or further forwards than a keyframe interval, is quicker from the nearest keyframe
+    if (!m_haveFrame || tick < m_currentTick || tick - m_currentTick > TRAJECTORY_KEYFRAME_INTERVAL) {
+        return seek(tick);
+    }
+    return decodeForwardTo(tick);
+}
+
+bool TrajectoryReader::decodeForwardTo(unsigned int tick)
+{
+    TrajectoryFrameHeader header;
+    while (readFrameHeader(m_nextOffset, header) && header.tick <= tick) {
+        if (!decodeFrame(m_nextOffset)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : TrajectoryReader.h
+Description : Declaration of the TrajectoryReader class, which plays back a memory mapped trajectory recording and seeks through it by its keyframes.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "Trajectory.h"
+
+#include <SFML/System/Vector2.hpp>
+
+// Decodes one frame at a time from a mapped recording. Seeking starts from the nearest keyframe at or before the tick,
+// so it never decodes more than TRAJECTORY_KEYFRAME_INTERVAL frames however long the recording is
+class TrajectoryReader
+{
+private:
+    MappedFile m_file;
+    TrajectoryFileHeader m_header = {};
+
+    // the keyframes from the footer, or found by reading the frame headers when the recording was cut short
+    std::vector<TrajectoryIndexEntry> m_index;
+    size_t m_framesEnd = 0;
+    unsigned int m_firstTick = 0;
+    unsigned int m_lastTick = 0;
+
+    // the decoded frame and where the one after it starts
+    std::vector<TrajectorySample> m_samples;
+    std::vector<std::uint8_t> m_rawBytes;
+    size_t m_nextOffset = 0;
+    unsigned int m_currentTick = 0;
+    bool m_haveFrame = false;
+
+    bool readFrameHeader(size_t offset, TrajectoryFrameHeader& header) const;
+    bool decodeFrame(size_t offset);
+    bool decodeForwardTo(unsigned int tick);
+    bool buildIndex();
+
+public:
+    TrajectoryReader();
+    ~TrajectoryReader();
+
+    /***
+     * Function to map a recording and read its keyframe index, the first frame is decoded straight away.
+     * @param path The recording to open.
+     * @param error Set to what went wrong when the recording can't be played.
+     * @return True if the recording was opened.
+     ***/
+    bool open(const std::string& path, std::string& error);
+
+    /***
+     * Function to move to the last frame at or before a tick, or the first frame for a tick before the recording starts.
+     * @param tick The tick to move to.
+     * @return False if a frame on the way was damaged.
+     ***/
+    bool seek(unsigned int tick);
+
+    /***
+     * Function to decode forwards to the last frame at or before a tick, seeking instead if the tick is behind the current frame or far ahead of it.
+     * @param tick The tick to move to.
+     * @return False if a frame on the way was damaged.
+     ***/
+    bool advanceTo(unsigned int tick);
+
+    unsigned int getCurrentTick() const { return m_currentTick; }
+    unsigned int getFirstTick() const { return m_firstTick; }
+    unsigned int getLastTick() const { return m_lastTick; }
+    unsigned int getKeyframeCount() const { return static_cast<unsigned int>(m_index.size()); }
+
+    sf::Vector2u getWorldSize() const { return sf::Vector2u(m_header.worldWidth, m_header.worldHeight); }
+    float getPositionScale() const { return m_header.positionScale; }
+    float getVelocityScale() const { return m_header.velocityScale; }
+
+    const std::vector<TrajectorySample>& getSamples() const { return m_samples; }
+};
@@ -0,0 +1,214 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : TrajectoryRecorder.cpp
+Description : Implementation of the TrajectoryRecorder class, which streams every tick's agent states to a compressed recording from a background thread.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "TrajectoryRecorder.h"
+#include "Rans.h"
+
+#include <cstring>
+#include <iostream>
+
+TrajectoryRecorder::TrajectoryRecorder()
+{
+}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+    stop();
+}
+
+bool TrajectoryRecorder::start(const std::string& path, const sf::Vector2u& worldSize, std::string& error)
+{
+    stop();
+
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file) {
+        error = "Failed to open '" + path + "'";
+        return false;
+    }
+    m_path = path;
+
+    TrajectoryFileHeader header;
+    std::memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+    header.version = TRAJECTORY_VERSION;
+    header.positionScale = TRAJECTORY_POSITION_SCALE;
+    header.velocityScale = TRAJECTORY_VELOCITY_SCALE;
+    header.worldWidth = worldSize.x;
+    header.worldHeight = worldSize.y;
+
+    m_havePrevious = false;
+    m_framesSinceKeyframe = 0;
+    m_index.clear();
+    m_framesWritten = 0;
+    m_framesDropped = 0;
+    m_sampleBytes = 0;
+    m_writtenBytes = 0;
+    m_fileOffset = 0;
+    std::uint8_t headerBytes[sizeof(header)];
+    storeTrajectoryRecord(headerBytes, header);
+    writeBytes(headerBytes, sizeof(headerBytes));
+
+    // Every slot starts out free, the queues are empty whenever nothing is recording
+    for (unsigned int i = 0; i < TRAJECTORY_RING_SIZE; ++i) {
+        m_freeSlots.push(i);
+    }
+
+    m_running = true;
+    m_thread = std::thread(&TrajectoryRecorder::writerLoop, this);
+    return true;
+}
+
+void TrajectoryRecorder::stop()
+{
+    if (!m_running) {
+        return;
+    }
+
+    m_running = false;
+    m_filledSignal++;
+    m_filledSignal.notify_one();
+    m_thread.join();
+
+    // The index goes after the last frame and the footer points back at it
+    TrajectoryFooter footer;
+    footer.indexOffset = m_fileOffset;
+    footer.entryCount = static_cast<std::uint32_t>(m_index.size());
+    std::memcpy(footer.magic, TRAJECTORY_INDEX_MAGIC, sizeof(footer.magic));
+    std::vector<std::uint8_t> indexBytes(m_index.size() * sizeof(TrajectoryIndexEntry) + sizeof(footer));
+    for (size_t i = 0; i < m_index.size(); ++i) {
+        storeTrajectoryRecord(indexBytes.data() + i * sizeof(TrajectoryIndexEntry), m_index[i]);
+    }
+    storeTrajectoryRecord(indexBytes.data() + m_index.size() * sizeof(TrajectoryIndexEntry), footer);
+    writeBytes(indexBytes.data(), indexBytes.size());
+    m_file.close();
+
+    // Hand every slot back so the queues are empty for the next recording
+    unsigned int slot;
+    while (m_freeSlots.pop(slot)) {
+    }
+
+    TrajectoryRecorderStats stats = getStats();
+    std::cout << "Recording saved to " << m_path << ": " << stats.framesWritten << " frames, " << stats.framesDropped << " dropped, "
+        << stats.writtenBytes << " bytes from " << stats.sampleBytes << " bytes of samples" << std::endl;
+}
+
+TrajectorySample* TrajectoryRecorder::beginFrame(unsigned int tick, unsigned int agentCount)
+{
+    if (!m_freeSlots.pop(m_captureSlot)) {
+        m_framesDropped++;
+        return nullptr;
+    }
+
+    Slot& slot = m_slots[m_captureSlot];
+    slot.tick = tick;
+    slot.samples.resize(agentCount);
+    return slot.samples.data();
+}
+
+void TrajectoryRecorder::endFrame()
+{
+    m_filledSlots.push(m_captureSlot);
+    m_filledSignal++;
+    m_filledSignal.notify_one();
+}
+
+TrajectoryRecorderStats TrajectoryRecorder::getStats() const
+{
+    TrajectoryRecorderStats stats;
+    stats.framesWritten = m_framesWritten;
+    stats.framesDropped = m_framesDropped;
+    stats.sampleBytes = m_sampleBytes;
+    stats.writtenBytes = m_writtenBytes;
+    return stats;
+}
+
+void TrajectoryRecorder::writerLoop()
+{
+    while (true) {
+        // Read the signal before looking in the queue, a slot filled after that changes it and wait returns straight away
+        unsigned int signal = m_filledSignal.load();
+
+        unsigned int slot;
+        bool wroteAny = false;
+        while (m_filledSlots.pop(slot)) {
+            writeFrame(m_slots[slot]);
+            m_freeSlots.push(slot);
+            wroteAny = true;
+        }
+
+        if (!m_running) {
+            // One last pass picks up anything filled while the stop was on its way
+            while (m_filledSlots.pop(slot)) {
+                writeFrame(m_slots[slot]);
+                m_freeSlots.push(slot);
+            }
+            m_file.flush();
+            return;
+        }
+
+        if (!wroteAny) {
+            m_filledSignal.wait(signal);
+        }
+    }
+}
+
+void TrajectoryRecorder::writeFrame(const Slot& slot)
+{
+    unsigned int count = static_cast<unsigned int>(slot.samples.size());
+
+    // Agents only line up with the previous frame when none have been added or removed, a despawn and a spawn
+    // on the same tick keep the count the same so the ids are compared as well
+    bool keyframe = !m_havePrevious || m_previousSamples.size() != count || m_framesSinceKeyframe >= TRAJECTORY_KEYFRAME_INTERVAL;
+    for (unsigned int i = 0; i < count && !keyframe; ++i) {
+        keyframe = slot.samples[i].id != m_previousSamples[i].id;
+    }
+    encodeTrajectoryFrame(slot.samples.data(), keyframe ? nullptr : m_previousSamples.data(), count, m_rawBytes);
+
+    TrajectoryFrameHeader header;
+    header.tick = slot.tick;
+    header.agentCount = count;
+    header.flags = 0;
+    if (keyframe) {
+        header.flags |= TRAJECTORY_FRAME_KEYFRAME;
+    }
+    header.rawSize = static_cast<std::uint32_t>(m_rawBytes.size());
+
+    const std::vector<std::uint8_t>* payload = &m_codedBytes;
+    if (!ransEncode(m_rawBytes.data(), m_rawBytes.size(), m_codedBytes)) {
+        header.flags |= TRAJECTORY_FRAME_STORED;
+        payload = &m_rawBytes;
+    }
+    header.payloadSize = static_cast<std::uint32_t>(payload->size());
+
+    if (keyframe) {
+        m_index.push_back({ slot.tick, m_framesWritten.load(), m_fileOffset });
+        m_framesSinceKeyframe = 0;
+    }
+    m_framesSinceKeyframe++;
+
+    std::uint8_t headerBytes[sizeof(header)];
+    storeTrajectoryRecord(headerBytes, header);
+    writeBytes(headerBytes, sizeof(headerBytes));
+    writeBytes(payload->data(), payload->size());
+
+    m_previousSamples = slot.samples;
+    m_havePrevious = true;
+
+    m_framesWritten++;
+    m_sampleBytes += count * sizeof(TrajectorySample);
+}
+
+void TrajectoryRecorder::writeBytes(const void* data, size_t size)
+{
+    m_file.write(static_cast<const char*>(data), size);
+    m_fileOffset += size;
+    m_writtenBytes += size;
+}
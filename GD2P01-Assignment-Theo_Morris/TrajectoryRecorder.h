@@ -0,0 +1,112 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : TrajectoryRecorder.h
+Description : Declaration of the TrajectoryRecorder class, which streams every tick's agent states to a compressed recording from a background thread.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CommandQueue.h"
+#include "Trajectory.h"
+
+#include <SFML/System/Vector2.hpp>
+
+// where R records to
+const char* const TRAJECTORY_PATH = "trajectory.rec";
+
+// frames that can be waiting for the writer, once they are all full new frames are dropped
+const size_t TRAJECTORY_RING_SIZE = 8;
+
+struct TrajectoryRecorderStats {
+    unsigned int framesWritten = 0;
+    unsigned int framesDropped = 0;
+    unsigned long long sampleBytes = 0;     // size of the quantised samples before any coding
+    unsigned long long writtenBytes = 0;
+};
+
+// The simulation thread quantises each tick into a free slot of a ring and the writer thread codes and writes it.
+// Slots go round between two queues, so neither thread ever waits on the other and a full ring drops the frame
+class TrajectoryRecorder
+{
+private:
+    struct Slot {
+        unsigned int tick = 0;
+        std::vector<TrajectorySample> samples;
+    };
+
+    std::array<Slot, TRAJECTORY_RING_SIZE> m_slots;
+    CommandQueue<unsigned int, TRAJECTORY_RING_SIZE> m_freeSlots;
+    CommandQueue<unsigned int, TRAJECTORY_RING_SIZE> m_filledSlots;
+
+    // bumped whenever a slot is filled, the writer sleeps on it when there is nothing to write
+    std::atomic<unsigned int> m_filledSignal = 0;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running = false;
+    unsigned int m_captureSlot = 0;
+
+    std::atomic<unsigned int> m_framesWritten = 0;
+    std::atomic<unsigned int> m_framesDropped = 0;
+    std::atomic<unsigned long long> m_sampleBytes = 0;
+    std::atomic<unsigned long long> m_writtenBytes = 0;
+
+    // only touched by the writer thread while recording
+    std::string m_path;
+    std::ofstream m_file;
+    unsigned long long m_fileOffset = 0;
+    std::vector<TrajectorySample> m_previousSamples;
+    bool m_havePrevious = false;
+    unsigned int m_framesSinceKeyframe = 0;
+    std::vector<std::uint8_t> m_rawBytes;
+    std::vector<std::uint8_t> m_codedBytes;
+    std::vector<TrajectoryIndexEntry> m_index;
+
+    void writerLoop();
+    void writeFrame(const Slot& slot);
+    void writeBytes(const void* data, size_t size);
+
+public:
+    TrajectoryRecorder();
+
+    // Stops and finishes the recording if there is one
+    ~TrajectoryRecorder();
+
+    /***
+     * Function to start recording, the file header is written straight away.
+     * @param path The file to record to.
+     * @param worldSize The size of the world, kept in the header for playback.
+     * @param error Set to what went wrong when the file can't be written.
+     * @return True if recording started.
+     ***/
+    bool start(const std::string& path, const sf::Vector2u& worldSize, std::string& error);
+
+    // Writes whatever frames are left, then the keyframe index and footer
+    void stop();
+
+    bool isRecording() const { return m_running; }
+
+    /***
+     * Function to claim a slot for a tick, only called from the simulation thread.
+     * @param tick The tick the frame is for.
+     * @param agentCount How many samples the frame has.
+     * @return Where to write the samples, nullptr if the ring is full and this frame is dropped.
+     ***/
+    TrajectorySample* beginFrame(unsigned int tick, unsigned int agentCount);
+
+    // Hands the slot from beginFrame to the writer
+    void endFrame();
+
+    TrajectoryRecorderStats getStats() const;
+};
@@ -0,0 +1,68 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : TripleBuffer.h
+Description : Declaration of the TripleBuffer class, which hands the latest value from one producer thread to one consumer thread without either side waiting.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <atomic>
+
+template <typename T>
+class TripleBuffer
+{
+private:
+    static const unsigned int INDEX_MASK = 0x3;
+    static const unsigned int NEW_DATA_BIT = 0x4;
+
+    T m_buffers[3];
+
+    // the buffer between the producer and consumer, with NEW_DATA_BIT set when it holds a value not yet acquired
+    std::atomic<unsigned int> m_middle{ 2 };
+
+    // only ever touched by the producer
+    unsigned int m_back = 0;
+
+    // only ever touched by the consumer
+    unsigned int m_front = 1;
+
+public:
+    // Producer side, the buffer to write the next value into
+    T& back() { return m_buffers[m_back]; }
+
+    // Producer side, true once the consumer has acquired the last published value, so a new one would actually be seen
+    bool consumed() const { return (m_middle.load(std::memory_order_relaxed) & NEW_DATA_BIT) == 0; }
+
+    /***
+     * Producer side, swaps the finished back buffer into the middle so the consumer can pick it up.
+     * @return True if the value it replaced was never acquired by the consumer.
+     ***/
+    bool publish()
+    {
+        unsigned int previous = m_middle.exchange(m_back | NEW_DATA_BIT, std::memory_order_acq_rel);
+        m_back = previous & INDEX_MASK;
+        return (previous & NEW_DATA_BIT) != 0;
+    }
+
+    /***
+     * Consumer side, swaps in the most recently published value if there is one.
+     * @return True if front() now holds a newer value.
+     ***/
+    bool acquire()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & NEW_DATA_BIT) == 0) {
+            return false;
+        }
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    // Consumer side, the most recently acquired value
+    const T& front() const { return m_buffers[m_front]; }
+};
@@ -0,0 +1,62 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : VarInt.h
+Description : Variable length integer helpers, small values take fewer bytes and signed values are zigzagged first so small negatives stay small too.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Maps 0, -1, 1, -2, 2... to 0, 1, 2, 3, 4...
+inline std::uint32_t zigzagEncode(std::int32_t value)
+{
+    return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+}
+
+inline std::int32_t zigzagDecode(std::uint32_t value)
+{
+    return static_cast<std::int32_t>(value >> 1) ^ -static_cast<std::int32_t>(value & 1);
+}
+
+// Seven bits per byte, the top bit set on every byte but the last
+inline void appendVarInt(std::vector<std::uint8_t>& buffer, std::uint32_t value)
+{
+    while (value >= 0x80) {
+        buffer.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<std::uint8_t>(value));
+}
+
+/***
+ * Function to read a variable length integer.
+ * @param data The bytes to read from.
+ * @param size How many bytes there are.
+ * @param position Where to start, moved past the integer.
+ * @param value Receives the integer.
+ * @return False if the bytes ran out or the integer was too long.
+ ***/
+inline bool readVarInt(const std::uint8_t* data, size_t size, size_t& position, std::uint32_t& value)
+{
+    value = 0;
+    for (unsigned int shift = 0; shift < 35; shift += 7) {
+        if (position >= size) {
+            return false;
+        }
+        std::uint8_t byte = data[position++];
+        value |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
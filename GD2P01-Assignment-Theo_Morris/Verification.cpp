@@ -0,0 +1,241 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : Verification.cpp
+Description : Implementation of the differential check run from the command line with --verify, the simulation stepped side by side with the reference steering model.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "Verification.h"
+#include "Game.h"
+#include "Random.h"
+#include "ReferenceAgent.h"
+#include "Scenario.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+
+namespace
+{
+    const unsigned int VERIFY_SCENARIO_COUNT = 4;
+    const sf::Vector2u VERIFY_WORLD_SIZE(1000, 1000);
+
+    // how often the generated scenarios move the target
+    const unsigned int VERIFY_TARGET_INTERVAL = 150;
+
+    // How far one behaviour's agents ended up from the reference
+    struct BehaviorDivergence {
+        unsigned int agents = 0;
+        unsigned int exactAgents = 0;       // bit for bit the same as the reference on the last tick
+        double finalErrorSum = 0.0;
+        float maxPositionError = 0.0f;
+        float maxVelocityError = 0.0f;
+        bool drifted = false;
+        unsigned int driftTick = 0;         // the first tick an agent was further than the tolerance from the reference
+    };
+
+    // Every behaviour in groups of random size and spread, with a few obstacles and a target that moves every so often
+    Scenario generateScenario(unsigned int seed, unsigned int ticks)
+    {
+        unsigned int draw = 0;
+        auto random = [&]() { return agentRandom(seed, 0, 0, RandomStream::Placement, draw++); };
+        auto randomPosition = [&](float margin) {
+            float x = margin + random() * (VERIFY_WORLD_SIZE.x - 2.0f * margin);
+            float y = margin + random() * (VERIFY_WORLD_SIZE.y - 2.0f * margin);
+            return sf::Vector2f(x, y);
+        };
+
+        Scenario scenario;
+        scenario.worldSize = VERIFY_WORLD_SIZE;
+        scenario.seed = seed;
+
+        unsigned int obstacleCount = 2 + static_cast<unsigned int>(random() * 4.0f);
+        for (unsigned int i = 0; i < obstacleCount; ++i) {
+            sf::Vector2f center = randomPosition(100.0f);
+            scenario.obstacles.push_back({ center, 30.0f + random() * 50.0f });
+        }
+
+        for (int behavior = 0; behavior < MOVEMENT_BEHAVIOR_COUNT; ++behavior) {
+            ScenarioSpawn spawn;
+            spawn.behavior = static_cast<MovementBehavior>(behavior);
+            spawn.count = 5 + static_cast<unsigned int>(random() * 36.0f);
+            spawn.position = randomPosition(150.0f);
+            spawn.spread = 40.0f + random() * 160.0f;
+            spawn.seed = seed * MOVEMENT_BEHAVIOR_COUNT + behavior;
+            scenario.spawns.push_back(spawn);
+        }
+
+        for (unsigned int tick = 0; tick < ticks; tick += VERIFY_TARGET_INTERVAL) {
+            sf::Vector2f position = randomPosition(50.0f);
+            scenario.targets.push_back({ tick, sf::Vector2i(static_cast<int>(position.x), static_cast<int>(position.y)) });
+        }
+        return scenario;
+    }
+
+    // Distance the short way round, an agent that wrapped a tick before the reference's copy is still only a little apart
+    float wrappedDistance(sf::Vector2f a, sf::Vector2f b, const sf::Vector2u& worldSize)
+    {
+        float dx = std::fabs(a.x - b.x);
+        float dy = std::fabs(a.y - b.y);
+        dx = std::min(dx, worldSize.x - dx);
+        dy = std::min(dy, worldSize.y - dy);
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+    bool sameBits(sf::Vector2f a, sf::Vector2f b)
+    {
+        return std::bit_cast<std::uint64_t>(a) == std::bit_cast<std::uint64_t>(b);
+    }
+
+    // The settings each engine option switches on, all of them are off in a new game
+    bool findEngineOption(const std::string& name, std::function<void(Game&)>& apply)
+    {
+        if (name == "fastmath") {
+            apply = [](Game& game) { game.toggleFastMath(); };
+        }
+        else if (name == "timeslicing") {
+            apply = [](Game& game) { game.toggleTimeSlicing(); };
+        }
+        else if (name == "lod") {
+            apply = [](Game& game) { game.toggleLevelOfDetail(); };
+        }
+        else if (name == "chains") {
+            apply = [](Game& game) { game.toggleChainOrdering(); };
+        }
+        else if (name == "prioritized") {
+            apply = [](Game& game) { game.toggleForceAccumulation(); };
+        }
+        else {
+            return false;
+        }
+        return true;
+    }
+
+    /***
+     * Runs one scenario through both and prints how far each behaviour drifted.
+     * @return False if any agent drifted past the tolerance or the two disagree on which agents there are.
+     ***/
+    bool verifyScenario(unsigned int index, const Scenario& scenario, unsigned int ticks, float tolerance, const std::vector<std::function<void(Game&)>>& engineOptions, std::ostream& output)
+    {
+        GameOptions options;
+        options.headless = true;
+        options.scenario = &scenario;
+        Game game(options);
+        for (const std::function<void(Game&)>& apply : engineOptions) {
+            apply(game);
+        }
+
+        // Both start from exactly the same agents, including their spawn headings
+        std::vector<AgentState> states;
+        game.getAgentStates(states);
+        ReferenceSimulation reference(scenario, states);
+
+        std::array<BehaviorDivergence, MOVEMENT_BEHAVIOR_COUNT> divergence = {};
+        for (const AgentState& state : states) {
+            divergence[state.behavior].agents++;
+        }
+
+        for (unsigned int tick = 0; tick < ticks; ++tick) {
+            game.stepHeadless();
+            reference.step(FIXED_TIMESTEP);
+            game.getAgentStates(states);
+
+            const std::vector<ReferenceAgent>& referenceAgents = reference.getAgents();
+            if (states.size() != referenceAgents.size()) {
+                output << "Scenario " << index << ": the simulation has " << states.size() << " agents and the reference " << referenceAgents.size() << " at tick " << game.getSimulationTick() << "\n";
+                return false;
+            }
+
+            bool lastTick = tick + 1 == ticks;
+            for (size_t i = 0; i < states.size(); ++i) {
+                const AgentState& state = states[i];
+                const ReferenceAgent& expected = referenceAgents[i];
+                if (state.id != expected.getId()) {
+                    output << "Scenario " << index << ": agent " << i << " is id " << state.id << " in the simulation and " << expected.getId() << " in the reference\n";
+                    return false;
+                }
+
+                sf::Vector2f position(state.positionX, state.positionY);
+                sf::Vector2f velocity(state.velocityX, state.velocityY);
+                float positionError = wrappedDistance(position, expected.getPosition(), scenario.worldSize);
+                float velocityError = vectorDistance(velocity, expected.getVelocity());
+
+                BehaviorDivergence& behavior = divergence[state.behavior];
+                behavior.maxPositionError = std::max(behavior.maxPositionError, positionError);
+                behavior.maxVelocityError = std::max(behavior.maxVelocityError, velocityError);
+                if (positionError > tolerance && !behavior.drifted) {
+                    behavior.drifted = true;
+                    behavior.driftTick = game.getSimulationTick();
+                }
+
+                if (lastTick) {
+                    behavior.finalErrorSum += positionError;
+                    if (sameBits(position, expected.getPosition()) && sameBits(velocity, expected.getVelocity())) {
+                        behavior.exactAgents++;
+                    }
+                }
+            }
+        }
+
+        output << "Scenario " << index << ": " << states.size() << " agents, " << scenario.obstacles.size() << " obstacles, " << ticks << " ticks\n";
+        output << "  behaviour      agents  exact   mean px    max px  max vel  drift tick\n";
+
+        bool passed = true;
+        for (int i = 0; i < MOVEMENT_BEHAVIOR_COUNT; ++i) {
+            const BehaviorDivergence& behavior = divergence[i];
+            if (behavior.agents == 0) {
+                continue;
+            }
+
+            char driftTick[16] = "-";
+            if (behavior.drifted) {
+                std::snprintf(driftTick, sizeof(driftTick), "%u", behavior.driftTick);
+                passed = false;
+            }
+
+            char line[128];
+            std::snprintf(line, sizeof(line), "  %-13s %7u %6u %9.3g %9.3g %8.3g  %s\n", movementBehaviorName(static_cast<MovementBehavior>(i)), behavior.agents, behavior.exactAgents, behavior.finalErrorSum / behavior.agents, behavior.maxPositionError, behavior.maxVelocityError, driftTick);
+            output << line;
+        }
+        return passed;
+    }
+}
+
+int runVerification(unsigned int ticks, float tolerance, const std::vector<std::string>& engineOptions, std::ostream& output)
+{
+    std::vector<std::function<void(Game&)>> options;
+    for (const std::string& name : engineOptions) {
+        std::function<void(Game&)> apply;
+        if (!findEngineOption(name, apply)) {
+            std::cerr << "Unknown engine option '" << name << "', expected fastmath, timeslicing, lod, chains or prioritized" << std::endl;
+            return 1;
+        }
+        options.push_back(apply);
+    }
+
+    output << "Checking the simulation against the reference steering model, tolerance " << tolerance << "px over " << ticks << " ticks\n";
+
+    unsigned int failed = 0;
+    for (unsigned int i = 1; i <= VERIFY_SCENARIO_COUNT; ++i) {
+        Scenario scenario = generateScenario(i, ticks);
+        if (!verifyScenario(i, scenario, ticks, tolerance, options, output)) {
+            failed++;
+        }
+    }
+
+    if (failed > 0) {
+        output << "Verification FAILED: " << failed << " of " << VERIFY_SCENARIO_COUNT << " scenarios drifted further than " << tolerance << "px from the reference" << std::endl;
+        return 1;
+    }
+    output << "Verification passed: every agent stayed within " << tolerance << "px of the reference" << std::endl;
+    return 0;
+}
@@ -0,0 +1,33 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : Verification.h
+Description : Declaration of the differential check run from the command line with --verify, the simulation stepped side by side with the reference steering model.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// how long each generated scenario runs and how far an agent may drift from the reference, in pixels, by default.
+// The grid adds up neighbours in a different order to the reference, and those last bit differences grow over a few
+// hundred ticks of flocking and fleeing, so longer runs need a looser tolerance
+const unsigned int DEFAULT_VERIFY_TICKS = 120;
+const float DEFAULT_VERIFY_TOLERANCE = 0.5f;
+
+/***
+ * Function to run the simulation and the reference model on the same generated scenarios and compare every agent after every tick.
+ * @param ticks How many ticks each scenario runs.
+ * @param tolerance The furthest, in pixels, any agent's position may be from the reference's.
+ * @param engineOptions Settings switched on in the simulation first: "fastmath", "timeslicing", "lod", "chains" or "prioritized".
+ * @param output Where the divergence of each behaviour is printed.
+ * @return The exit code for the program, non zero if an agent drifted past the tolerance or an option doesn't exist.
+ ***/
+int runVerification(unsigned int ticks, float tolerance, const std::vector<std::string>& engineOptions, std::ostream& output);
@@ -0,0 +1,111 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : WorldSnapshot.cpp
+Description : Implementation of the world snapshot files, the whole state of a running simulation saved with one write and restored from a memory mapping.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#include "WorldSnapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+size_t worldSnapshotSize(unsigned int agentCount, unsigned int obstacleCount)
+{
+    return sizeof(WorldSnapshotHeader) + static_cast<size_t>(agentCount) * sizeof(AgentState) + static_cast<size_t>(obstacleCount) * sizeof(WorldSnapshotObstacle);
+}
+
+WorldSnapshotBuffer::WorldSnapshotBuffer()
+{
+}
+
+WorldSnapshotBuffer::~WorldSnapshotBuffer()
+{
+}
+
+void WorldSnapshotBuffer::reset(const WorldSnapshotHeader& header)
+{
+    WorldSnapshotHeader filledHeader = header;
+    std::memcpy(filledHeader.magic, WORLD_SNAPSHOT_MAGIC, sizeof(filledHeader.magic));
+    filledHeader.version = WORLD_SNAPSHOT_VERSION;
+    filledHeader.agentRecordSize = sizeof(AgentState);
+    filledHeader.obstacleRecordSize = sizeof(WorldSnapshotObstacle);
+    filledHeader.reserved = 0;
+
+    // Only grows, so a buffer kept between saves stops allocating once it is big enough
+    m_buffer.resize(worldSnapshotSize(header.agentCount, header.obstacleCount));
+    std::memcpy(m_buffer.data(), &filledHeader, sizeof(filledHeader));
+}
+
+bool WorldSnapshotBuffer::write(const std::string& path, std::string& error) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file || !file.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size())) {
+        error = "Failed to write '" + path + "'";
+        return false;
+    }
+    return true;
+}
+
+MappedWorldSnapshot::MappedWorldSnapshot()
+{
+}
+
+MappedWorldSnapshot::~MappedWorldSnapshot()
+{
+}
+
+bool MappedWorldSnapshot::open(const std::string& path, std::string& error)
+{
+    if (!m_file.open(path, error)) {
+        return false;
+    }
+
+    if (m_file.size() < sizeof(WorldSnapshotHeader) || std::memcmp(header().magic, WORLD_SNAPSHOT_MAGIC, sizeof(WORLD_SNAPSHOT_MAGIC)) != 0) {
+        error = "'" + path + "' is not a world snapshot";
+        m_file.close();
+        return false;
+    }
+
+    const WorldSnapshotHeader& snapshotHeader = header();
+    if (snapshotHeader.version != WORLD_SNAPSHOT_VERSION || snapshotHeader.agentRecordSize != sizeof(AgentState) || snapshotHeader.obstacleRecordSize != sizeof(WorldSnapshotObstacle)) {
+        error = "'" + path + "' is world snapshot version " + std::to_string(snapshotHeader.version) + ", expected version " + std::to_string(WORLD_SNAPSHOT_VERSION);
+        m_file.close();
+        return false;
+    }
+
+    if (m_file.size() != worldSnapshotSize(snapshotHeader.agentCount, snapshotHeader.obstacleCount)) {
+        error = "'" + path + "' is the wrong size for its agent and obstacle counts";
+        m_file.close();
+        return false;
+    }
+
+    // Followed agents always come first, so the links can be restored in one pass and never form a loop.
+    // Ids index a table sized by nextAgentId when the world is saved again, so they have to be below it
+    const AgentState* states = agents();
+    for (unsigned int i = 0; i < snapshotHeader.agentCount; ++i) {
+        if (states[i].behavior >= MOVEMENT_BEHAVIOR_COUNT || states[i].followIndex < -1 || states[i].followIndex >= static_cast<std::int32_t>(i) || states[i].id >= snapshotHeader.nextAgentId) {
+            error = "'" + path + "' has an invalid agent at index " + std::to_string(i);
+            m_file.close();
+            return false;
+        }
+    }
+
+    std::vector<std::uint32_t> ids(snapshotHeader.agentCount);
+    for (unsigned int i = 0; i < snapshotHeader.agentCount; ++i) {
+        ids[i] = states[i].id;
+    }
+    std::sort(ids.begin(), ids.end());
+    if (std::adjacent_find(ids.begin(), ids.end()) != ids.end()) {
+        error = "'" + path + "' has more than one agent with the same id";
+        m_file.close();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,113 @@
+/***
+Bachelor of Software Engineering
+Media Design School
+Auckland
+New Zealand
+(c) 2024 Media Design School
+File Name : WorldSnapshot.h
+Description : Declaration of the world snapshot files, the whole state of a running simulation saved with one write and restored from a memory mapping.
+Author : Theo Morris
+Mail : theo.morris@mds.ac.nz
+**/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "Agent.h"
+#include "MappedFile.h"
+
+// first bytes of a world snapshot
+const char WORLD_SNAPSHOT_MAGIC[4] = { 'B', 'W', 'S', 'N' };
+const unsigned int WORLD_SNAPSHOT_VERSION = 1;
+
+// where F5 saves the world and F9 loads it from
+const char* const WORLD_SNAPSHOT_PATH = "world.snapshot";
+
+// A snapshot is this header followed by the agent records and then the obstacle records, all little endian
+struct WorldSnapshotHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t agentRecordSize;
+    std::uint32_t obstacleRecordSize;
+    std::uint32_t agentCount;
+    std::uint32_t obstacleCount;
+    std::uint32_t worldWidth;
+    std::uint32_t worldHeight;
+    std::uint32_t seed;
+    std::uint32_t tick;
+    std::uint32_t nextAgentId;
+    std::int32_t targetX;
+    std::int32_t targetY;
+    std::uint32_t reserved;
+};
+
+struct WorldSnapshotObstacle {
+    float x;
+    float y;
+    float radius;
+};
+
+static_assert(std::is_trivially_copyable_v<AgentState> && std::is_standard_layout_v<AgentState>, "Agent records are read in place from the file");
+static_assert(sizeof(WorldSnapshotHeader) % alignof(AgentState) == 0, "Agent records must stay aligned after the header");
+
+/***
+ * Function to work out how big a snapshot is.
+ * @param agentCount The number of agents.
+ * @param obstacleCount The number of obstacles.
+ * @return The size of the file in bytes.
+ ***/
+size_t worldSnapshotSize(unsigned int agentCount, unsigned int obstacleCount);
+
+// A snapshot built in memory, the records are filled in place and the whole buffer is written with one call
+class WorldSnapshotBuffer
+{
+private:
+    std::vector<unsigned char> m_buffer;
+
+public:
+    WorldSnapshotBuffer();
+    ~WorldSnapshotBuffer();
+
+    // Sizes the buffer for the counts in the header and copies the header to the front, the magic and versions are filled in here
+    void reset(const WorldSnapshotHeader& header);
+
+    const WorldSnapshotHeader& header() const { return *reinterpret_cast<const WorldSnapshotHeader*>(m_buffer.data()); }
+    AgentState* agents() { return reinterpret_cast<AgentState*>(m_buffer.data() + sizeof(WorldSnapshotHeader)); }
+    WorldSnapshotObstacle* obstacles() { return reinterpret_cast<WorldSnapshotObstacle*>(m_buffer.data() + sizeof(WorldSnapshotHeader) + header().agentCount * sizeof(AgentState)); }
+
+    size_t size() const { return m_buffer.size(); }
+
+    /***
+     * Function to write the snapshot to a file with a single write.
+     * @param path The file to write.
+     * @param error Set to what went wrong when writing fails.
+     * @return True if the snapshot was written.
+     ***/
+    bool write(const std::string& path, std::string& error) const;
+};
+
+// A snapshot file mapped into memory, the records are read from the mapping without being copied
+class MappedWorldSnapshot
+{
+private:
+    MappedFile m_file;
+
+public:
+    MappedWorldSnapshot();
+    ~MappedWorldSnapshot();
+
+    /***
+     * Function to map a snapshot and check it can be restored, the header, sizes, behaviours and follow links are all checked.
+     * @param path The file to map.
+     * @param error Set to what went wrong when the snapshot can't be used.
+     * @return True if the snapshot was mapped and is valid.
+     ***/
+    bool open(const std::string& path, std::string& error);
+
+    const WorldSnapshotHeader& header() const { return *reinterpret_cast<const WorldSnapshotHeader*>(m_file.data()); }
+    const AgentState* agents() const { return reinterpret_cast<const AgentState*>(m_file.data() + sizeof(WorldSnapshotHeader)); }
+    const WorldSnapshotObstacle* obstacles() const { return reinterpret_cast<const WorldSnapshotObstacle*>(m_file.data() + sizeof(WorldSnapshotHeader) + header().agentCount * sizeof(AgentState)); }
+};
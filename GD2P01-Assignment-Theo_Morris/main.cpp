@@ -10,13 +10,157 @@ Author : Theo Morris
 Mail : theo.morris@mds.ac.nz
 **/
 
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <vector>
 
+#include "Benchmark.h"
 #include "Game.h"
+#include "Scenario.h"
+#include "Telemetry.h"
+#include "TrajectoryReader.h"
+#include "Verification.h"
 
-int main() 
+const unsigned int DEFAULT_HEADLESS_TICKS = 10000;
+
+/***
+ * Function to read a whole command line argument as a number.
+ * @param text The argument.
+ * @param value Set to the number if the argument is one.
+ * @return False if any of the argument isn't part of the number.
+ ***/
+template <typename T>
+bool parseArgument(const char* text, T& value)
+{
+    const char* end = text + std::strlen(text);
+    std::from_chars_result result = std::from_chars(text, end, value);
+    return text != end && result.ec == std::errc() && result.ptr == end;
+}
+
+// Prints every mode the program can be started in
+void printUsage(std::ostream& output)
+{
+    output << "Usage:\n";
+    output << "  --scenario <file>\n";
+    output << "  --headless <file> [ticks] [recording]\n";
+    output << "  --replay <recording>\n";
+    output << "  --convert-scenario <input> <output>\n";
+    output << "  --verify [ticks] [tolerance] [engine options...]\n";
+    output << "  --telemetry-reader [seconds]\n";
+    output << "  --benchmark <name> [arguments...]\n";
+    output << "Any of them can end with --telemetry, --track-allocations or --assert-no-allocations\n";
+}
+
+int main(int argc, char* argv[])
 {
-    Game game;
+    // Flags that can go at the end of any command line. --telemetry publishes every tick to shared memory,
+    // --track-allocations counts each phase's heap allocations and --assert-no-allocations stops on any once settled
+    bool telemetry = false;
+    bool trackAllocations = false;
+    bool assertNoAllocations = false;
+    while (argc >= 2) {
+        std::string flag = argv[argc - 1];
+        if (flag == "--telemetry") {
+            telemetry = true;
+        }
+        else if (flag == "--track-allocations") {
+            trackAllocations = true;
+        }
+        else if (flag == "--assert-no-allocations") {
+            assertNoAllocations = true;
+        }
+        else {
+            break;
+        }
+        argc--;
+    }
+
+    std::string mode = argc >= 2 ? argv[1] : "";
+
+    // --benchmark <name> [arguments...] runs a benchmark instead of the game
+    if (mode == "--benchmark" && argc >= 3) {
+        std::vector<std::string> arguments(argv + 3, argv + argc);
+        return runBenchmark(argv[2], arguments, std::cout);
+    }
+
+    // --verify [ticks] [tolerance] [engine options...] checks the simulation against the reference steering model
+    if (mode == "--verify") {
+        unsigned int ticks = DEFAULT_VERIFY_TICKS;
+        float tolerance = DEFAULT_VERIFY_TOLERANCE;
+        if ((argc >= 3 && !parseArgument(argv[2], ticks)) || (argc >= 4 && !parseArgument(argv[3], tolerance))) {
+            printUsage(std::cerr);
+            return 1;
+        }
+        std::vector<std::string> engineOptions(argv + std::min(argc, 4), argv + argc);
+        return runVerification(ticks, tolerance, engineOptions, std::cout);
+    }
+
+    // --telemetry-reader [seconds] prints what a running game is publishing
+    if (mode == "--telemetry-reader") {
+        unsigned int seconds = 0;
+        if (argc >= 3 && !parseArgument(argv[2], seconds)) {
+            printUsage(std::cerr);
+            return 1;
+        }
+        return runTelemetryReader(seconds, std::cout);
+    }
+
+    // --convert-scenario <input> <output> saves a scenario in the binary format
+    if (mode == "--convert-scenario" && argc >= 4) {
+        Scenario scenario;
+        std::string error;
+        if (!loadScenario(argv[2], scenario, error) || !saveScenarioBinary(argv[3], scenario, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // --scenario <file> opens the game with a scenario, --headless <file> [ticks] [recording] runs one without any windows
+    GameOptions options;
+    options.telemetry = telemetry;
+    options.trackAllocations = trackAllocations;
+    options.assertNoAllocations = assertNoAllocations;
+    Scenario scenario;
+    if ((mode == "--scenario" || mode == "--headless") && argc >= 3) {
+        std::string error;
+        if (!loadScenario(argv[2], scenario, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        options.scenario = &scenario;
+        options.headless = mode == "--headless";
+    }
+
+    // --replay <recording> plays back a recording instead of running the simulation
+    TrajectoryReader replay;
+    if (mode == "--replay" && argc >= 3) {
+        std::string error;
+        if (!replay.open(argv[2], error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        options.replay = &replay;
+    }
+
+    if (options.headless) {
+        unsigned int ticks = DEFAULT_HEADLESS_TICKS;
+        if (argc >= 4 && !parseArgument(argv[3], ticks)) {
+            printUsage(std::cerr);
+            return 1;
+        }
+        if (argc >= 5) {
+            options.recordingPath = argv[4];
+        }
+        Game game(options);
+        game.runHeadless(ticks, std::cout);
+        return 0;
+    }
+
+    Game game(options);
 
     while (game.isRunning()) {
         //Update